@@ -0,0 +1,160 @@
+/**************************************************************************************\
+** File: AllocationCounter.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the AllocationCounter namespace
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "AllocationCounter.h"
+#ifdef PONG_COUNT_ALLOCATIONS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace
+{
+	std::atomic<Uint64> allocationCount{ 0 };
+
+	void* CountedAllocate(std::size_t size)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		return std::malloc(size ? size : 1);
+	}
+	void* CountedAllocate(std::size_t size, std::align_val_t alignment)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		std::size_t alignmentBytes{ (std::size_t)alignment };
+#ifdef _MSC_VER
+		return _aligned_malloc(size ? size : 1, alignmentBytes);
+#else
+		// aligned_alloc wants a size that is a multiple of the alignment
+		return std::aligned_alloc(alignmentBytes, ((size ? size : 1) + alignmentBytes - 1) / alignmentBytes * alignmentBytes);
+#endif
+	}
+	void FreeAligned(void* ptr)
+	{
+#ifdef _MSC_VER
+		_aligned_free(ptr);
+#else
+		std::free(ptr);
+#endif
+	}
+}
+#endif
+
+namespace Pong
+{
+	namespace AllocationCounter
+	{
+		Uint64 GetCount()
+		{
+#ifdef PONG_COUNT_ALLOCATIONS
+			return allocationCount.load(std::memory_order_relaxed);
+#else
+			return 0;
+#endif
+		}
+	}
+}
+
+#ifdef PONG_COUNT_ALLOCATIONS
+//+--------------------------------\--------------------------------------
+//|	   Global allocation functions  |
+//\--------------------------------/--------------------------------------
+void* operator new(std::size_t size)
+{
+	if(void* ptr = CountedAllocate(size))
+		return ptr;
+	throw std::bad_alloc{};
+}
+void* operator new[](std::size_t size)
+{
+	if(void* ptr = CountedAllocate(size))
+		return ptr;
+	throw std::bad_alloc{};
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size);
+}
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+	std::free(ptr);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+	std::free(ptr);
+}
+
+// Over-aligned types, such as Game::MatchState, go through these
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	if(void* ptr = CountedAllocate(size, alignment))
+		return ptr;
+	throw std::bad_alloc{};
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	if(void* ptr = CountedAllocate(size, alignment))
+		return ptr;
+	throw std::bad_alloc{};
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size, alignment);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+	FreeAligned(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t) noexcept
+{
+	FreeAligned(ptr);
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(ptr);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(ptr);
+}
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	FreeAligned(ptr);
+}
+#endif
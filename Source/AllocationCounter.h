@@ -0,0 +1,29 @@
+/**************************************************************************************\
+** File: AllocationCounter.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the AllocationCounter namespace
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	// Counts calls to the global operator new, which AllocationCounter.cpp
+	// replaces for the whole program when PONG_COUNT_ALLOCATIONS is defined (see
+	// pch.h). Counting is one relaxed atomic add per allocation. Without the
+	// define the standard allocator is used and the count stays at zero.
+	namespace AllocationCounter
+	{
+#ifdef PONG_COUNT_ALLOCATIONS
+		constexpr bool ENABLED{ true };
+#else
+		constexpr bool ENABLED{ false };
+#endif
+
+		// Allocations since program start, from all threads
+		Uint64 GetCount();
+	}
+}
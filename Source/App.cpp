@@ -14,6 +14,7 @@
 #include "Intro.h"
 #include "MainMenu.h"
 #include "Gameplay.h"
+#include "Audio.h"
 #include "Exceptions.h"
 
 namespace Pong
@@ -26,22 +27,35 @@ namespace Pong
 		timer.Start();
 		while(m_nextState != AppStateID::QUIT)
 		{
+			m_framePacer.WaitForFrameStart();
 			timer.Update();
+			m_profiler.EndFrame(timer.Getdt());
 			Step(timer.Getdt());
 		}
+		Trace::WriteFile();
 		Shutdown();
 	}
 	void App::Init()
 	{
 		// Init d2d
-		d2d::Init(d2LogSeverityTrace, "Ping.log");
 		{
 			AppDef settings;
-			settings.LoadFrom("Data\\app.hjson");
+			settings.LoadFrom("Data/app.hjson");
+			settings.ApplyRenderBackend();
 
+			d2d::Init(d2LogSeverityTrace, "Ping.log");
 			d2d::InitGamepads(settings.gamepads);
 			d2d::Window::Init(settings.window);
-			m_hasFocus = false;
+			m_framePacer.Init(settings.framePacing, settings.window.vsync);
+			m_profiler.Init(settings.profiler);
+			Trace::Init(settings.trace);
+			Audio::Init(settings.audio);
+
+			SDL_Window* windowPtr{ SDL_GL_GetCurrentWindow() };
+			Uint32 windowFlags{ windowPtr ? SDL_GetWindowFlags(windowPtr) : SDL_WINDOW_INPUT_FOCUS };
+			m_hasFocus = (windowFlags & SDL_WINDOW_INPUT_FOCUS) != 0;
+			m_isHidden = (windowFlags & (SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN)) != 0;
+			m_framePacer.SetBackground(!m_hasFocus || m_isHidden);
 		}
 		d2d::SeedRandomNumberGenerator();
 
@@ -53,10 +67,11 @@ namespace Pong
 		// Start first app state
 		m_currentState = FIRST_APP_STATE;
 		m_nextState = FIRST_APP_STATE;
-		GetStatePtr(m_currentState)->Init();
+		GetState(m_currentState).Init();
 	}
 	void App::Step(float dt)
 	{
+		TraceScope trace{ "App::Step" };
 		d2d::ClampHigh(dt, MAX_APP_STEP);
 
 		UpdateCurrentState(dt);
@@ -66,15 +81,26 @@ namespace Pong
 			if(m_nextState != m_currentState)
 			{
 				m_currentState = m_nextState;
-				GetStatePtr(m_currentState)->Init();
-				d2d::Window::SetClearColor(GetStatePtr(m_currentState)->GetClearColor());
+				AppState& currentState{ GetState(m_currentState) };
+				currentState.Init();
+				d2d::Window::SetClearColor(currentState.GetClearColor());
 			}
-			else
+			else if(!m_isHidden)
 			{
 
 				d2d::Window::StartScene();
-				GetStatePtr(m_currentState)->Draw();
-				d2d::Window::EndScene();
+				{
+					ScopedTimer timer{ ProfilePhase::DRAW };
+					GetState(m_currentState).Draw();
+					m_profiler.Draw();
+				}
+				m_framePacer.MarkFrameSubmitted();
+				{
+					ScopedTimer timer{ ProfilePhase::SWAP };
+					TraceScope trace{ "Window::EndScene" };
+					d2d::Window::EndScene();
+				}
+				m_framePacer.MarkFrameSwapped();
 			}
 		}
 	}
@@ -83,39 +109,74 @@ namespace Pong
 		// Just in case an exception brings us out of the main loop
 		Shutdown();
 	}
-	std::shared_ptr<AppState> App::GetStatePtr(AppStateID appState)
+	AppState& App::GetState(AppStateID appState)
 	{
 		switch(appState)
 		{
-		case AppStateID::INTRO:		return m_introPtr;
-		case AppStateID::MAIN_MENU: return m_mainMenuPtr;
-		case AppStateID::GAMEPLAY:	return m_gameplayPtr;
-		default: throw InvalidAppStateException{ "GetStatePtr(): No pointer exists for AppState (calling code must ensure argument is not QUIT)" };
+		case AppStateID::INTRO:		return *m_introPtr;
+		case AppStateID::MAIN_MENU: return *m_mainMenuPtr;
+		case AppStateID::GAMEPLAY:	return *m_gameplayPtr;
+		default: throw InvalidAppStateException{ "GetState(): No AppState exists for this ID (calling code must ensure argument is not QUIT)" };
 		}
 	}
 	void App::UpdateCurrentState(float dt)
 	{
-		std::shared_ptr<AppState> currentStatePtr{ GetStatePtr(m_currentState) };
+		TraceScope trace{ "App::UpdateCurrentState" };
+		AppState& currentState{ GetState(m_currentState) };
 
 		// Handle events
-		SDL_Event event;
-		while(SDL_PollEvent(&event) != 0)
 		{
-			if(event.type == SDL_QUIT ||
-				(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE))
+			ScopedTimer timer{ ProfilePhase::EVENTS };
+			SDL_Event event;
+			while(SDL_PollEvent(&event) != 0)
 			{
-				m_nextState = AppStateID::QUIT;
-				return;
+				if(event.type == SDL_WINDOWEVENT)
+					ProcessWindowEvent(event.window);
+
+				if(event.type == SDL_QUIT ||
+					(event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE))
+				{
+					m_nextState = AppStateID::QUIT;
+					return;
+				}
+				else if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3 && !event.key.repeat)
+					m_profiler.ToggleVisible();
+				else if(event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F4 && !event.key.repeat)
+					Trace::WriteFile();
+				else
+					currentState.ProcessEvent(event);
 			}
-			else
-				currentStatePtr->ProcessEvent(event);
 		}
 
 		// Update
-		m_nextState = currentStatePtr->Update(dt);
-	}	
+		m_nextState = currentState.Update(dt);
+	}
+	void App::ProcessWindowEvent(const SDL_WindowEvent& event)
+	{
+		switch(event.event)
+		{
+		case SDL_WINDOWEVENT_FOCUS_GAINED:	m_hasFocus = true; break;
+		case SDL_WINDOWEVENT_FOCUS_LOST:	m_hasFocus = false; break;
+		case SDL_WINDOWEVENT_MINIMIZED:
+		case SDL_WINDOWEVENT_HIDDEN:		m_isHidden = true; break;
+		case SDL_WINDOWEVENT_RESTORED:
+		case SDL_WINDOWEVENT_MAXIMIZED:
+		case SDL_WINDOWEVENT_SHOWN:			m_isHidden = false; break;
+		default: return;
+		}
+
+		// Gameplay's simulation thread keeps ticking and servicing the network
+		// at its own rate either way, so the session stays healthy
+		m_framePacer.SetBackground(!m_hasFocus || m_isHidden);
+	}
 	void App::Shutdown()
 	{
+		// States hold GL objects and network sockets, so they go while d2d is still up
+		m_introPtr.reset();
+		m_mainMenuPtr.reset();
+		m_gameplayPtr.reset();
+
+		Audio::Shutdown();
 		d2d::Shutdown();
 	}
 }
\ No newline at end of file
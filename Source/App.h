@@ -12,6 +12,9 @@
 #include "Intro.h"
 #include "MainMenu.h"
 #include "Gameplay.h"
+#include "FramePacer.h"
+#include "Profiler.h"
+#include "Trace.h"
 #include "Exceptions.h"
 
 namespace Pong
@@ -27,8 +30,9 @@ namespace Pong
 		void Init();
 		void Step(float dt);
 
-		std::shared_ptr<AppState> GetStatePtr(AppStateID appState);
+		AppState& GetState(AppStateID appState);
 		void UpdateCurrentState(float dt);
+		void ProcessWindowEvent(const SDL_WindowEvent& event);
 		void Shutdown();
 
 		std::shared_ptr<Intro> m_introPtr;
@@ -37,7 +41,11 @@ namespace Pong
 
 		AppStateID m_currentState{ FIRST_APP_STATE };
 		AppStateID m_nextState{ FIRST_APP_STATE };
+		FramePacer m_framePacer;
+		ProfilerOverlay m_profiler;
 
-		bool m_hasFocus;
+		// Without a window (offscreen rendering) the app is always in the foreground
+		bool m_hasFocus{ true };
+		bool m_isHidden{ false };	// Minimized or hidden, so there's nothing to draw
 	};
 }
\ No newline at end of file
@@ -21,9 +21,15 @@ namespace Pong
 		// Get root level values
 		d2d::HjsonValue gamepadsData;
 		d2d::HjsonValue windowData;
+		d2d::HjsonValue profilerData;
+		d2d::HjsonValue audioData;
+		d2d::HjsonValue traceData;
 		try {
 			gamepadsData = d2d::GetMemberValue(data, "gamepads");
 			windowData = d2d::GetMemberValue(data, "window");
+			profilerData = d2d::GetMemberValue(data, "profiler");
+			audioData = d2d::GetMemberValue(data, "audio");
+			traceData = d2d::GetMemberValue(data, "trace");
 		}
 		catch(const d2d::HjsonFailedQueryException& e) {
 			throw LoadSettingsFileException{ appFilePath + ": Invalid value: " + e.what() };
@@ -54,6 +60,18 @@ namespace Pong
 
 			window.vsync = d2d::GetBool(windowData, "vsync");
 			window.vsyncAllowLateSwaps = d2d::GetBool(windowData, "vsyncAllowLateSwaps");
+
+			std::string renderBackendString{ d2d::GetString(windowData, "renderBackend") };
+			if(renderBackendString == "window")
+				renderBackend = RenderBackend::WINDOW;
+			else if(renderBackendString == "offscreen")
+				renderBackend = RenderBackend::OFFSCREEN;
+			else
+				throw LoadSettingsFileException{ appFilePath + ": Invalid value: window.renderBackend: " + renderBackendString };
+
+			framePacing.lowLatency = d2d::GetBool(windowData, "lowLatencyFramePacing");
+			framePacing.safetyMargin = 0.001f * d2d::GetFloat(windowData, "framePacingMarginMilliseconds");
+			framePacing.backgroundFrameRate = d2d::GetFloat(windowData, "backgroundFramesPerSecond");
 			window.doubleBuffer = d2d::GetBool(windowData, "doubleBuffer");
 			window.antiAliasingSamples = d2d::GetInt(windowData, "antiAliasingSamples");
 			window.fpsUpdateDelay = 1.0f / d2d::GetFloat(windowData, "fpsUpdatesPerSecond");
@@ -82,6 +100,36 @@ namespace Pong
 			throw LoadSettingsFileException{ appFilePath + ": Invalid value: window." + e.what() };
 		}
 
+		// Get profiler settings
+		try {
+			profiler.showOverlay = d2d::GetBool(profilerData, "showOverlay");
+			profiler.historySeconds = d2d::GetFloat(profilerData, "historySeconds");
+		}
+		catch(const d2d::HjsonFailedQueryException& e) {
+			throw LoadSettingsFileException{ appFilePath + ": Invalid value: profiler." + e.what() };
+		}
+
+		// Get audio settings
+		try {
+			audio.enabled = d2d::GetBool(audioData, "enabled");
+			audio.volume = d2d::GetFloat(audioData, "volume");
+			audio.sampleRate = d2d::GetInt(audioData, "sampleRate");
+			audio.bufferFrames = d2d::GetInt(audioData, "bufferFrames");
+		}
+		catch(const d2d::HjsonFailedQueryException& e) {
+			throw LoadSettingsFileException{ appFilePath + ": Invalid value: audio." + e.what() };
+		}
+
+		// Get trace settings
+		try {
+			trace.enabled = d2d::GetBool(traceData, "enabled");
+			trace.eventsPerThread = d2d::GetInt(traceData, "eventsPerThread");
+			trace.outputFilePath = d2d::GetString(traceData, "outputFilePath");
+		}
+		catch(const d2d::HjsonFailedQueryException& e) {
+			throw LoadSettingsFileException{ appFilePath + ": Invalid value: trace." + e.what() };
+		}
+
 		try {
 			Validate();
 		}
@@ -89,6 +137,11 @@ namespace Pong
 			throw LoadSettingsFileException{ appFilePath + ": App setting out of range: " + e.what() };
 		}
 	}
+	void AppDef::ApplyRenderBackend() const
+	{
+		if(renderBackend == RenderBackend::OFFSCREEN)
+			SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+	}
 	void AppDef::Validate() const
 	{
 		// gamepads
@@ -111,9 +164,23 @@ namespace Pong
 
 		if(window.fpsUpdateDelay < 0) throw SettingOutOfRangeException{ "window.fpsUpdateDelay" };
 		if(window.imageExtensions == 0) throw SettingOutOfRangeException{ "window.imageExtensions" };
+		if(framePacing.safetyMargin < 0.0f) throw SettingOutOfRangeException{ "window.framePacingMarginMilliseconds" };
+		if(framePacing.backgroundFrameRate <= 0.0f) throw SettingOutOfRangeException{ "window.backgroundFramesPerSecond" };
 
 		// gl
 		if(window.gl.versionMajor < 0) throw SettingOutOfRangeException{ "window.glVersion[0]" };
 		if(window.gl.versionMinor < 0) throw SettingOutOfRangeException{ "window.glVersion[1]" };
+
+		// profiler
+		if(profiler.historySeconds <= 0.0f) throw SettingOutOfRangeException{ "profiler.historySeconds" };
+
+		// audio
+		if(audio.volume < 0.0f || audio.volume > 1.0f) throw SettingOutOfRangeException{ "audio.volume" };
+		if(audio.sampleRate <= 0) throw SettingOutOfRangeException{ "audio.sampleRate" };
+		if(audio.bufferFrames <= 0) throw SettingOutOfRangeException{ "audio.bufferFrames" };
+
+		// trace
+		if(trace.eventsPerThread <= 0) throw SettingOutOfRangeException{ "trace.eventsPerThread" };
+		if(trace.outputFilePath.empty()) throw SettingOutOfRangeException{ "trace.outputFilePath" };
 	}
 }
\ No newline at end of file
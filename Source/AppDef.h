@@ -10,12 +10,49 @@
 #pragma once
 namespace Pong
 {
+	enum class RenderBackend
+	{
+		WINDOW,		// Normal desktop window
+		OFFSCREEN	// No display needed: SDL's offscreen video driver with an EGL pbuffer context
+	};
+	struct FramePacingDef
+	{
+		bool lowLatency;		// Start frames just before vsync instead of right after the last one
+		float safetyMargin;		// Seconds of slack left before the predicted vsync
+		float backgroundFrameRate;	// Frames per second while unfocused or minimized
+	};
+	struct ProfilerDef
+	{
+		bool showOverlay;		// Can also be toggled with F3
+		float historySeconds;	// Window for frame time percentiles
+	};
+	struct AudioDef
+	{
+		bool enabled;
+		float volume;			// [0,1], applied to every sound effect
+		int sampleRate;
+		int bufferFrames;		// Per audio callback; fewer means lower latency but more wakeups
+	};
+	struct TraceDef
+	{
+		bool enabled;				// Can also be enabled with the PONG_TRACE=1 environment variable
+		int eventsPerThread;		// Ring buffer size, older events are overwritten
+		std::string outputFilePath;	// Written on exit and when F4 is pressed
+	};
 	struct AppDef
 	{
 		void LoadFrom(const std::string& filePath);
 		void Validate() const;
 
+		// Call before d2d::Init, since the video driver is chosen when SDL video starts
+		void ApplyRenderBackend() const;
+
 		d2d::GamepadSettings gamepads;
 		d2d::WindowDef window;
+		RenderBackend renderBackend;
+		FramePacingDef framePacing;
+		ProfilerDef profiler;
+		AudioDef audio;
+		TraceDef trace;
 	};
 }
@@ -0,0 +1,203 @@
+/**************************************************************************************\
+** File: Audio.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the Audio namespace
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "Audio.h"
+#include "SpscQueue.h"
+#include <SDL_mixer.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+
+namespace Pong
+{
+	namespace Audio
+	{
+		namespace
+		{
+			const int CHANNELS{ 2 };
+			const int MAX_VOICES{ 16 };
+			const unsigned COMMAND_QUEUE_SIZE{ 64 };
+			const int SOUND_COUNT{ (int)SoundEffect::COUNT };
+
+			// No file for this one; a short square wave blip, like the arcade original
+			const float PADDLE_HIT_HZ{ 490.0f };
+			const float PADDLE_HIT_SECONDS{ 0.04f };
+			const float PADDLE_HIT_AMPLITUDE{ 0.3f };
+			const char* const SOUND_FILE_PATHS[SOUND_COUNT]{
+				nullptr,
+				"SoundEffects/goalScored.ogg",
+				"SoundEffects/endGame.wav"
+			};
+
+			struct Voice
+			{
+				const std::vector<Sint16>* samplesPtr{ nullptr };	// Null when free
+				size_t position{ 0 };
+			};
+
+			AudioDef settings;
+			bool deviceOpen{ false };
+			std::atomic<bool> ready{ false };
+			// Interleaved stereo in the device's format. Only changed while the mixer is unhooked.
+			std::array<std::vector<Sint16>, SOUND_COUNT> sounds;
+			SpscQueue<SoundEffect, COMMAND_QUEUE_SIZE> commands;
+
+			// Audio thread only
+			Voice voices[MAX_VOICES];
+			int nextStolenVoice{ 0 };
+
+			void SynthesizePaddleHit(std::vector<Sint16>& samples)
+			{
+				int sampleRate{ settings.sampleRate };
+				Uint16 format;
+				int channels;
+				Mix_QuerySpec(&sampleRate, &format, &channels);
+
+				const int frameCount{ (int)(PADDLE_HIT_SECONDS * sampleRate) };
+				samples.resize(frameCount * CHANNELS);
+				for(int frame = 0; frame < frameCount; ++frame)
+				{
+					float cycles{ PADDLE_HIT_HZ * frame / sampleRate };
+					float square{ cycles - std::floor(cycles) < 0.5f ? 1.0f : -1.0f };
+					float envelope{ 1.0f - (float)frame / frameCount };
+					Sint16 value{ (Sint16)(PADDLE_HIT_AMPLITUDE * 32767.0f * square * envelope) };
+					for(int channel = 0; channel < CHANNELS; ++channel)
+						samples[frame * CHANNELS + channel] = value;
+				}
+			}
+
+			// Returns an error message, or empty on success
+			std::string LoadSound(SoundEffect sound, std::vector<Sint16>& samples)
+			{
+				const char* filePath{ SOUND_FILE_PATHS[(int)sound] };
+				if(!filePath)
+				{
+					SynthesizePaddleHit(samples);
+					return {};
+				}
+
+				// Decodes the whole file and converts it to the device's format
+				Mix_Chunk* chunkPtr{ Mix_LoadWAV(filePath) };
+				if(!chunkPtr)
+					return std::string{ filePath } + ": " + Mix_GetError();
+				const Sint16* firstSamplePtr{ (const Sint16*)chunkPtr->abuf };
+				samples.assign(firstSamplePtr, firstSamplePtr + chunkPtr->alen / sizeof(Sint16));
+				Mix_FreeChunk(chunkPtr);
+				return {};
+			}
+
+			void StartVoice(SoundEffect sound)
+			{
+				const std::vector<Sint16>& samples{ sounds[(int)sound] };
+				if(samples.empty())
+					return;
+
+				// A free voice, or else cut one short
+				Voice* voicePtr{ std::find_if(std::begin(voices), std::end(voices),
+					[](const Voice& voice) { return !voice.samplesPtr; }) };
+				if(voicePtr == std::end(voices))
+				{
+					voicePtr = &voices[nextStolenVoice];
+					nextStolenVoice = (nextStolenVoice + 1) % MAX_VOICES;
+				}
+				voicePtr->samplesPtr = &samples;
+				voicePtr->position = 0;
+			}
+
+			// Called on SDL's audio thread, with stream already silent
+			void SDLCALL Mix(void*, Uint8* stream, int length)
+			{
+				SoundEffect sound;
+				while(commands.TryPop(sound))
+					StartVoice(sound);
+
+				Sint16* outputPtr{ (Sint16*)stream };
+				const size_t outputCount{ (size_t)length / sizeof(Sint16) };
+				for(Voice& voice : voices)
+				{
+					if(!voice.samplesPtr)
+						continue;
+					const std::vector<Sint16>& samples{ *voice.samplesPtr };
+					size_t count{ std::min(outputCount, samples.size() - voice.position) };
+					const Sint16* inputPtr{ samples.data() + voice.position };
+					for(size_t i = 0; i < count; ++i)
+						outputPtr[i] = (Sint16)std::clamp((int)outputPtr[i] + (int)(settings.volume * inputPtr[i]), -32768, 32767);
+
+					voice.position += count;
+					if(voice.position >= samples.size())
+						voice.samplesPtr = nullptr;
+				}
+			}
+		}
+
+		void Init(const AudioDef& audioSettings)
+		{
+			Shutdown();
+			settings = audioSettings;
+			if(!settings.enabled)
+				return;
+
+			if(SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+			{
+				d2LogWarning << "No sound, failed to start SDL audio: " << SDL_GetError();
+				return;
+			}
+			// Without OGG support, its effects fail to load below and are skipped
+			Mix_Init(MIX_INIT_OGG);
+			// No format changes allowed, so SDL converts and every sample is a stereo Sint16
+			if(Mix_OpenAudioDevice(settings.sampleRate, AUDIO_S16SYS, CHANNELS, settings.bufferFrames, nullptr, 0) != 0)
+			{
+				d2LogWarning << "No sound, failed to open audio device: " << Mix_GetError();
+				Mix_Quit();
+				SDL_QuitSubSystem(SDL_INIT_AUDIO);
+				return;
+			}
+			deviceOpen = true;
+			Mix_AllocateChannels(0);	// All mixing is done by Mix
+
+			// One at a time, since SDL_mixer doesn't promise its loaders are thread safe
+			for(int i = 0; i < SOUND_COUNT; ++i)
+			{
+				std::string error{ LoadSound((SoundEffect)i, sounds[i]) };
+				if(!error.empty())
+					d2LogWarning << "Failed to load sound effect, it won't play: " << error;
+			}
+
+			// Nothing is consuming yet, so stale commands can be dropped from here
+			SoundEffect staleSound;
+			while(commands.TryPop(staleSound))
+				;
+			for(Voice& voice : voices)
+				voice = {};
+			Mix_HookMusic(Mix, nullptr);
+			ready.store(true, std::memory_order_release);
+		}
+		void Shutdown()
+		{
+			ready.store(false, std::memory_order_release);
+			if(deviceOpen)
+			{
+				// Waits for a mix in progress, so the sounds can go after
+				Mix_HookMusic(nullptr, nullptr);
+				Mix_CloseAudio();
+				Mix_Quit();
+				SDL_QuitSubSystem(SDL_INIT_AUDIO);
+				deviceOpen = false;
+			}
+			for(std::vector<Sint16>& samples : sounds)
+				samples = {};
+		}
+		void Play(SoundEffect sound)
+		{
+			if(ready.load(std::memory_order_acquire))
+				commands.TryPush(sound);
+		}
+	}
+}
@@ -0,0 +1,38 @@
+/**************************************************************************************\
+** File: Audio.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the Audio namespace
+**
+\**************************************************************************************/
+#pragma once
+#include "AppDef.h"
+
+namespace Pong
+{
+	enum class SoundEffect
+	{
+		PADDLE_HIT,
+		GOAL_SCORED,
+		GAME_OVER,
+		COUNT
+	};
+
+	// Plays sound effects without costing the thread that asks for them anything.
+	// Init decodes every effect to PCM in the device's format up front. Play only
+	// queues a command on a lock-free queue; SDL's audio thread takes commands off
+	// it and mixes the playing effects into its buffer.
+	namespace Audio
+	{
+		// Call after d2d::Init. Without an audio device, or if disabled in settings,
+		// everything still works, silently.
+		void Init(const AudioDef& settings);
+		void Shutdown();
+
+		// From one thread at a time, e.g. the simulation thread. Never blocks or
+		// allocates. If too many commands are waiting, the sound is dropped.
+		void Play(SoundEffect sound);
+	}
+}
@@ -0,0 +1,117 @@
+/**************************************************************************************\
+** File: ClockSync.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the ClockSync class
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "ClockSync.h"
+#include <chrono>
+
+namespace Pong
+{
+	namespace
+	{
+		// Quartz is good to about 100 parts per million; more is noise
+		const double MAX_DRIFT{ 500e-6 };
+		// Drift over a shorter span than this is mostly noise too
+		const double MIN_DRIFT_SPAN_SECONDS{ 2.0 };
+	}
+
+	double ClockSync::Now()
+	{
+		return std::chrono::duration<double>{ std::chrono::steady_clock::now().time_since_epoch() }.count();
+	}
+	Uint64 ClockSync::ToMicroseconds(double seconds)
+	{
+		return (Uint64)std::llround(seconds * 1e6);
+	}
+	double ClockSync::FromMicroseconds(Uint64 microseconds)
+	{
+		return (double)microseconds * 1e-6;
+	}
+	void ClockSync::Reset()
+	{
+		m_sampleCount = 0;
+		m_nextSample = 0;
+		m_fitTime = 0.0;
+		m_offset = 0.0;
+		m_drift = 0.0;
+		m_roundTrip = 0.0;
+	}
+	void ClockSync::AddSample(double requestSent, double requestReceived, double responseSent, double responseReceived)
+	{
+		// Time spent on the server doesn't count towards the round trip
+		double roundTrip{ (responseReceived - requestSent) - (responseSent - requestReceived) };
+		if(roundTrip < 0.0 || responseSent < requestReceived)
+			return;
+
+		Sample& sample{ m_samples[m_nextSample] };
+		sample.localTime = 0.5 * (requestSent + responseReceived);
+		sample.offset = 0.5 * ((requestReceived - requestSent) + (responseSent - responseReceived));
+		sample.roundTrip = roundTrip;
+		m_nextSample = (m_nextSample + 1) % WINDOW;
+		m_sampleCount = std::min(m_sampleCount + 1, WINDOW);
+		Fit();
+	}
+	bool ClockSync::IsSynchronized() const
+	{
+		return m_sampleCount >= MIN_SAMPLES;
+	}
+	double ClockSync::ToServerTime(double localTime) const
+	{
+		return localTime + m_offset + m_drift * (localTime - m_fitTime);
+	}
+	double ClockSync::ToLocalTime(double serverTime) const
+	{
+		return (serverTime - m_offset + m_drift * m_fitTime) / (1.0 + m_drift);
+	}
+	double ClockSync::GetRoundTripSeconds() const
+	{
+		return m_roundTrip;
+	}
+	double ClockSync::GetDrift() const
+	{
+		return m_drift;
+	}
+	void ClockSync::Fit()
+	{
+		// Keep the quickest third
+		std::copy(m_samples.begin(), m_samples.begin() + m_sampleCount, m_quickest.begin());
+		int keptCount{ std::max(std::min(MIN_SAMPLES, m_sampleCount), m_sampleCount / 3) };
+		std::partial_sort(m_quickest.begin(), m_quickest.begin() + keptCount, m_quickest.begin() + m_sampleCount,
+			[](const Sample& a, const Sample& b) { return a.roundTrip < b.roundTrip; });
+		m_roundTrip = m_quickest[0].roundTrip;
+
+		// Least squares line of offset over time
+		double meanTime{ 0.0 };
+		double meanOffset{ 0.0 };
+		double earliest{ m_quickest[0].localTime };
+		double latest{ earliest };
+		for(int i = 0; i < keptCount; ++i)
+		{
+			meanTime += m_quickest[i].localTime;
+			meanOffset += m_quickest[i].offset;
+			earliest = std::min(earliest, m_quickest[i].localTime);
+			latest = std::max(latest, m_quickest[i].localTime);
+		}
+		meanTime /= keptCount;
+		meanOffset /= keptCount;
+
+		double covariance{ 0.0 };
+		double variance{ 0.0 };
+		for(int i = 0; i < keptCount; ++i)
+		{
+			double time{ m_quickest[i].localTime - meanTime };
+			covariance += time * (m_quickest[i].offset - meanOffset);
+			variance += time * time;
+		}
+		m_fitTime = meanTime;
+		m_offset = meanOffset;
+		m_drift = (latest - earliest >= MIN_DRIFT_SPAN_SECONDS && variance > 0.0) ?
+			std::clamp(covariance / variance, -MAX_DRIFT, MAX_DRIFT) : 0.0;
+	}
+}
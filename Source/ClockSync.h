@@ -0,0 +1,64 @@
+/**************************************************************************************\
+** File: ClockSync.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the ClockSync class
+**
+\**************************************************************************************/
+#pragma once
+#include <array>
+
+namespace Pong
+{
+	// Estimates the server's clock from a client's, NTP style: the client stamps a
+	// request, the server stamps when it got it and when it answered, and the client
+	// stamps the answer. Each exchange gives the offset between the clocks, wrong by
+	// half of however unevenly the round trip split between the two directions. Slow
+	// exchanges are the likeliest to be uneven, so only the quickest of the recent ones
+	// are kept, and a line through their offsets over time gives the offset and drift.
+	class ClockSync
+	{
+	public:
+		// Seconds on this machine's steady clock. Every time here is one of these,
+		// or the server's.
+		static double Now();
+		// For sending times over the network
+		static Uint64 ToMicroseconds(double seconds);
+		static double FromMicroseconds(Uint64 microseconds);
+
+		void Reset();
+		// requestSent and responseReceived are local times, the other two server times
+		void AddSample(double requestSent, double requestReceived, double responseSent, double responseReceived);
+		bool IsSynchronized() const;
+		double ToServerTime(double localTime) const;
+		double ToLocalTime(double serverTime) const;
+		// Of the quickest recent exchange
+		double GetRoundTripSeconds() const;
+		// Server seconds gained per local second
+		double GetDrift() const;
+
+	private:
+		struct Sample
+		{
+			double localTime;	// Halfway through the exchange
+			double offset;		// Server time minus local time
+			double roundTrip;
+		};
+		static const int WINDOW{ 64 };
+		static const int MIN_SAMPLES{ 4 };
+
+		void Fit();
+
+		std::array<Sample, WINDOW> m_samples;
+		std::array<Sample, WINDOW> m_quickest;	// Scratch for Fit
+		int m_sampleCount{ 0 };
+		int m_nextSample{ 0 };
+
+		double m_fitTime{ 0.0 };
+		double m_offset{ 0.0 };	// At m_fitTime
+		double m_drift{ 0.0 };
+		double m_roundTrip{ 0.0 };
+	};
+}
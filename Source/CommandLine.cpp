@@ -0,0 +1,78 @@
+/**************************************************************************************\
+** File: CommandLine.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the CommandLine namespace
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "CommandLine.h"
+#include "Exceptions.h"
+
+namespace Pong
+{
+	namespace CommandLine
+	{
+		namespace
+		{
+			template<typename Number, typename Converter>
+			Number Convert(const Argument& argument, const std::string& text, Converter converter)
+			{
+				try {
+					return converter(text);
+				}
+				catch(const std::logic_error&) {
+					throw CommandLineException{ "Invalid number in argument: " + argument.text };
+				}
+			}
+		}
+
+		std::vector<Argument> Parse(const std::vector<std::string>& arguments)
+		{
+			std::vector<Argument> parsed;
+			for(const std::string& argument : arguments)
+			{
+				size_t equalsIndex{ argument.find('=') };
+				if(equalsIndex == std::string::npos)
+					throw CommandLineException{ "Expected name=value: " + argument };
+				parsed.push_back({ argument, argument.substr(0, equalsIndex), argument.substr(equalsIndex + 1) });
+			}
+			return parsed;
+		}
+
+		int ToInt(const Argument& argument)
+		{
+			return ToInt(argument, argument.value);
+		}
+		int ToInt(const Argument& argument, const std::string& text)
+		{
+			return Convert<int>(argument, text, [](const std::string& s) { return std::stoi(s); });
+		}
+		unsigned long long ToUnsigned(const Argument& argument)
+		{
+			return ToUnsigned(argument, argument.value);
+		}
+		unsigned long long ToUnsigned(const Argument& argument, const std::string& text)
+		{
+			return Convert<unsigned long long>(argument, text, [](const std::string& s) { return std::stoull(s); });
+		}
+		float ToFloat(const Argument& argument)
+		{
+			return ToFloat(argument, argument.value);
+		}
+		float ToFloat(const Argument& argument, const std::string& text)
+		{
+			return Convert<float>(argument, text, [](const std::string& s) { return std::stof(s); });
+		}
+		double ToDouble(const Argument& argument)
+		{
+			return ToDouble(argument, argument.value);
+		}
+		double ToDouble(const Argument& argument, const std::string& text)
+		{
+			return Convert<double>(argument, text, [](const std::string& s) { return std::stod(s); });
+		}
+	}
+}
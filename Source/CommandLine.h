@@ -0,0 +1,38 @@
+/**************************************************************************************\
+** File: CommandLine.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the CommandLine namespace
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	// Parsing shared by the tuner and benchmarks, which take their settings as
+	// name=value arguments after the mode flag. Malformed arguments throw
+	// CommandLineException with the whole argument in the message.
+	namespace CommandLine
+	{
+		struct Argument
+		{
+			std::string text;
+			std::string name;
+			std::string value;
+		};
+
+		std::vector<Argument> Parse(const std::vector<std::string>& arguments);
+
+		// Converts the value, or part of it such as one field of min:max:steps
+		int ToInt(const Argument& argument);
+		int ToInt(const Argument& argument, const std::string& text);
+		unsigned long long ToUnsigned(const Argument& argument);
+		unsigned long long ToUnsigned(const Argument& argument, const std::string& text);
+		float ToFloat(const Argument& argument);
+		float ToFloat(const Argument& argument, const std::string& text);
+		double ToDouble(const Argument& argument);
+		double ToDouble(const Argument& argument, const std::string& text);
+	}
+}
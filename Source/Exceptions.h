@@ -26,4 +26,16 @@ namespace Pong
 	{
 		using Exception::Exception;
 	};
+	struct TunerException : public d2d::Exception
+	{
+		using Exception::Exception;
+	};
+	struct BenchmarkException : public d2d::Exception
+	{
+		using Exception::Exception;
+	};
+	struct CommandLineException : public d2d::Exception
+	{
+		using Exception::Exception;
+	};
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+/**************************************************************************************\
+** File: Fixed.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the FixedMath namespace
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "Fixed.h"
+#include "Exceptions.h"
+
+namespace Pong
+{
+	namespace FixedMath
+	{
+		namespace
+		{
+			// atan(2^-i) in Q16.16
+			const int CORDIC_ITERATIONS{ 16 };
+			const Sint32 CORDIC_ATAN_TABLE[CORDIC_ITERATIONS]{
+				51472, 30386, 16055, 8150, 4091, 2047, 1024, 512,
+				256, 128, 64, 32, 16, 8, 4, 2
+			};
+
+			// 1 / (CORDIC gain) in Q16.16, so rotating it yields unit length
+			const Sint32 CORDIC_INVERSE_GAIN{ 39797 };
+
+			Uint64 SquareRoot(Uint64 value)
+			{
+				Uint64 result{ 0 };
+				Uint64 bit{ 1ull << 62 };
+				while(bit > value)
+					bit >>= 2;
+				while(bit != 0)
+				{
+					if(value >= result + bit)
+					{
+						value -= result + bit;
+						result = (result >> 1) + bit;
+					}
+					else
+						result >>= 1;
+					bit >>= 2;
+				}
+				return result;
+			}
+
+			// Rotation mode
+			void SinCos(Fixed radians, Fixed& sinOut, Fixed& cosOut)
+			{
+				// Bring angle to [-PI, PI], then fold into [-PI/2, PI/2]
+				WrapRadians(radians);
+				if(radians > PI)
+					radians -= TWO_PI;
+
+				bool negate{ false };
+				if(radians > HALF_PI)
+				{
+					radians -= PI;
+					negate = true;
+				}
+				else if(radians < -HALF_PI)
+				{
+					radians += PI;
+					negate = true;
+				}
+
+				Sint32 x{ CORDIC_INVERSE_GAIN };
+				Sint32 y{ 0 };
+				Sint32 z{ radians.GetRaw() };
+				for(int i = 0; i < CORDIC_ITERATIONS; ++i)
+				{
+					Sint32 dx{ x >> i };
+					Sint32 dy{ y >> i };
+					if(z >= 0)
+					{
+						x -= dy;
+						y += dx;
+						z -= CORDIC_ATAN_TABLE[i];
+					}
+					else
+					{
+						x += dy;
+						y -= dx;
+						z += CORDIC_ATAN_TABLE[i];
+					}
+				}
+				sinOut = Fixed::FromRaw(negate ? -y : y);
+				cosOut = Fixed::FromRaw(negate ? -x : x);
+			}
+		}
+		Fixed Abs(Fixed value)
+		{
+			return value.GetRaw() < 0 ? -value : value;
+		}
+		Fixed Sqrt(Fixed value)
+		{
+			if(value.GetRaw() < 0)
+				throw GameException{ "FixedMath::Sqrt: Negative value" };
+			return Fixed::FromRaw((Sint32)SquareRoot((Uint64)value.GetRaw() << Fixed::FRACTION_BITS));
+		}
+		Fixed Length(const FixedVec2& v)
+		{
+			// Square in 64 bits so fast pucks don't overflow Q16.16
+			Sint64 x{ v.x.GetRaw() };
+			Sint64 y{ v.y.GetRaw() };
+			return Fixed::FromRaw((Sint32)SquareRoot((Uint64)(x * x + y * y)));
+		}
+		Fixed Sin(Fixed radians)
+		{
+			Fixed sinValue, cosValue;
+			SinCos(radians, sinValue, cosValue);
+			return sinValue;
+		}
+		Fixed Cos(Fixed radians)
+		{
+			Fixed sinValue, cosValue;
+			SinCos(radians, sinValue, cosValue);
+			return cosValue;
+		}
+		Fixed Atan2(Fixed y, Fixed x)
+		{
+			Sint64 vx{ x.GetRaw() };
+			Sint64 vy{ y.GetRaw() };
+			if(vx == 0 && vy == 0)
+				return Fixed{};
+
+			// Rotate by PI into the right half-plane
+			Sint32 z{ 0 };
+			if(vx < 0)
+			{
+				z = (vy >= 0) ? PI.GetRaw() : -PI.GetRaw();
+				vx = -vx;
+				vy = -vy;
+			}
+
+			// Scale up small vectors so the shifts below keep their precision
+			while(std::abs(vx) < (1ll << 40) && std::abs(vy) < (1ll << 40))
+			{
+				vx <<= 1;
+				vy <<= 1;
+			}
+
+			// Vectoring mode: rotate onto the x-axis, summing the rotations
+			for(int i = 0; i < CORDIC_ITERATIONS; ++i)
+			{
+				Sint64 dx{ vx >> i };
+				Sint64 dy{ vy >> i };
+				if(vy > 0)
+				{
+					vx += dy;
+					vy -= dx;
+					z += CORDIC_ATAN_TABLE[i];
+				}
+				else
+				{
+					vx -= dy;
+					vy += dx;
+					z -= CORDIC_ATAN_TABLE[i];
+				}
+			}
+			return Fixed::FromRaw(z);
+		}
+		void WrapRadians(Fixed& radians)
+		{
+			Sint32 raw{ radians.GetRaw() % TWO_PI.GetRaw() };
+			if(raw < 0)
+				raw += TWO_PI.GetRaw();
+			radians = Fixed::FromRaw(raw);
+		}
+	}
+}
@@ -0,0 +1,127 @@
+/**************************************************************************************\
+** File: Fixed.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the Fixed and FixedVec2 types
+**
+\**************************************************************************************/
+#pragma once
+#include "Exceptions.h"
+
+namespace Pong
+{
+	// Q16.16 fixed point number. All math is done on integers, so results are
+	// bit-identical across compilers, optimization levels, and platforms.
+	class Fixed
+	{
+	public:
+		static const int FRACTION_BITS{ 16 };
+		static const Sint32 ONE_RAW{ 1 << FRACTION_BITS };
+
+		Fixed() = default;
+		constexpr explicit Fixed(float value)
+			: m_raw{ (Sint32)((double)value * ONE_RAW + (value >= 0.0f ? 0.5 : -0.5)) }
+		{}
+		static constexpr Fixed FromRaw(Sint32 raw)
+		{
+			Fixed result;
+			result.m_raw = raw;
+			return result;
+		}
+		constexpr Sint32 GetRaw() const
+		{
+			return m_raw;
+		}
+		float ToFloat() const
+		{
+			return (float)m_raw / (float)ONE_RAW;
+		}
+
+		Fixed operator-() const { return FromRaw(-m_raw); }
+		Fixed operator+(Fixed other) const { return FromRaw(m_raw + other.m_raw); }
+		Fixed operator-(Fixed other) const { return FromRaw(m_raw - other.m_raw); }
+		Fixed operator*(Fixed other) const
+		{
+			return FromRaw((Sint32)(((Sint64)m_raw * other.m_raw) >> FRACTION_BITS));
+		}
+		Fixed operator/(Fixed other) const
+		{
+			if(other.m_raw == 0)
+				throw GameException{ "Fixed: Divide by zero" };
+			return FromRaw((Sint32)(((Sint64)m_raw << FRACTION_BITS) / other.m_raw));
+		}
+		Fixed& operator+=(Fixed other) { return *this = *this + other; }
+		Fixed& operator-=(Fixed other) { return *this = *this - other; }
+		Fixed& operator*=(Fixed other) { return *this = *this * other; }
+		Fixed& operator/=(Fixed other) { return *this = *this / other; }
+
+		bool operator==(Fixed other) const { return m_raw == other.m_raw; }
+		bool operator!=(Fixed other) const { return m_raw != other.m_raw; }
+		bool operator<(Fixed other) const { return m_raw < other.m_raw; }
+		bool operator>(Fixed other) const { return m_raw > other.m_raw; }
+		bool operator<=(Fixed other) const { return m_raw <= other.m_raw; }
+		bool operator>=(Fixed other) const { return m_raw >= other.m_raw; }
+
+	private:
+		Sint32 m_raw{ 0 };
+	};
+
+	struct FixedVec2
+	{
+		Fixed x;
+		Fixed y;
+
+		void Set(Fixed newX, Fixed newY)
+		{
+			x = newX;
+			y = newY;
+		}
+		void operator+=(const FixedVec2& other)
+		{
+			x += other.x;
+			y += other.y;
+		}
+		void operator-=(const FixedVec2& other)
+		{
+			x -= other.x;
+			y -= other.y;
+		}
+		void operator*=(Fixed scale)
+		{
+			x *= scale;
+			y *= scale;
+		}
+	};
+	inline FixedVec2 operator+(const FixedVec2& a, const FixedVec2& b)
+	{
+		return { a.x + b.x, a.y + b.y };
+	}
+	inline FixedVec2 operator-(const FixedVec2& a, const FixedVec2& b)
+	{
+		return { a.x - b.x, a.y - b.y };
+	}
+	inline FixedVec2 operator*(Fixed scale, const FixedVec2& v)
+	{
+		return { scale * v.x, scale * v.y };
+	}
+
+	// Trig uses CORDIC with an integer arctangent table instead of libm
+	namespace FixedMath
+	{
+		const Fixed PI{ Fixed::FromRaw(205887) };
+		const Fixed HALF_PI{ Fixed::FromRaw(102944) };
+		const Fixed TWO_PI{ Fixed::FromRaw(411775) };
+
+		Fixed Abs(Fixed value);
+		Fixed Sqrt(Fixed value);
+		Fixed Length(const FixedVec2& v);
+		Fixed Sin(Fixed radians);
+		Fixed Cos(Fixed radians);
+		Fixed Atan2(Fixed y, Fixed x);
+
+		// Wraps to [0, TWO_PI)
+		void WrapRadians(Fixed& radians);
+	}
+}
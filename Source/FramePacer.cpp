@@ -0,0 +1,84 @@
+/**************************************************************************************\
+** File: FramePacer.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the FramePacer class
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "FramePacer.h"
+
+namespace Pong
+{
+	void FramePacer::Init(const FramePacingDef& settings, bool vsync)
+	{
+		// Without vsync there is no deadline to pace against
+		m_enabled = settings.lowLatency && vsync;
+		m_safetyMargin = settings.safetyMargin;
+		m_backgroundPeriod = 1.0f / settings.backgroundFrameRate;
+		m_background = false;
+		m_secondsPerCount = 1.0 / (double)SDL_GetPerformanceFrequency();
+
+		SDL_DisplayMode displayMode;
+		float refreshRate{ DEFAULT_REFRESH_RATE };
+		if(SDL_GetCurrentDisplayMode(0, &displayMode) == 0 && displayMode.refresh_rate > 0)
+			refreshRate = (float)displayMode.refresh_rate;
+		m_refreshPeriod = 1.0f / refreshRate;
+
+		m_lastSwap = GetSeconds();
+		std::fill(std::begin(m_frameCosts), std::end(m_frameCosts), 0.0f);
+		m_nextFrameCost = 0;
+		m_missPenalty = 0.0f;
+	}
+	void FramePacer::SetBackground(bool background)
+	{
+		m_background = background;
+	}
+	void FramePacer::WaitForFrameStart()
+	{
+		// Nobody is looking, so precision doesn't matter; just don't wake often
+		if(m_background)
+		{
+			double wakeTime{ m_frameStart + m_backgroundPeriod };
+			double now{ GetSeconds() };
+			if(wakeTime > now)
+				SDL_Delay((Uint32)((wakeTime - now) * 1000.0));
+		}
+		else if(m_enabled)
+		{
+			double wakeTime{ m_lastSwap + m_refreshPeriod - GetFrameCostEstimate() - m_safetyMargin - m_missPenalty };
+			double now{ GetSeconds() };
+			if(wakeTime - now > SLEEP_GRANULARITY)
+				SDL_Delay((Uint32)((wakeTime - now - SLEEP_GRANULARITY) * 1000.0));
+			while(GetSeconds() < wakeTime)
+				;
+		}
+		m_frameStart = GetSeconds();
+	}
+	void FramePacer::MarkFrameSubmitted()
+	{
+		m_frameCosts[m_nextFrameCost] = (float)(GetSeconds() - m_frameStart);
+		m_nextFrameCost = (m_nextFrameCost + 1) % FRAME_COST_HISTORY;
+	}
+	void FramePacer::MarkFrameSwapped()
+	{
+		double now{ GetSeconds() };
+
+		// A swap more than one and a half periods after the last means we missed a vsync
+		if(now - m_lastSwap > 1.5 * m_refreshPeriod)
+			m_missPenalty = std::min(m_missPenalty + 0.1f * m_refreshPeriod, m_refreshPeriod);
+		else
+			m_missPenalty *= MISS_PENALTY_DECAY;
+		m_lastSwap = now;
+	}
+	double FramePacer::GetSeconds() const
+	{
+		return (double)SDL_GetPerformanceCounter() * m_secondsPerCount;
+	}
+	float FramePacer::GetFrameCostEstimate() const
+	{
+		return *std::max_element(std::begin(m_frameCosts), std::end(m_frameCosts));
+	}
+}
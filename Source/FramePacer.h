@@ -0,0 +1,57 @@
+/**************************************************************************************\
+** File: FramePacer.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the FramePacer class
+**
+\**************************************************************************************/
+#pragma once
+#include "AppDef.h"
+
+namespace Pong
+{
+	// Starts each frame as late as possible before the next vsync instead of
+	// right after the previous swap, so input is sampled and the scene drawn
+	// with the freshest data. The wake time is the predicted vsync minus the
+	// recent worst frame cost and a safety margin; a missed vsync widens the
+	// margin until frames land in time again.
+	// In the background, frames are simply spaced out to a low rate instead.
+	class FramePacer
+	{
+	public:
+		void Init(const FramePacingDef& settings, bool vsync);
+
+		// Call when the window loses or regains focus, or is minimized or restored
+		void SetBackground(bool background);
+		// Call before polling input
+		void WaitForFrameStart();
+		// Call right before the buffer swap
+		void MarkFrameSubmitted();
+		// Call right after the buffer swap returns
+		void MarkFrameSwapped();
+
+	private:
+		static const int FRAME_COST_HISTORY{ 32 };
+		const float DEFAULT_REFRESH_RATE{ 60.0f };
+		const float SLEEP_GRANULARITY{ 0.002f };	// Spin for the last bit, since sleeps overshoot
+		const float MISS_PENALTY_DECAY{ 0.99f };
+
+		double GetSeconds() const;
+		float GetFrameCostEstimate() const;
+
+		bool m_enabled{ false };
+		bool m_background{ false };
+		float m_backgroundPeriod{ 1.0f };
+		float m_safetyMargin{ 0.0f };
+		float m_refreshPeriod{ 1.0f / DEFAULT_REFRESH_RATE };
+		double m_secondsPerCount{ 0.0 };
+
+		double m_frameStart{ 0.0 };
+		double m_lastSwap{ 0.0 };
+		float m_frameCosts[FRAME_COST_HISTORY]{};
+		int m_nextFrameCost{ 0 };
+		float m_missPenalty{ 0.0f };
+	};
+}
@@ -9,6 +9,9 @@
 \**************************************************************************************/
 #include "pch.h"
 #include "Game.h"
+#include "Profiler.h"
+#include "Trace.h"
+#include "Audio.h"
 #include "GameInitSettings.h"
 #include "NetworkDef.h"
 #include "Exceptions.h"
@@ -17,33 +20,107 @@ using namespace Pong::GameInitSettings;
 
 namespace Pong
 {
+	//+--------------------------------\--------------------------------------
+	//|			   Buffer			   |
+	//\--------------------------------/--------------------------------------
+	void Buffer::Fail(const char* message)
+	{
+		throw GameException{ message };
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			StreamBuffer		   |
+	//\--------------------------------/--------------------------------------
+	void StreamBuffer::Reserve(int byteCount)
+	{
+		if(BytesAvailable() >= byteCount)
+			return;
+
+		// Only a partial message is left unparsed, so this moves a few bytes at most
+		int unreadBytes{ UnreadBytes() };
+		if(readIndex > 0)
+		{
+			if(unreadBytes > 0)
+				memmove(bytes.data(), bytes.data() + readIndex, unreadBytes);
+			readIndex = 0;
+			length = unreadBytes;
+		}
+
+		// A message bigger than the storage
+		if(BytesAvailable() < byteCount)
+			bytes.resize(std::max(bytes.size() * 2, (size_t)(length + byteCount)));
+	}
+	void StreamBuffer::Write(const Byte* data, int byteCount)
+	{
+		Reserve(byteCount);
+		if(byteCount > 0)
+			memcpy(FirstAvailableBytePtr(), data, byteCount);
+		length += byteCount;
+	}
+	void StreamBuffer::WriteVarUInt(unsigned value)
+	{
+		Byte encoded[MAX_VAR_UINT_BYTES];
+		int byteCount{ 0 };
+		do
+		{
+			Byte next{ (Byte)(value & 0x7F) };
+			value >>= 7;
+			encoded[byteCount++] = value ? (Byte)(next | 0x80) : next;
+		} while(value);
+		Write(encoded, byteCount);
+	}
+	void StreamBuffer::Consume(int byteCount)
+	{
+		if(byteCount < 0 || byteCount > UnreadBytes())
+			throw GameException{ "StreamBuffer::Consume: out of range" };
+		readIndex += byteCount;
+		if(readIndex == length)
+			Clear();
+	}
+	int StreamBuffer::ReadVarUInt(int index, unsigned& value) const
+	{
+		value = 0;
+		for(int i = 0; i < MAX_VAR_UINT_BYTES; ++i)
+		{
+			if(index + i >= UnreadBytes())
+				return 0;
+			Byte next{ bytes[readIndex + index + i] };
+			value |= (unsigned)(next & 0x7F) << (7 * i);
+			if(!(next & 0x80))
+				return i + 1;
+		}
+		throw GameException{ "Invalid varint: more than " + d2d::ToString(MAX_VAR_UINT_BYTES) + " bytes" };
+	}
+
 	//+--------------------------------\--------------------------------------
 	//|				Game			   |
 	//\--------------------------------/--------------------------------------
 	Game::~Game()
 	{
 		OnQuit();
+		CloseListener();
 	}
 	void Game::OnQuit()
 	{
-		// Send quit message
+		// Send quit message. After a game the peer may be waiting on a rematch.
 		if(IsNetworked() && 
-			(m_state == GameState::CONFIRM_PLAYERS_READY ||
-			m_state == GameState::COUNTDOWN || 
-			m_state == GameState::PLAY))
+			(m_match.state == GameState::CONFIRM_PLAYERS_READY ||
+			m_match.state == GameState::COUNTDOWN || 
+			m_match.state == GameState::PLAY ||
+			(m_match.state == GameState::GAME_OVER && !m_peerLeft)))
 		{
 			if(IsServer())
 			{
 				if(m_serverTimedOutWaitingForClientUDP)
-					m_outputBufferTCP.WriteByte(TCP_MESSAGE_CLIENT_INIT_UDP_TIMEOUT);
+					WriteMessageTCP(TCP_MESSAGE_CLIENT_INIT_UDP_TIMEOUT);
 				else
-					m_outputBufferTCP.WriteByte(TCP_MESSAGE_PLAYER_QUIT);
+					WriteMessageTCP(TCP_MESSAGE_PLAYER_QUIT);
 				SendNetworkData();
 			}
 			// If we are client and server timed out, don't send a quit message
 			else if(!m_serverTimedOutWaitingForClientUDP)
 			{
-				m_outputBufferTCP.WriteByte(TCP_MESSAGE_PLAYER_QUIT);
+				WriteMessageTCP(TCP_MESSAGE_PLAYER_QUIT);
 				SendNetworkData();
 			}
 		}
@@ -52,24 +129,173 @@ namespace Pong
 
 	void Game::Init()
 	{
-		m_player1.Init(Side::LEFT);
-		m_player2.Init(Side::RIGHT);
-		m_puck.ResetRound();
+		NetworkDef networkSettings;
+		if(GameInitSettings::IsNetworked())
+			networkSettings.LoadFrom("Data/network.hjson");
+		Init(GetGameMode(), networkSettings);
+	}
+	void Game::Init(GameInitSettings::Mode mode, const NetworkDef& networkSettings)
+	{
+		m_mode = mode;
+		m_networkSettings = networkSettings;
+		m_rules.LoadFrom("Data/rules.hjson");
 
+		m_match.player1.Init(Side::LEFT);
+		m_match.player2.Init(Side::RIGHT);
+		m_pucks.clear();
+		SetPuckCount(m_rules.puckCount);
+
+		if(!IsServer())
+			CloseListener();
 		if(IsNetworked())
 			InitNetwork();
 
 		if(IsServer())
-			m_state = GameState::WAIT_FOR_CLIENT_TCP_CONNECTION;
+			m_match.state = GameState::WAIT_FOR_CLIENT_TCP_CONNECTION;
+		else if(IsClient())
+			m_match.state = GameState::CONNECT_TO_SERVER;
 		else
-			m_state = GameState::CONFIRM_PLAYERS_READY;
+			m_match.state = GameState::CONFIRM_PLAYERS_READY;
 	}
 	void Game::ResetRound()
 	{
-		m_player1.ResetRound();
-		m_player2.ResetRound();
-		m_puck.ResetRound();
-		m_state = GameState::CONFIRM_PLAYERS_READY;
+		m_match.player1.ResetRound();
+		m_match.player2.ResetRound();
+		for(Puck& puck : m_pucks)
+			ServePuck(puck);
+		m_match.state = GameState::CONFIRM_PLAYERS_READY;
+	}
+	bool Game::CanRematch() const
+	{
+		// Rematches keep a network session alive; a local game is restarted from the menu
+		return IsNetworked() && m_match.state == GameState::GAME_OVER && !m_peerLeft;
+	}
+	void Game::StartRematchIfAgreed()
+	{
+		if(!m_match.player1WantsRematch || !m_match.player2WantsRematch)
+			return;
+
+		// Asking for a rematch counts as being ready, so go straight to the countdown.
+		// Sequence numbers carry on, so late packets from the last game are still ignored.
+		d2LogInfo << "Starting rematch";
+		m_match.player1.Init(Side::LEFT);
+		m_match.player2.Init(Side::RIGHT);
+		m_match.player1.SetReady();
+		m_match.player2.SetReady();
+		m_match.player1WantsRematch = false;
+		m_match.player2WantsRematch = false;
+		for(Puck& puck : m_pucks)
+			ServePuck(puck);
+		StartCountdown();
+	}
+	void Game::StartCountdown()
+	{
+		m_match.countdownSecondsLeft = INITIAL_COUNTDOWN;
+		m_match.state = GameState::COUNTDOWN;
+
+		// The client counts down to the same moment by its estimate of the server's clock
+		if(IsServer())
+		{
+			double now{ ClockSync::Now() };
+			m_countdownEndTime = now + INITIAL_COUNTDOWN;
+			Buffer payload;
+			payload.WriteUInt64(ClockSync::ToMicroseconds(m_countdownEndTime));
+			payload.WriteUInt64(ClockSync::ToMicroseconds(now));
+			WriteMessageTCP(TCP_MESSAGE_COUNTDOWN_END, payload.bytes, payload.length);
+		}
+	}
+	void Game::WriteRules()
+	{
+		Buffer payload;
+		payload.WriteFloat(m_rules.initialPuckSpeed);
+		payload.WriteFloat(m_rules.puckSpeedBoostMultiplier);
+		payload.WriteFloat(m_rules.playerMaxSpeed);
+		payload.WriteFloat(m_rules.startAngle);
+		payload.WriteFloat(m_rules.bounceAngleRange);
+		payload.WriteFloat(m_rules.maxCurvatureAngleChange);
+		payload.WriteUInt(m_rules.scoreToWin);
+		payload.WriteUInt(m_rules.puckCount);
+		WriteMessageTCP(TCP_MESSAGE_RULES, payload.bytes, payload.length);
+	}
+	void Game::ReadRules(const Byte* message, int size)
+	{
+		if(size < RULES_MESSAGE_BYTES)
+			throw GameException{ "Invalid RULES message: " + d2d::ToString(size) + " bytes" };
+
+		const Byte* fieldPtr{ message + 1 };
+		RulesDef rules;
+		for(float* valuePtr : { &rules.initialPuckSpeed, &rules.puckSpeedBoostMultiplier, &rules.playerMaxSpeed,
+			&rules.startAngle, &rules.bounceAngleRange, &rules.maxCurvatureAngleChange })
+		{
+			*valuePtr = Buffer::ReadFloat(fieldPtr);
+			fieldPtr += sizeof(float);
+		}
+		rules.scoreToWin = SDLNet_Read32(fieldPtr);
+		rules.puckCount = SDLNet_Read32(fieldPtr + sizeof(Uint32));
+		try {
+			rules.Validate();
+		}
+		catch(const SettingOutOfRangeException& e) {
+			throw GameException{ std::string{"Invalid RULES message: "} + e.what() };
+		}
+
+		// Pucks made for the local puck count go, so the client plays the server's game
+		m_rules = rules;
+		if(m_pucks.size() != m_rules.puckCount)
+		{
+			m_pucks.clear();
+			SetPuckCount(m_rules.puckCount);
+		}
+	}
+	void Game::SetPuckCount(size_t count)
+	{
+		size_t oldCount{ m_pucks.size() };
+		m_pucks.resize(count);
+		m_lastUDPPuckSequenceNums.resize(count, 0);
+		for(size_t i = oldCount; i < count; ++i)
+		{
+			m_pucks[i].SetFollowsServer(IsClient());
+			ServePuck(m_pucks[i]);
+		}
+	}
+	void Game::ServePuck(Puck& puck)
+	{
+		// Several pucks serve from random heights along the net, so they don't start on top of each other
+		if(!IsMultiPuck())
+			puck.ResetRound(m_rules);
+		else
+		{
+			b2Vec2 startPosition{ GAME_RECT.GetCenter() - 0.5f * PUCK_SIZE };
+			startPosition.y = d2d::RandomFloat({ GAME_RECT.lowerBound.y, GAME_RECT.upperBound.y - PUCK_SIZE.y });
+			puck.ResetRound(m_rules, startPosition, IsClient() ? 0.0f : Puck::GetRandomStartAngle(m_rules));
+		}
+	}
+	void Game::HandlePuckCollisions()
+	{
+		m_puckGrid.Build(m_pucks);
+		m_puckGrid.FindOverlappingPairs(m_pucks, m_puckPairs);
+		for(const PuckGrid::Pair& pair : m_puckPairs)
+			m_pucks[pair.first].HandlePuckCollision(m_pucks[pair.second]);
+	}
+	bool Game::IsMultiPuck() const
+	{
+		return m_pucks.size() > 1;
+	}
+	void Game::SetNetworkObserver(NetworkObserver* observerPtr)
+	{
+		m_networkObserverPtr = observerPtr;
+	}
+	bool Game::IsClient() const
+	{
+		return m_mode == Mode::CLIENT;
+	}
+	bool Game::IsServer() const
+	{
+		return m_mode == Mode::SERVER;
+	}
+	bool Game::IsNetworked() const
+	{
+		return m_mode == Mode::CLIENT || m_mode == Mode::SERVER;
 	}
 
 	void Game::InitNetwork()
@@ -80,13 +306,21 @@ namespace Pong
 
 		// Make sure we start fresh
 		CloseNetwork();
+		m_networkStartTicks = SDL_GetTicks();
+		m_peerLeft = false;
 
-		// Get our IP addresses and port numbers from file
-		m_networkSettings.LoadFrom("Data\\network.hjson");
+		// Received datagrams land straight in the input buffers
+		for(int i = 0; i < UDP_RECEIVE_BATCH; ++i)
+		{
+			m_inputPacketsUDP[i] = {};
+			m_inputPacketsUDP[i].data = m_inputBuffersUDP[i].FirstBytePtr();
+			m_inputPacketsUDP[i].maxlen = BUFFER_SIZE;
+		}
 
-		// Allocate memory for socket set
+		// Allocate memory for socket set. A server keeps its listening socket in
+		// the set next to the client's, to turn away anyone else who connects.
 		SDLNet_SetError("");
-		m_socketSet = SDLNet_AllocSocketSet(1);
+		m_socketSet = SDLNet_AllocSocketSet(IsServer() ? 2 : 1);
 		if(!m_socketSet)
 			throw GameException{ std::string{"Unable to allocate socket set: "} +SDLNet_GetError() };
 
@@ -95,10 +329,7 @@ namespace Pong
 		{
 			// Open local UDP port
 			d2LogInfo << "Attempting to open UDP port " << m_networkSettings.serverPort;
-			SDLNet_SetError("");
-			if(!(m_clientSocketUDP = SDLNet_UDP_Open(m_networkSettings.serverPort)))
-				throw GameException{ std::string{"UDP: Failed to open port "} +
-					d2d::ToString(m_networkSettings.serverPort) + ": " + SDLNet_GetError() };
+			m_socketUDP.Open(m_networkSettings.serverPort);
 			d2LogInfo << "Opened UDP port " << m_networkSettings.serverPort;
 
 
@@ -107,10 +338,21 @@ namespace Pong
 			if(SDLNet_ResolveHost(&myIP, nullptr, m_networkSettings.serverPort) != 0)
 				throw GameException{ std::string{"Failed to resolve local port "} +d2d::ToString(m_networkSettings.serverPort) + ": " + SDLNet_GetError() };
 
-			// Open port
-			d2LogInfo << "Attempting to open TCP port " << m_networkSettings.serverPort;
-			if(!(m_serverSocketTCP = SDLNet_TCP_Open(&myIP)))
-				throw GameException{ std::string{"TCP: Failed to open port "} +d2d::ToString(m_networkSettings.serverPort) + " for listening: " + SDLNet_GetError() };
+			// Open port, unless it's still open from the last game. A client that connected
+			// in between is already waiting to be accepted.
+			// SDLNet_TCP_Open disables Nagle's algorithm (TCP_NODELAY), and sockets accepted
+			// from it inherit that, so small messages go out without waiting for ACKs.
+			if(m_serverSocketTCP && m_listeningPort != m_networkSettings.serverPort)
+				CloseListener();
+			if(m_serverSocketTCP)
+				d2LogInfo << "Reusing listening TCP port " << m_listeningPort;
+			else
+			{
+				d2LogInfo << "Attempting to open TCP port " << m_networkSettings.serverPort;
+				if(!(m_serverSocketTCP = SDLNet_TCP_Open(&myIP)))
+					throw GameException{ std::string{"TCP: Failed to open port "} +d2d::ToString(m_networkSettings.serverPort) + " for listening: " + SDLNet_GetError() };
+				m_listeningPort = m_networkSettings.serverPort;
+			}
 
 			// Add server socket to set so we don't have to block while waiting for client
 			if(SDLNet_TCP_AddSocket(m_socketSet, m_serverSocketTCP) == -1)
@@ -120,100 +362,138 @@ namespace Pong
 			d2LogInfo << "Opened TCP port " << d2d::GetPort(myIP) << ". Waiting for client connection...";
 		}
 
-		// Client: connect to server
+		// Client: connect to server in the background, so frames keep coming while
+		// the host resolves and the server accepts. UpdateConnectToServer takes it from here.
 		else
 		{
-			d2LogInfo << "Attempting to connect to " << m_networkSettings.serverIP << " TCP port " << m_networkSettings.serverPort;
+			m_connectAttempt = 0;
+			StartConnectAttempt();
+		}
 
-			// Get proper host format
-			IPaddress serverIP;
-			SDLNet_SetError("");
-			if(SDLNet_ResolveHost(&serverIP, m_networkSettings.serverIP.c_str(), m_networkSettings.serverPort) != 0)
-				throw GameException{ std::string{"Failed to resolve host "} +m_networkSettings.serverIP +
-					" Port " + d2d::ToString(m_networkSettings.serverPort) + ": " + SDLNet_GetError() };
+		// Reset UDP sequence numbers
+		m_nextUDPSequenceNum = 0;
+		m_droppedSendsUDP = 0;
+		std::fill(m_lastUDPPuckSequenceNums.begin(), m_lastUDPPuckSequenceNums.end(), 0);
+		m_lastUDPPlayerSequenceNum = 0;
+		m_snapshotHistory.Clear();
+		m_hasSnapshotAck = false;
+		m_clockSync.Reset();
+		m_lastTimeRequestTime = 0.0;
+		m_hasCountdownEnd = false;
+	}
+	void Game::StartConnectAttempt()
+	{
+		++m_connectAttempt;
+		m_connectAttemptTime = 0.0f;
+		d2LogInfo << "Attempting to connect to " << m_networkSettings.serverIP << " TCP port " << m_networkSettings.serverPort
+			<< " (attempt " << m_connectAttempt << " of " << m_networkSettings.connectAttempts << ")";
+		m_connector.Start(m_networkSettings.serverIP, (Uint16)m_networkSettings.serverPort);
+	}
+	void Game::UpdateConnectToServer(float dt)
+	{
+		m_connectAttemptTime += dt;
+		std::string error;
+		switch(m_connector.GetStatus())
+		{
+		case TcpConnector::Status::CONNECTED:
+			FinishConnectToServer();
+			return;
 
-			// Connect to server's open port
-			if(!(m_clientSocketTCP = SDLNet_TCP_Open(&serverIP)))
-				throw GameException{ std::string{"TCP: Failed to connect to port "} +d2d::ToString(m_networkSettings.serverPort) +
-					" at " + m_networkSettings.serverIP + ": " + SDLNet_GetError() };
+		case TcpConnector::Status::RESOLVING:
+		case TcpConnector::Status::CONNECTING:
+			if(m_connectAttemptTime < m_networkSettings.connectTimeoutSeconds)
+				return;
+			error = "Timed out after " + d2d::ToString(m_networkSettings.connectTimeoutSeconds) + " seconds while " +
+				(m_connector.GetStatus() == TcpConnector::Status::RESOLVING ? "resolving host" : "connecting");
 
-			// Print out the server's IP and port
-			d2LogInfo << d2d::GetIPOctetsString(serverIP) << " port " << d2d::GetPort(serverIP)
-				<< " accepted a TCP connection";
+			// The connect can't be cancelled, and starting another alongside it would leave
+			// the server with an extra connection if both get through. Keep waiting on it as
+			// the next attempt instead, so a late connection is still used.
+			if(m_connectAttempt < m_networkSettings.connectAttempts)
+			{
+				d2LogWarning << "Connect attempt " << m_connectAttempt << " failed: " << error << ", still waiting on it";
+				++m_connectAttempt;
+				m_connectAttemptTime = 0.0f;
+				return;
+			}
+			break;
 
-			// Add client socket to set so we don't have to block to send/receive
-			SDLNet_SetError("");
-			if(SDLNet_TCP_AddSocket(m_socketSet, m_clientSocketTCP) == -1)
-				throw GameException{ std::string{"Failed to add client TCP socket to socket set: "} +SDLNet_GetError() };
+		case TcpConnector::Status::FAILED:
+			error = m_connector.GetError();
+			break;
 
-			// Open local UDP port
-			d2LogInfo << "Attempting to open any available UDP port";
-			SDLNet_SetError("");
-			if(!(m_clientSocketUDP = SDLNet_UDP_Open(0)))
-				throw GameException{ std::string{"UDP: Failed to open any available port: "} + SDLNet_GetError() };
-			d2LogInfo << "Opened a UDP port";
+		case TcpConnector::Status::IDLE:
+			// Waiting to retry
+			if(m_connectAttemptTime >= m_networkSettings.connectRetryDelaySeconds)
+				StartConnectAttempt();
+			return;
+		}
 
-			// Allocate in/out UDP packets
-			if(!(m_inputUDPPacketPtr = SDLNet_AllocPacket(BUFFER_SIZE)))
-				throw GameException{ "Failed to allocate input UDP packet: Out of memory" };
-			if(!(m_outputUDPPacketPtr = SDLNet_AllocPacket(BUFFER_SIZE)))
-				throw GameException{ "Failed to allocate output UDP packet: Out of memory" };
+		// This attempt failed
+		d2LogWarning << "Connect attempt " << m_connectAttempt << " failed: " << error;
+		if(m_connectAttempt >= m_networkSettings.connectAttempts)
+			throw GameException{ "Failed to connect to " + m_networkSettings.serverIP + " port " + d2d::ToString(m_networkSettings.serverPort) +
+				" after " + d2d::ToString(m_connectAttempt) + " attempts: " + error };
+		m_connector.Abandon();
+		m_connectAttemptTime = 0.0f;
+	}
+	void Game::FinishConnectToServer()
+	{
+		IPaddress serverIP{ m_connector.GetAddress() };
+		m_clientSocketTCP = m_connector.TakeSocket();
 
-			// Set address of outgoing UDP packets
-			m_outputUDPPacketPtr->address = serverIP;
+		// Print out the server's IP and port, and where the time went
+		d2LogInfo << d2d::GetIPOctetsString(serverIP) << " port " << d2d::GetPort(serverIP)
+			<< " accepted a TCP connection " << SDL_GetTicks() - m_networkStartTicks << " ms after start (attempt " << m_connectAttempt
+			<< ": resolve " << m_connector.GetResolveMilliseconds() << " ms, connect " << m_connector.GetConnectMilliseconds() << " ms)";
+		m_connector.Abandon();
 
-			// Start sending out initial UDP message so server can get our UDP port
-			m_serverWaitingForClientUDP = true;
-			m_serverTimedOutWaitingForClientUDP = false;
+		// Add client socket to set so we don't have to block to send/receive
+		SDLNet_SetError("");
+		if(SDLNet_TCP_AddSocket(m_socketSet, m_clientSocketTCP) == -1)
+			throw GameException{ std::string{"Failed to add client TCP socket to socket set: "} +SDLNet_GetError() };
 
-			d2LogInfo << "Address of outgoing UDP packets set to "
-				<< d2d::GetIPOctetsString(serverIP) << " port " << d2d::GetPort(serverIP);
-		}
+		// Open local UDP port
+		d2LogInfo << "Attempting to open any available UDP port";
+		m_socketUDP.Open(0);
+		d2LogInfo << "Opened a UDP port";
 
-		// Reset UDP sequence numbers
-		m_nextUDPSequenceNum = 0;
-		m_lastUDPCountdownSequenceNum = 0;
-		m_lastUDPPuckSequenceNum = 0;
-		m_lastUDPPlayerSequenceNum = 0;
+		// Set address of outgoing UDP packets
+		m_peerAddressUDP = serverIP;
+
+		// Start sending out initial UDP message so server can get our UDP port
+		m_serverWaitingForClientUDP = true;
+		m_serverTimedOutWaitingForClientUDP = false;
+
+		d2LogInfo << "Address of outgoing UDP packets set to "
+			<< d2d::GetIPOctetsString(serverIP) << " port " << d2d::GetPort(serverIP);
+
+		m_match.state = GameState::CONFIRM_PLAYERS_READY;
 	}
 	void Game::CloseNetwork()
 	{
+		m_connector.Abandon();
+
 		// Clear the message queue
 		m_inputBufferTCP.Clear();
 		m_outputBufferTCP.Clear();
-		m_inputBufferUDP.Clear();
-		m_outputBufferUDP.Clear();
-
-		// Delete UDP packets
-		if(m_inputUDPPacketPtr)
-		{
-			SDLNet_FreePacket(m_inputUDPPacketPtr);
-			m_inputUDPPacketPtr = nullptr;
-		}
-		if(m_outputUDPPacketPtr)
-		{
-			SDLNet_FreePacket(m_outputUDPPacketPtr);
-			m_outputUDPPacketPtr = nullptr;
-		}
+		for(Buffer& buffer : m_inputBuffersUDP)
+			buffer.Clear();
+		for(Buffer& buffer : m_outputBuffersUDP)
+			buffer.Clear();
+		m_outputBufferUDPIndex = 0;
+		m_peerAddressUDP = {};
 
 		// Remove sockets from set, close sockets, and free socket set
-		if(m_serverSocketTCP)
-		{
+		if(m_serverSocketTCP && m_socketSet)
 			SDLNet_TCP_DelSocket(m_socketSet, m_serverSocketTCP);
-			SDLNet_TCP_Close(m_serverSocketTCP);
-			m_serverSocketTCP = nullptr;
-		}
 		if(m_clientSocketTCP)
 		{
 			SDLNet_TCP_DelSocket(m_socketSet, m_clientSocketTCP);
 			SDLNet_TCP_Close(m_clientSocketTCP);
 			m_clientSocketTCP = nullptr;
 		}
-		if(m_clientSocketUDP)
-		{
-			SDLNet_UDP_Close(m_clientSocketUDP);
-			m_clientSocketUDP = nullptr;
-		}
+		m_socketUDP.Close();
 		if(m_socketSet)
 		{
 			SDLNet_FreeSocketSet(m_socketSet);
@@ -221,292 +501,300 @@ namespace Pong
 		}
 	}
 
+	void Game::CloseListener()
+	{
+		if(m_serverSocketTCP)
+		{
+			if(m_socketSet)
+				SDLNet_TCP_DelSocket(m_socketSet, m_serverSocketTCP);
+			SDLNet_TCP_Close(m_serverSocketTCP);
+			m_serverSocketTCP = nullptr;
+			m_listeningPort = 0;
+		}
+	}
+	void Game::RefuseExtraClient()
+	{
+		// Accepting and closing at once fails the other client's connection right
+		// away, instead of leaving it in the backlog for as long as this game lasts
+		TCPsocket extraSocketTCP{ SDLNet_TCP_Accept(m_serverSocketTCP) };
+		if(!extraSocketTCP)
+			return;
+		IPaddress* addressPtr{ SDLNet_TCP_GetPeerAddress(extraSocketTCP) };
+		if(addressPtr)
+			d2LogInfo << "Refused a TCP connection from " << d2d::GetIPOctetsString(*addressPtr)
+				<< " port " << d2d::GetPort(*addressPtr) << ", already connected to a client";
+		SDLNet_TCP_Close(extraSocketTCP);
+	}
+
 	void Game::Player1PressedAButton()
 	{
-		if(m_state == GameState::CONFIRM_PLAYERS_READY && !IsClient())
+		if(m_match.state == GameState::CONFIRM_PLAYERS_READY && !IsClient())
 		{
-			m_player1.SetReady();
+			m_match.player1.SetReady();
 			if(IsServer())
-				m_outputBufferTCP.WriteByte(TCP_MESSAGE_PLAYER_READY);
+				WriteMessageTCP(TCP_MESSAGE_PLAYER_READY);
+		}
+		else if(CanRematch() && !IsClient() && !m_match.player1WantsRematch)
+		{
+			m_match.player1WantsRematch = true;
+			if(IsServer())
+				WriteMessageTCP(TCP_MESSAGE_REMATCH);
+			StartRematchIfAgreed();
 		}
 	}
 	void Game::Player2PressedAButton()
 	{
-		if(m_state == GameState::CONFIRM_PLAYERS_READY && !IsServer())
+		if(m_match.state == GameState::CONFIRM_PLAYERS_READY && !IsServer())
+		{
+			m_match.player2.SetReady();
+			if(IsClient())
+				WriteMessageTCP(TCP_MESSAGE_PLAYER_READY);
+		}
+		else if(CanRematch() && !IsServer() && !m_match.player2WantsRematch)
 		{
-			m_player2.SetReady();
+			m_match.player2WantsRematch = true;
 			if(IsClient())
-				m_outputBufferTCP.WriteByte(TCP_MESSAGE_PLAYER_READY);
+				WriteMessageTCP(TCP_MESSAGE_REMATCH);
+			StartRematchIfAgreed();
 		}
 	}
 	void Game::SetPlayer1MovementFactor(float factor)
 	{
-		m_player1.SetMovementFactor(factor);
+		m_match.player1.SetMovementFactor(factor);
 	}
 	void Game::SetPlayer2MovementFactor(float factor)
 	{
-		m_player2.SetMovementFactor(factor);
+		m_match.player2.SetMovementFactor(factor);
 	}
 
-	void Game::Draw() const
+	void Game::WriteSnapshot(Snapshot& snapshot) const
 	{
-		b2Vec2 gameDim{ GAME_RECT.GetWidth(), GAME_RECT.GetHeight() };
-		{
-			b2Vec2 deadSpace;
-			{
-				float gameAspectRatio{ gameDim.x / gameDim.y };
-				float screenAspectRatio{ d2d::Window::GetXYAspectRatio() };
-
-				// Fill as much of screen as possible while maintaining game aspect ratio
-				if(screenAspectRatio > gameAspectRatio)
-				{
-					// Screen will be wider than game
-					float cameraWidth{ screenAspectRatio * gameDim.y };
-					deadSpace.Set(0.5f * (cameraWidth - gameDim.x), 0.0f);
-				}
-				else
-				{
-					// Screen will be taller than or equal to the game
-					float cameraHeight{ gameDim.x / screenAspectRatio };
-					deadSpace.Set(0.0f, 0.5f * (cameraHeight - gameDim.y));
-				}
-			}
-			d2d::Window::SetCameraRect(
-				{ GAME_RECT.lowerBound - deadSpace,
-				  GAME_RECT.upperBound + deadSpace });
-		}
-
-		d2d::Window::DisableTextures();
-		d2d::Window::EnableBlending();
-
-		// Draw game objects
-		m_player1.Draw();
-		m_player2.Draw();
-		m_puck.Draw();
-
-		// Draw game border
+		snapshot.state = m_match.state;
+		snapshot.countdownSecondsLeft = m_match.countdownSecondsLeft;
+		snapshot.connectAttempt = m_connectAttempt;
+		snapshot.canRematch = CanRematch();
+		for(Snapshot::PlayerView* viewPtr : { &snapshot.player1, &snapshot.player2 })
 		{
-			d2d::Rect gameDrawRect;
-			gameDrawRect.SetCenter(GAME_RECT.GetCenter(), SLIGHTLY_LESS_THAN_ONE * gameDim);
-			d2d::Window::DrawRect(gameDrawRect, false);
+			const Player& player{ viewPtr == &snapshot.player1 ? m_match.player1 : m_match.player2 };
+			viewPtr->position = player.GetPosition();
+			viewPtr->score = player.GetScore();
+			viewPtr->side = player.GetSide();
+			viewPtr->isReady = player.IsReady();
+			viewPtr->wantsRematch = viewPtr == &snapshot.player1 ? m_match.player1WantsRematch : m_match.player2WantsRematch;
 		}
 
-		// Draw net
-		{
-			b2Vec2 middleBottom{ GAME_RECT.GetCenter().x, GAME_RECT.lowerBound.y };
-			b2Vec2 middleTop{ middleBottom.x, GAME_RECT.upperBound.y };
-			d2d::Window::DrawLine(middleBottom, middleTop);
-		}
-
-		// Draw text
+		// Reuses the snapshot's capacity, so this only allocates when the puck count grows
+		snapshot.puckPositions.resize(m_pucks.size());
+		for(size_t i = 0; i < m_pucks.size(); ++i)
+			snapshot.puckPositions[i] = m_pucks[i].GetDrawPosition();
+	}
+	void Game::SaveState(SavedState& saved) const
+	{
+		saved.match = m_match;
+		saved.pucks = m_pucks;
+	}
+	void Game::LoadState(const SavedState& saved)
+	{
+		if(saved.pucks.size() != m_pucks.size())
+			SetPuckCount(saved.pucks.size());
+		m_match = saved.match;
+		m_pucks = saved.pucks;
+	}
+	size_t Game::GetMemoryBytes() const
+	{
+		return sizeof(*this) +
+			m_pucks.capacity() * sizeof(Puck) +
+			m_puckGrid.GetHeapBytes() +
+			m_puckPairs.capacity() * sizeof(PuckGrid::Pair) +
+			m_lastUDPPuckSequenceNums.capacity() * sizeof(unsigned) +
+			m_snapshotHistory.GetHeapBytes() +
+			m_predictedPucks.capacity() * sizeof(SnapshotDelta::PuckState) +
+			m_outputBuffersUDP.capacity() * sizeof(Buffer) +
+			m_outputPacketsUDP.capacity() * sizeof(UDPpacket);
+	}
+	const ClockSync& Game::GetClockSync() const
+	{
+		return m_clockSync;
+	}
+	bool Game::TakeNotice(Notice& notice)
+	{
+		if(!m_hasNotice)
+			return false;
+		notice = m_notice;
+		m_hasNotice = false;
+		return true;
+	}
+	void Game::PostNotice(Uint32 messageBoxFlags, const std::string& title, const std::string& text)
+	{
+		d2LogInfo << title << ": " << text;
+		m_notice.messageBoxFlags = messageBoxFlags;
+		m_notice.title = title;
+		m_notice.text = text;
+		m_hasNotice = true;
+	}
+	bool Game::IsWaitingForPeer() const
+	{
+		return m_match.state == GameState::WAIT_FOR_CLIENT_TCP_CONNECTION && m_socketSet != nullptr;
+	}
+	void Game::WaitForPeer(float maxSeconds)
+	{
+		// Only checks; UpdateWaitForClientTCPConnection accepts
+		errno = 0;
+		SDLNet_SetError("");
+		if(SDLNet_CheckSockets(m_socketSet, (Uint32)(maxSeconds * 1000.0f)) == -1)
+			throw GameException{ std::string{"Failed to check sockets: "} +
+				SDLNet_GetError() + (errno ? " (errno = " + d2d::ToString(errno) + ")" : "") };
+	}
+	void Game::Update(float dt)
+	{
+		TraceScope trace{ "Game::Update" };
+		m_tickSeconds = dt;
 		{
-			switch(m_state)
+			ScopedTimer timer{ ProfilePhase::UPDATE };
+			switch(m_match.state)
 			{
+			case GameState::CONNECT_TO_SERVER:
+				UpdateConnectToServer(dt);
+				break;
 			case GameState::WAIT_FOR_CLIENT_TCP_CONNECTION:
-				d2d::Window::PushMatrix();
-				d2d::Window::SetColor(m_waitingForPlayerTextStyle.color);
-				d2d::Window::Translate(m_waitingForPlayerLeftPosition);
-				d2d::Window::DrawString(m_waitingForClientText, m_waitingForPlayerLeftAlignment,
-					m_waitingForPlayerTextStyle.size, m_waitingForPlayerTextStyle.font);
-				d2d::Window::PopMatrix();
+				UpdateWaitForClientTCPConnection(dt);
 				break;
 			case GameState::CONFIRM_PLAYERS_READY:
-				if(!m_player1.IsReady())
-					DrawWaitingMessage(m_player1);
-				if(!m_player2.IsReady())
-					DrawWaitingMessage(m_player2);
+				UpdateConfirmPlayersReady(dt);
 				break;
 			case GameState::COUNTDOWN:
-				DrawCountdown();
+				UpdateCountdown(dt);
 				break;
-			case GameState::GAME_OVER:
-				DrawPlayerResult(m_player1.GetSide(), m_player1.GetScore() > m_player2.GetScore());
-				DrawPlayerResult(m_player2.GetSide(), m_player2.GetScore() > m_player1.GetScore());
+			case GameState::PLAY:
+				UpdatePlay(dt);
 				break;
+			case GameState::GAME_OVER:
 			case GameState::GAME_OVER_DEFAULT_WIN:
-				DrawPlayerResult(m_player1.GetSide(), IsServer() ? true : false);
-				DrawPlayerResult(m_player2.GetSide(), IsServer() ? false : true);
+				break;
+			default:
 				break;
 			}
-			DrawScore(m_player1);
-			DrawScore(m_player2);
-
-			// Draw FPS
-			d2d::Window::PushMatrix();
-			d2d::Window::Translate(m_fpsPosition);
-			d2d::Window::SetColor(m_fpsTextStyle.color);
-			d2d::Window::DrawString(d2d::ToString((int)(d2d::Window::GetFPS() + 0.5f)), m_fpsAlignment,
-				m_fpsTextStyle.size, m_fpsTextStyle.font);
-			d2d::Window::PopMatrix();
 		}
-	}
-	void Game::DrawPlayerResult(Side playerSide, bool isWinner) const
-	{
-		const std::string& resultText{ isWinner ? m_playerWinsText : m_playerLosesText };
-		const d2d::TextStyle& resultTextStyle{ isWinner ? m_playerWinsTextStyle : m_playerLosesTextStyle };
 
-		d2d::Window::PushMatrix();
-		d2d::Window::SetColor(resultTextStyle.color);
-		if(playerSide == Side::LEFT && !IsClient())
-		{
-			d2d::Window::Translate(m_playerResultLeftPosition);
-			d2d::Window::DrawString(resultText, m_playerResultLeftAlignment,
-				resultTextStyle.size, resultTextStyle.font);
-		}
-		else if(playerSide == Side::RIGHT && !IsServer())
+		// Process network input/output. The connection stays up after a game for a rematch.
+		if(IsNetworked() &&
+			(m_match.state == GameState::CONFIRM_PLAYERS_READY ||
+			m_match.state == GameState::COUNTDOWN ||
+			m_match.state == GameState::PLAY ||
+			(m_match.state == GameState::GAME_OVER && !m_peerLeft)))
 		{
-			d2d::Window::Translate(m_playerResultRightPosition);
-			d2d::Window::DrawString(resultText, m_playerResultRightAlignment,
-				resultTextStyle.size, resultTextStyle.font);
+			ScopedTimer timer{ ProfilePhase::NETWORK };
+			CheckMessages();
+			if(IsClient())
+				WriteTimeRequest();
+			SendNetworkData();
 		}
-		d2d::Window::PopMatrix();
 	}
-	void Game::DrawCountdown() const
+	void Game::SendNetworkData()
 	{
-		int countdownInt = (int)(m_countdownSecondsLeft + SLIGHTLY_LESS_THAN_ONE);
-		if(countdownInt > 0)
-		{
-			d2d::Window::PushMatrix();
-			d2d::Window::Translate(m_countdownPosition);
-			d2d::Window::SetColor(m_countdownTextStyle.color);
-			d2d::Window::DrawString(d2d::ToString(countdownInt), m_countdownAlignment,
-				m_countdownTextStyle.size, m_countdownTextStyle.font);
-			d2d::Window::PopMatrix();
-		}
+		TraceScope trace{ "Game::SendNetworkData" };
+		SendDataTCP();
+		SendDataUDP();
 	}
-	void Game::DrawScore(const Player& player) const
+	void Game::SendDataTCP()
 	{
-		std::string scoreText{ d2d::ToString(player.GetScore()) };
-
-		d2d::Window::PushMatrix();
-		d2d::Window::SetColor(m_scoreTextStyle.color);
-		if(player.GetSide() == Side::LEFT)
+		int unsentBytes{ m_outputBufferTCP.UnreadBytes() };
+		if(unsentBytes > 0 && m_clientSocketTCP)
 		{
-			d2d::Window::Translate(m_scoreLeftPosition);
-			d2d::Window::DrawString(scoreText, m_scoreLeftAlignment,
-				m_scoreTextStyle.size, m_scoreTextStyle.font);
-		}
-		else
-		{
-			d2d::Window::Translate(m_scoreRightPosition);
-			d2d::Window::DrawString(scoreText, m_scoreRightAlignment,
-				m_scoreTextStyle.size, m_scoreTextStyle.font);
+			SDLNet_SetError("");
+			int bytesSent = SDLNet_TCP_Send(m_clientSocketTCP, m_outputBufferTCP.FirstUnreadBytePtr(), unsentBytes);
+			if(bytesSent > 0)
+				m_outputBufferTCP.Consume(bytesSent);
+
+			// The rest stays queued and goes out with the next send. A peer that has
+			// disconnected is noticed on the receive side.
+			if(bytesSent < unsentBytes)
+			{
+				d2LogWarning << "Short TCP send, " << m_outputBufferTCP.UnreadBytes() << " bytes left queued: " << SDLNet_GetError();
+				if(m_outputBufferTCP.UnreadBytes() > MAX_TCP_QUEUED_BYTES)
+					throw GameException{ "Failed to send TCP data: " + d2d::ToString(m_outputBufferTCP.UnreadBytes()) +
+						" bytes queued: " + SDLNet_GetError() };
+			}
 		}
-		d2d::Window::PopMatrix();
 	}
-	void Game::DrawWaitingMessage(const Player& player) const
+	void Game::WriteMessageTCP(Byte messageType, const Byte* payload, int payloadSize)
 	{
-		d2d::Window::PushMatrix();
-		d2d::Window::SetColor(m_waitingForPlayerTextStyle.color);
-		if(player.GetSide() == Side::LEFT)
-		{
-			// Different text for remote player
-			const std::string& textRef = IsClient() ? m_waitingForRemotePlayerText : m_waitingForPlayerLeftText;
-			d2d::Window::Translate(m_waitingForPlayerLeftPosition);
-			d2d::Window::DrawString(textRef, m_waitingForPlayerLeftAlignment,
-				m_waitingForPlayerTextStyle.size, m_waitingForPlayerTextStyle.font);
-		}
-		else
-		{
-			// Different text for remote player
-			const std::string& textRef = IsServer() ? m_waitingForRemotePlayerText : m_waitingForPlayerRightText;
-			d2d::Window::Translate(m_waitingForPlayerRightPosition);
-			d2d::Window::DrawString(textRef, m_waitingForPlayerRightAlignment,
-				m_waitingForPlayerTextStyle.size, m_waitingForPlayerTextStyle.font);
-		}
-		d2d::Window::PopMatrix();
+		m_outputBufferTCP.WriteVarUInt((unsigned)(1 + payloadSize));
+		m_outputBufferTCP.Write(&messageType, 1);
+		m_outputBufferTCP.Write(payload, payloadSize);
 	}
-
-	void Game::Update(float dt)
+	void Game::SendDataUDP()
 	{
-		switch(m_state)
-		{
-		case GameState::WAIT_FOR_CLIENT_TCP_CONNECTION:
-			UpdateWaitForClientTCPConnection(dt);
-			break;
-		case GameState::CONFIRM_PLAYERS_READY:
-			UpdateConfirmPlayersReady(dt);
-			break;
-		case GameState::COUNTDOWN:
-			UpdateCountdown(dt);
-			break;
-		case GameState::PLAY:
-			UpdatePlay(dt);
-			break;
-		case GameState::GAME_OVER:
-		case GameState::GAME_OVER_DEFAULT_WIN:
-			break;
-		default:
-			break;
-		}
+		if(!m_socketUDP.IsOpen())
+			return;
 
-		// Process network input/output
-		if(IsNetworked() &&
-			(m_state == GameState::CONFIRM_PLAYERS_READY ||
-			m_state == GameState::COUNTDOWN ||
-			m_state == GameState::PLAY))
+		// Every datagram written this frame goes out in one batch
+		size_t packetCount{ m_outputBufferUDPIndex + (GetOutputBufferUDP().length > 0 ? 1 : 0) };
+		if(packetCount == 0)
+			return;
+		m_outputPacketsUDP.resize(m_outputBuffersUDP.size());
+		for(size_t i = 0; i < packetCount; ++i)
 		{
-			CheckMessages();
-			SendNetworkData();
+			UDPpacket& packet{ m_outputPacketsUDP[i] };
+			packet.data = m_outputBuffersUDP[i].FirstBytePtr();
+			packet.len = m_outputBuffersUDP[i].length;
+			packet.address = m_peerAddressUDP;
 		}
-	}
-	void Game::SendNetworkData()
-	{
-		if(m_outputBufferTCP.length > 0)
+		int sentCount{ m_socketUDP.Send(m_outputPacketsUDP.data(), (int)packetCount) };
+		if(sentCount < (int)packetCount)
 		{
-			if(m_clientSocketTCP)
-			{
-				SDLNet_SetError("");
-				int bytesSent = SDLNet_TCP_Send(m_clientSocketTCP, m_outputBufferTCP.bytes, m_outputBufferTCP.length);
-				if(bytesSent < m_outputBufferTCP.length)
-					throw GameException{ std::string{"Failed to send TCP data: "} +d2d::ToString(m_outputBufferTCP.length) +
-						" bytes attempted, " + d2d::ToString(bytesSent) + " bytes successfully sent: " + SDLNet_GetError() };
-				m_outputBufferTCP.Clear();
-			}
+			// A full send buffer loses datagrams like the network does; later snapshots make up for them
+			m_droppedSendsUDP += (unsigned)packetCount - (unsigned)sentCount;
+			d2LogWarning << "UDP send buffer full, dropped " << packetCount - sentCount << " datagrams ("
+				<< m_droppedSendsUDP << " so far)";
 		}
-		if(m_outputBufferUDP.length > 0)
-		{
-			if(m_clientSocketUDP && m_outputUDPPacketPtr)
-			{
-				// Copy buffer to packet
-				memcpy(m_outputUDPPacketPtr->data, m_outputBufferUDP.FirstBytePtr(), m_outputBufferUDP.length);
-				m_outputUDPPacketPtr->len = m_outputBufferUDP.length;
 
-				// Send packet
-				SDLNet_SetError("");
-				int packetsSent = SDLNet_UDP_Send(m_clientSocketUDP, -1, m_outputUDPPacketPtr);
-				if(packetsSent < 1)
-					throw GameException{ std::string{"Failed to send UDP packet of "} +d2d::ToString(m_outputBufferUDP.length) +
-						" bytes: " + SDLNet_GetError() };
-				m_outputBufferUDP.Clear();
-			}
-		}
+		for(size_t i = 0; i < packetCount; ++i)
+			m_outputBuffersUDP[i].Clear();
+		m_outputBufferUDPIndex = 0;
+	}
+	Buffer& Game::GetOutputBufferUDP()
+	{
+		return m_outputBuffersUDP[m_outputBufferUDPIndex];
+	}
+	void Game::StartNextOutputBufferUDP()
+	{
+		// Grows only the first time a frame needs this many datagrams
+		if(++m_outputBufferUDPIndex == m_outputBuffersUDP.size())
+			m_outputBuffersUDP.emplace_back();
 	}
 	void Game::CheckMessages()
 	{
-		// UDP messages
-		while(GetDataUDP())
+		TraceScope trace{ "Game::CheckMessages" };
+		// UDP messages, a batch per system call. Taking less than a batch off the
+		// socket means nothing else is waiting, even if some were dropped.
+		int packetCount{ 0 };
+		int drainedCount{ 0 };
+		do
 		{
-			if(m_inputBufferUDP.IsOverflowing())
-				throw GameException{ "Buffer overflow error" };
-			if(m_inputBufferUDP.length > 0)
-				ProcessMessagesUDP(m_inputBufferUDP);
-		}
+			packetCount = GetDataUDP(drainedCount);
+			for(int i = 0; i < packetCount; ++i)
+			{
+				if(m_inputBuffersUDP[i].IsOverflowing())
+					throw GameException{ "Buffer overflow error" };
+				if(m_inputBuffersUDP[i].length > 0)
+					ProcessMessagesUDP(m_inputBuffersUDP[i], m_inputReceiveTimesUDP[i]);
+			}
+		} while(drainedCount >= UDP_RECEIVE_BATCH);
 
 		// TCP messages
 		while(TCPReady())
 		{
 			GetDataTCP();
-			if(m_inputBufferTCP.IsOverflowing())
-				throw GameException{ "Buffer overflow error" };
-			if(m_inputBufferTCP.length > 0)
-				ProcessMessagesTCP(m_inputBufferTCP);
-			if(m_inputBufferTCP.IsFull())
-				throw GameException{ "Buffer full error: Increase buffer size to accomodate largest message length" };
-
-			if(m_state == GameState::GAME_OVER || m_state == GameState::GAME_OVER_DEFAULT_WIN)
+			ProcessMessagesTCP(m_inputBufferTCP);
+
+			if(m_match.state == GameState::GAME_OVER || m_match.state == GameState::GAME_OVER_DEFAULT_WIN)
 				return;
 		}
+
+		// The last check in TCPReady also saw whether anyone else is knocking
+		if(IsServer() && m_clientSocketTCP && m_serverSocketTCP && SDLNet_SocketReady(m_serverSocketTCP))
+			RefuseExtraClient();
 	}
 	bool Game::TCPReady() const
 	{
@@ -520,13 +808,20 @@ namespace Pong
 	}
 	void Game::GetDataTCP()
 	{
-		if(m_inputBufferTCP.IsFull())
-			return;
+		m_inputBufferTCP.Reserve(TCP_MIN_RECEIVE_SIZE);
 
 		// Try to receive data
 		SDLNet_SetError("");
 		int byteCount = SDLNet_TCP_Recv(m_clientSocketTCP, m_inputBufferTCP.FirstAvailableBytePtr(), m_inputBufferTCP.BytesAvailable());
 
+		// Once the game is over, losing the connection just means no rematch
+		if(byteCount <= 0 && m_match.state == GameState::GAME_OVER)
+		{
+			d2LogInfo << "Remote player disconnected, so no rematch";
+			m_peerLeft = true;
+			return;
+		}
+
 		// Check for error
 		if(byteCount < 0)
 			throw GameException{ std::string{"Failed to get TCP data: "} +SDLNet_GetError() };
@@ -540,52 +835,65 @@ namespace Pong
 			m_inputBufferTCP.length += byteCount;
 		}
 	}
-	bool Game::GetDataUDP()
-	{	
-		// Try to receive data
-		int packetCount = SDLNet_UDP_Recv(m_clientSocketUDP, m_inputUDPPacketPtr);
-
-		// Check for no packets
-		if(packetCount < 1)
-			return false;
-
-		// We received something. Copy packet to buffer
-		memcpy(m_inputBufferUDP.FirstBytePtr(), m_inputUDPPacketPtr->data, m_inputUDPPacketPtr->len);
-		m_inputBufferUDP.length = m_inputUDPPacketPtr->len;
+	int Game::GetDataUDP(int& drainedCount)
+	{
+		drainedCount = 0;
+		if(!m_socketUDP.IsOpen())
+			return 0;
+
+		// Packets point at the input buffers, so only the lengths need setting
+		float waitSeconds[UDP_RECEIVE_BATCH];
+		int packetCount{ m_socketUDP.Receive(m_inputPacketsUDP, UDP_RECEIVE_BATCH, waitSeconds, &drainedCount) };
+		double now{ ClockSync::Now() };
+		for(int i = 0; i < packetCount; ++i)
+		{
+			m_inputBuffersUDP[i].length = m_inputPacketsUDP[i].len;
+			m_inputReceiveTimesUDP[i] = now - waitSeconds[i];
+		}
+		if(packetCount == 0)
+			return 0;
 
-		// Initialize server's outgoing UDP packet with client address
+		// Initialize server's outgoing UDP address with client address
 		if(IsServer() && m_serverWaitingForClientUDP)
 		{
-			//SDLNet_SetError("");
-			//if(SDLNet_ResolveHost(&m_outputUDPPacketPtr->address, m_clientIP.c_str(), m_inputUDPPacketPtr->address.port) != 0)
-			//	throw GameException{ std::string{"Failed to resolve host "} + m_clientIP +
-			//		" Port " + d2d::ToString(m_networkSettings.clientUDPPort) + ": " + SDLNet_GetError() };
-			m_outputUDPPacketPtr->address = m_inputUDPPacketPtr->address;
+			m_peerAddressUDP = m_inputPacketsUDP[0].address;
 			m_serverWaitingForClientUDP = false;
 
 			d2LogInfo << "Address of outgoing UDP packets set to "
-				<< d2d::GetIPOctetsString(m_outputUDPPacketPtr->address) << " port " << m_outputUDPPacketPtr->address.port;
+				<< d2d::GetIPOctetsString(m_peerAddressUDP) << " port " << d2d::GetPort(m_peerAddressUDP);
+			d2LogInfo << "UDP handshake complete, ready " << SDL_GetTicks() - m_networkStartTicks << " ms after start";
 		}
 		else if(IsClient() && m_serverWaitingForClientUDP)
+		{
 			m_serverWaitingForClientUDP = false;
+			d2LogInfo << "UDP handshake complete, ready " << SDL_GetTicks() - m_networkStartTicks << " ms after start";
+		}
 
-		return true;
+		return packetCount;
 	}
-	void Game::ProcessMessagesTCP(Buffer& data)
+	void Game::ProcessMessagesTCP(StreamBuffer& data)
 	{
-		int lastMessageStart{ 0 };
-		int nextMessageStart{ 0 };
-		do
+		while(data.UnreadBytes() > 0)
 		{
-			lastMessageStart = nextMessageStart;
-			nextMessageStart = ProcessMessageTCP(data, nextMessageStart);
-		} while(nextMessageStart != lastMessageStart);
+			// Wait for the whole length prefix, then the whole message
+			unsigned messageSize{ 0 };
+			int prefixSize{ data.ReadVarUInt(0, messageSize) };
+			if(prefixSize == 0)
+				return;
+			if(messageSize == 0 || messageSize > (unsigned)MAX_TCP_MESSAGE_SIZE)
+				throw GameException{ "Invalid TCP message length: " + d2d::ToString(messageSize) };
+			if(data.UnreadBytes() < prefixSize + (int)messageSize)
+				return;
 
-		// Discard processed data
-		data.MakeNewFront(nextMessageStart);
+			ProcessMessageTCP(&data.bytes[data.readIndex + prefixSize], (int)messageSize);
+
+			// Discard processed data without moving what's left
+			data.Consume(prefixSize + (int)messageSize);
+		}
 	}
-	void Game::ProcessMessagesUDP(Buffer& data)
+	void Game::ProcessMessagesUDP(Buffer& data, double receiveTime)
 	{
+		m_receiveTimeUDP = receiveTime;
 		int lastMessageStart{ 0 };
 		int nextMessageStart{ 0 };
 		do
@@ -597,59 +905,82 @@ namespace Pong
 		// Discard processed data
 		data.Clear();
 	}
-	// Returns start of next message
-	int Game::ProcessMessageTCP(const Buffer& data, int first)
+	void Game::ProcessMessageTCP(const Byte* message, int size)
 	{
-		if(first > data.length - 1)
-			return first;
-
-		switch(data.bytes[first])
+		switch(message[0])
 		{
 		case TCP_MESSAGE_PLAYER_READY:
 			if(IsServer())
-				m_player2.SetReady();
+				m_match.player2.SetReady();
 			else
-				m_player1.SetReady();
-			return first + 1;
+				m_match.player1.SetReady();
+			return;
 
 		case TCP_MESSAGE_COUNTDOWN_OVER:
 			if(IsServer())
 				throw GameException{ "Client should not send COUNTDOWN_OVER message" };
-			else if(m_state == GameState::COUNTDOWN)
-				m_state = GameState::PLAY;
-			return first + 1;
+			else if(m_match.state == GameState::COUNTDOWN)
+			{
+				m_match.state = GameState::PLAY;
+				m_hasCountdownEnd = false;
+			}
+			return;
+
+		case TCP_MESSAGE_RULES:
+			if(IsServer())
+				throw GameException{ "Client should not send RULES message" };
+			ReadRules(message, size);
+			return;
+
+		case TCP_MESSAGE_COUNTDOWN_END:
+			if(IsServer())
+				throw GameException{ "Client should not send COUNTDOWN_END message" };
+			else if(size < 1 + 2 * (int)sizeof(Uint64))
+				throw GameException{ "Invalid COUNTDOWN_END message: " + d2d::ToString(size) + " bytes" };
+			else
+			{
+				// When the countdown ends and when this was sent, both in server time
+				m_countdownEndServerTime = ClockSync::FromMicroseconds(Buffer::ReadUInt64(message + 1));
+				double sentTime{ ClockSync::FromMicroseconds(Buffer::ReadUInt64(message + 1 + sizeof(Uint64))) };
+				m_countdownEndUnsyncedTime = ClockSync::Now() + (m_countdownEndServerTime - sentTime);
+				m_hasCountdownEnd = true;
+			}
+			return;
 
 		case TCP_MESSAGE_PLAYER_SCORED:
 			if(IsServer())
 				throw GameException{ "Client should not send PLAYER_SCORED message" };
 			else
 			{
-				// If we only have partial message, do nothing
-				int availableDataBytes = data.length - first;
-				int messageBytes = 3;
-				if(availableDataBytes < messageBytes)
-					return first;
+				// Later versions may append fields, which are ignored
+				if(size < 3)
+					throw GameException{ "Invalid PLAYER_SCORED message length: " + d2d::ToString(size) };
 
 				// Read message
-				Byte newScore1{ data.bytes[first + 1] };
-				Byte newScore2{ data.bytes[first + 2] };
+				Byte newScore1{ message[1] };
+				Byte newScore2{ message[2] };
 
 				// Verify validity and process new score
-				if(newScore1 == m_player1.GetScore() && newScore2 == m_player2.GetScore() + 1)
-					m_player2.ScorePoint();
-				else if(newScore1 == m_player1.GetScore() + 1 && newScore2 == m_player2.GetScore())
-					m_player1.ScorePoint();
+				if(newScore1 == m_match.player1.GetScore() && newScore2 == m_match.player2.GetScore() + 1)
+					m_match.player2.ScorePoint();
+				else if(newScore1 == m_match.player1.GetScore() + 1 && newScore2 == m_match.player2.GetScore())
+					m_match.player1.ScorePoint();
 				else
 					throw GameException{ std::string{"Invalid PLAYER_SCORED message: score1="} +
-						d2d::ToString(m_player1.GetScore()) + " score2=" + d2d::ToString(m_player2.GetScore()) +
+						d2d::ToString(m_match.player1.GetScore()) + " score2=" + d2d::ToString(m_match.player2.GetScore()) +
 						" newScore1=" + d2d::ToString(newScore1) + " newScore2=" + d2d::ToString(newScore2) };
 
-				// See if someone won, otherwise start next round
-				if(m_player1.GetScore() >= SCORE_TO_WIN || m_player2.GetScore() >= SCORE_TO_WIN)
-					m_state = GameState::GAME_OVER;
-				else
+				// See if someone won, otherwise start next round. Multiple pucks play on.
+				if(m_match.player1.GetScore() >= m_rules.scoreToWin || m_match.player2.GetScore() >= m_rules.scoreToWin)
+				{
+					m_match.state = GameState::GAME_OVER;
+					Audio::Play(SoundEffect::GAME_OVER);
+					return;
+				}
+				Audio::Play(SoundEffect::GOAL_SCORED);
+				if(!IsMultiPuck())
 					ResetRound();
-				return first + messageBytes;
+				return;
 			}
 		
 		case TCP_MESSAGE_CLIENT_INIT_UDP_TIMEOUT:
@@ -660,20 +991,37 @@ namespace Pong
 				m_serverTimedOutWaitingForClientUDP = true;
 				throw GameException{ "Timed out waiting for initial client UDP message" };
 			}
-			return first + 1;
 
 		case TCP_MESSAGE_PLAYER_QUIT:
-			if(m_state == GameState::CONFIRM_PLAYERS_READY ||
-				m_state == GameState::COUNTDOWN ||
-				m_state == GameState::PLAY)
+			if(m_match.state == GameState::CONFIRM_PLAYERS_READY ||
+				m_match.state == GameState::COUNTDOWN ||
+				m_match.state == GameState::PLAY)
 			{
-				SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Game Over", "Remote player quit", nullptr);
-				m_state = GameState::GAME_OVER_DEFAULT_WIN;
+				PostNotice(SDL_MESSAGEBOX_INFORMATION, "Game Over", "Remote player quit");
+				m_match.state = GameState::GAME_OVER_DEFAULT_WIN;
 			}
-			return first + 1;
+			else if(m_match.state == GameState::GAME_OVER)
+			{
+				d2LogInfo << "Remote player left, so no rematch";
+				m_peerLeft = true;
+			}
+			return;
+
+		case TCP_MESSAGE_REMATCH:
+			// Each side sends this once per game and leaves GAME_OVER only after receiving the other's
+			if(m_match.state != GameState::GAME_OVER)
+				throw GameException{ "REMATCH message received outside of GAME_OVER" };
+			if(IsServer())
+				m_match.player2WantsRematch = true;
+			else
+				m_match.player1WantsRematch = true;
+			StartRematchIfAgreed();
+			return;
 
 		default:
-			throw GameException{ std::string{"Invalid message code: "} +d2d::ToString(data.bytes[first]) };
+			// The frame says how long it is, so a newer peer's messages can be stepped over
+			d2LogWarning << "Skipping unknown TCP message type " << d2d::ToString(message[0]) << " (" << size << " bytes)";
+			return;
 		}
 	}
 	// Returns start of next message
@@ -690,58 +1038,186 @@ namespace Pong
 				else
 					return first + 1;
 
-			case UDP_MESSAGE_COUNTDOWN_LEFT:
+			case UDP_MESSAGE_TIME_REQUEST:
+				if(IsClient())
+					throw GameException{ "Server should not send TIME_REQUEST message" };
+				else
+				{
+					// If we only have partial message, do nothing
+					int messageBytes = 1 + sizeof(Uint64);
+					if(data.length - first < messageBytes)
+						return first;
+
+					// Answered with this step's datagrams, which go out right after messages are read
+					int responseBytes = 1 + 3 * sizeof(Uint64);
+					if(GetOutputBufferUDP().BytesAvailable() < responseBytes)
+						StartNextOutputBufferUDP();
+					Buffer& output{ GetOutputBufferUDP() };
+					output.WriteByte(UDP_MESSAGE_TIME_RESPONSE);
+					output.WriteUInt64(data.ReadUInt64(first + 1));
+					output.WriteUInt64(ClockSync::ToMicroseconds(m_receiveTimeUDP));
+					output.WriteUInt64(ClockSync::ToMicroseconds(ClockSync::Now()));
+					return first + messageBytes;
+				}
+
+			case UDP_MESSAGE_TIME_RESPONSE:
 				if(IsServer())
-					throw GameException{ "Client should not send COUNTDOWN_LEFT message" };
+					throw GameException{ "Client should not send TIME_RESPONSE message" };
 				else
 				{
 					// If we only have partial message, do nothing
-					int availableDataBytes = data.length - first;
-					int messageBytes = 1 + sizeof(unsigned) + sizeof(float);
-					if(availableDataBytes < messageBytes)
+					int messageBytes = 1 + 3 * sizeof(Uint64);
+					if(data.length - first < messageBytes)
 						return first;
 
-					// Check sequence number
-					unsigned sequenceNum = data.ReadUInt(first + 1);
-					if(sequenceNum >= m_lastUDPCountdownSequenceNum)
+					// Our request time, the server's receive and send times, and our receive time
+					m_clockSync.AddSample(ClockSync::FromMicroseconds(data.ReadUInt64(first + 1)),
+						ClockSync::FromMicroseconds(data.ReadUInt64(first + 1 + sizeof(Uint64))),
+						ClockSync::FromMicroseconds(data.ReadUInt64(first + 1 + 2 * sizeof(Uint64))),
+						m_receiveTimeUDP);
+					return first + messageBytes;
+				}
+
+			case UDP_MESSAGE_SNAPSHOT:
+				if(IsServer())
+					throw GameException{ "Client should not send SNAPSHOT message" };
+				else
+				{
+					// If we only have partial message, do nothing
+					if(data.length - first < SNAPSHOT_HEADER_BYTES)
+						return first;
+
+					int index{ first + 1 };
+					unsigned sequenceNum = data.ReadUInt(index);
+					index += sizeof(unsigned);
+					Byte baselineAge = data.bytes[index++];
+					size_t totalPucks = data.ReadUInt16(index);
+					index += sizeof(Uint16);
+					size_t firstPuck = data.ReadUInt16(index);
+					index += sizeof(Uint16);
+					size_t puckCount = data.bytes[index++];
+					Byte flags = data.bytes[index++];
+					if(totalPucks > MAX_PUCK_COUNT || firstPuck + puckCount > totalPucks ||
+						baselineAge >= SnapshotDelta::HISTORY_SIZE || (flags & ~(SNAPSHOT_HAS_PADDLE | SNAPSHOT_PUCKS_PREDICTED)))
+						throw GameException{ std::string{"Invalid SNAPSHOT message: totalPucks="} + d2d::ToString(totalPucks) +
+							" firstPuck=" + d2d::ToString(firstPuck) + " puckCount=" + d2d::ToString(puckCount) };
+					float paddleY{ 0.0f };
+					if(flags & SNAPSHOT_HAS_PADDLE)
 					{
-						// Read message
-						m_countdownSecondsLeft = data.ReadFloat(first + 1 + sizeof(unsigned));
+						paddleY = data.ReadFloat(index);
+						index += sizeof(float);
+					}
 
-						// Update sequence number
-						m_lastUDPCountdownSequenceNum = sequenceNum;
+					// Without its baseline, or long after newer snapshots, a chunk is no use. The
+					// server keeps encoding against what we last acknowledged, so later ones will be.
+					const SnapshotDelta::Record* baselinePtr{ nullptr };
+					if(baselineAge != 0)
+						baselinePtr = m_snapshotHistory.FindComplete(sequenceNum - baselineAge);
+					if((baselineAge != 0 && !baselinePtr) ||
+						sequenceNum + SnapshotDelta::HISTORY_SIZE <= m_lastUDPPlayerSequenceNum)
+					{
+						for(size_t i = 0; i < puckCount; ++i)
+							index += SnapshotDelta::SkipPuck(data, index);
+						return index;
 					}
-					return first + messageBytes;
+
+					bool pucksPredicted{ (flags & SNAPSHOT_PUCKS_PREDICTED) != 0 };
+					if(pucksPredicted && (!baselinePtr || baselinePtr->pucks.size() != totalPucks || firstPuck != 0 || puckCount != 0))
+						throw GameException{ "Invalid SNAPSHOT message: pucks predicted without a matching baseline" };
+
+					SnapshotDelta::Record* recordPtr{ m_snapshotHistory.Find(sequenceNum) };
+					if(!recordPtr)
+						recordPtr = &m_snapshotHistory.Begin(sequenceNum, totalPucks);
+					else if(recordPtr->pucks.size() != totalPucks)
+						throw GameException{ "Invalid SNAPSHOT message: puck count changed within snapshot " + d2d::ToString(sequenceNum) };
+
+					// The paddle comes with the first chunk, unless it hasn't moved
+					if(firstPuck == 0)
+					{
+						if(!(flags & SNAPSHOT_HAS_PADDLE))
+						{
+							if(!baselinePtr)
+								throw GameException{ "Invalid SNAPSHOT message: no paddle and no baseline" };
+							paddleY = baselinePtr->paddleY;
+						}
+						recordPtr->paddleY = paddleY;
+						recordPtr->hasPaddle = true;
+						if(sequenceNum >= m_lastUDPPlayerSequenceNum)
+						{
+							m_match.player1.SetY(paddleY);
+							if(m_networkObserverPtr)
+								m_networkObserverPtr->OnRemotePlayerY(paddleY);
+							m_lastUDPPlayerSequenceNum = sequenceNum;
+						}
+					}
+
+					// The server decides how many pucks are in play
+					if(totalPucks != m_pucks.size())
+						SetPuckCount(totalPucks);
+
+					// Pucks are sent relative to where the baseline's would be by now
+					size_t endPuck{ pucksPredicted ? totalPucks : firstPuck + puckCount };
+					for(size_t puckIndex = firstPuck; puckIndex < endPuck; ++puckIndex)
+					{
+						SnapshotDelta::PuckState& state{ recordPtr->pucks[puckIndex] };
+						if(baselinePtr && puckIndex < baselinePtr->pucks.size())
+						{
+							SnapshotDelta::PuckState predicted{ PredictPuck(baselinePtr->pucks[puckIndex], baselineAge) };
+							if(pucksPredicted)
+								state = predicted;
+							else
+								index += SnapshotDelta::ReadPuck(data, index, &predicted, state);
+						}
+						else
+							index += SnapshotDelta::ReadPuck(data, index, nullptr, state);
+						if(!recordPtr->receivedPucks[puckIndex])
+						{
+							recordPtr->receivedPucks[puckIndex] = 1;
+							++recordPtr->receivedPuckCount;
+						}
+
+						// Check sequence number
+						if(sequenceNum >= m_lastUDPPuckSequenceNums[puckIndex])
+						{
+							// Paddle hits happen on the server; here, a puck turning back is one. A puck
+							// served after a goal can turn back too, but it jumps to the net to do it.
+							const Puck& puck{ m_pucks[puckIndex] };
+							b2Vec2 jump{ state.position - puck.GetPosition() };
+							if(puck.GetVelocity().x * state.velocity.x < 0.0f &&
+								jump.LengthSquared() <= MAX_SMOOTHED_PUCK_CORRECTION * MAX_SMOOTHED_PUCK_CORRECTION)
+								Audio::Play(SoundEffect::PADDLE_HIT);
+							m_pucks[puckIndex].CorrectTo(state.position, state.velocity);
+							if(m_networkObserverPtr)
+								m_networkObserverPtr->OnPuckReceived(puckIndex, state.position);
+							m_lastUDPPuckSequenceNums[puckIndex] = sequenceNum;
+						}
+					}
+
+					// Once all of it is here it can be a baseline
+					if(recordPtr->IsComplete() && (!m_hasSnapshotAck || sequenceNum > m_snapshotAck))
+					{
+						m_snapshotAck = sequenceNum;
+						m_hasSnapshotAck = true;
+					}
+					return index;
 				}
 
-			case UDP_MESSAGE_PUCK_POSITION_VELOCITY:
-				if(IsServer())
-					throw GameException{ "Client should not send PUCK_POSITION message" };
+			case UDP_MESSAGE_SNAPSHOT_ACK:
+				if(IsClient())
+					throw GameException{ "Server should not send SNAPSHOT_ACK message" };
 				else
 				{
 					// If we only have partial message, do nothing
-					int availableDataBytes = data.length - first;
-					int messageBytes = 1 + sizeof(unsigned) + 4 * sizeof(float);
-					if(availableDataBytes < messageBytes)
+					int messageBytes = 1 + sizeof(unsigned);
+					if(data.length - first < messageBytes)
 						return first;
 
-					// Check sequence number
+					// Acknowledgements repeat every frame, so only the newest matters
 					unsigned sequenceNum = data.ReadUInt(first + 1);
-					if(sequenceNum >= m_lastUDPPuckSequenceNum)
+					if((!m_hasSnapshotAck || sequenceNum > m_snapshotAck) && sequenceNum < m_nextUDPSequenceNum)
 					{
-						// Read position
-						b2Vec2 inputVector;
-						inputVector.x = data.ReadFloat(first + 1 + sizeof(unsigned));
-						inputVector.y = data.ReadFloat(first + 1 + sizeof(unsigned) + sizeof(float));
-						m_puck.SetPosition(inputVector);
-
-						// Read velocity
-						inputVector.x = data.ReadFloat(first + 1 + sizeof(unsigned) + 2 * sizeof(float));
-						inputVector.y = data.ReadFloat(first + 1 + sizeof(unsigned) + 3 * sizeof(float));
-						m_puck.SetVelocity(inputVector);
-
-						// Update sequence number
-						m_lastUDPPuckSequenceNum = sequenceNum;
+						m_snapshotAck = sequenceNum;
+						m_hasSnapshotAck = true;
 					}
 					return first + messageBytes;
 				}
@@ -761,9 +1237,11 @@ namespace Pong
 					// Read message
 					float newY = data.ReadFloat(first + 1 + sizeof(unsigned));
 					if(IsServer())
-						m_player2.SetY(newY);
+						m_match.player2.SetY(newY);
 					else
-						m_player1.SetY(newY);
+						m_match.player1.SetY(newY);
+					if(m_networkObserverPtr)
+						m_networkObserverPtr->OnRemotePlayerY(newY);
 
 					// Update sequence number
 					m_lastUDPPlayerSequenceNum = sequenceNum;
@@ -781,7 +1259,7 @@ namespace Pong
 	{
 		errno = 0;
 		SDLNet_SetError("");
-		int numSocketsReady = SDLNet_CheckSockets(m_socketSet, TCP_SERVER_CHECK_FOR_CLIENT_CONNECTION_TIMEOUT_MILLISECONDS);
+		int numSocketsReady = SDLNet_CheckSockets(m_socketSet, 0);
 		if(numSocketsReady == -1)
 		{
 			throw GameException{ std::string{"Failed to check sockets: "} +
@@ -802,8 +1280,8 @@ namespace Pong
 
 				if(!(m_clientSocketTCP = SDLNet_TCP_Accept(m_serverSocketTCP)))
 				{
-					SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_WARNING, "Socket error",
-						"TCP Socket indicated that a client wanted to connect, but failed to accept connection. Continuing to wait for client.", nullptr);
+					PostNotice(SDL_MESSAGEBOX_WARNING, "Socket error",
+						"TCP Socket indicated that a client wanted to connect, but failed to accept connection. Continuing to wait for client.");
 					return;
 				}
 
@@ -819,28 +1297,20 @@ namespace Pong
 				d2LogInfo << "Accepted a TCP connection from "
 					<< clientIP << " port " << d2d::GetPort(*clientIPPtr_TCP);
 
-				// Replace server socket with client socket in socket set
-				SDLNet_SetError("");
-				if(SDLNet_TCP_DelSocket(m_socketSet, m_serverSocketTCP) == -1)
-					throw GameException{ std::string{"After connecting to client, failed to delete server TCP socket from socket set: "} +SDLNet_GetError() };
-				SDLNet_TCP_Close(m_serverSocketTCP);
-				m_serverSocketTCP = nullptr;
-
+				// The server socket stays open and in the set, so the next game doesn't have
+				// to set it up again. CheckMessages turns away anyone else who connects meanwhile.
 				SDLNet_SetError("");
 				if(SDLNet_TCP_AddSocket(m_socketSet, m_clientSocketTCP) == -1)
 					throw GameException{ std::string{"After connecting to client, failed to add client TCP socket to socket set: "} +SDLNet_GetError() };
 
-				// Allocate in/out UDP packets
-				if(!(m_inputUDPPacketPtr = SDLNet_AllocPacket(BUFFER_SIZE)))
-					throw GameException{ "Failed to allocate input UDP packet: Out of memory" };
-				if(!(m_outputUDPPacketPtr = SDLNet_AllocPacket(BUFFER_SIZE)))
-					throw GameException{ "Failed to allocate output UDP packet: Out of memory" };
+				// The client plays by our rules, whatever its own file says
+				WriteRules();
 
 				// TCP connection made, now wait for initial client UDP message to get its port and start game
 				m_serverWaitingForClientUDP = true;
 				m_timeWaitingForClientUDP = 0.0f;
 				m_serverTimedOutWaitingForClientUDP = false;
-				m_state = GameState::CONFIRM_PLAYERS_READY;
+				m_match.state = GameState::CONFIRM_PLAYERS_READY;
 			}
 		}
 	}
@@ -856,18 +1326,15 @@ namespace Pong
 			}
 		}
 		else if(IsClient() && m_serverWaitingForClientUDP)
-			m_outputBufferUDP.WriteByte(UDP_MESSAGE_INIT_CLIENT_TO_SERVER);
+			GetOutputBufferUDP().WriteByte(UDP_MESSAGE_INIT_CLIENT_TO_SERVER);
 	}
 	void Game::UpdateConfirmPlayersReady(float dt)
 	{
 		if(IsNetworked())
 			UpdateUDPInit(dt);
 
-		if(m_player1.IsReady() && m_player2.IsReady())
-		{
-			m_countdownSecondsLeft = INITIAL_COUNTDOWN;
-			m_state = GameState::COUNTDOWN;
-		}
+		if(m_match.player1.IsReady() && m_match.player2.IsReady())
+			StartCountdown();
 	}
 	void Game::UpdateCountdown(float dt)
 	{
@@ -878,67 +1345,199 @@ namespace Pong
 				return;
 		}
 
-		if(!IsClient())
-			m_countdownSecondsLeft -= dt;
-
-		if(m_countdownSecondsLeft <= 0.0f)
+		// Both peers count down to the same moment on their own clocks, so the time
+		// left isn't sent. The client starts on time, or when the server says it has.
+		if(IsServer())
+			m_match.countdownSecondsLeft = (float)(m_countdownEndTime - ClockSync::Now());
+		else if(IsClient())
 		{
-			m_state = GameState::PLAY;
-			if(IsServer())
-				m_outputBufferTCP.WriteByte(TCP_MESSAGE_COUNTDOWN_OVER);
+			if(m_hasCountdownEnd)
+			{
+				double endTime{ m_clockSync.IsSynchronized() ?
+					m_clockSync.ToLocalTime(m_countdownEndServerTime) : m_countdownEndUnsyncedTime };
+				m_match.countdownSecondsLeft = std::max((float)(endTime - ClockSync::Now()), 0.0f);
+			}
 		}
-		else if(IsServer())
+		else
+			m_match.countdownSecondsLeft -= dt;
+
+		if(m_match.countdownSecondsLeft <= 0.0f)
 		{
-			m_outputBufferUDP.WriteByte(UDP_MESSAGE_COUNTDOWN_LEFT);
-			m_outputBufferUDP.WriteUInt(m_nextUDPSequenceNum++);
-			m_outputBufferUDP.WriteFloat(m_countdownSecondsLeft);
+			m_match.state = GameState::PLAY;
+			m_hasCountdownEnd = false;
+			if(IsServer())
+				WriteMessageTCP(TCP_MESSAGE_COUNTDOWN_OVER);
 		}
 	}
 	void Game::UpdatePlay(float dt)
 	{
 		if(!IsClient())
-			m_player1.Update(dt);
+			m_match.player1.Update(dt, m_rules);
 		if(!IsServer())
-			m_player2.Update(dt);
+			m_match.player2.Update(dt, m_rules);
+
+		bool anyPuckScored{ false };
+		for(Puck& puck : m_pucks)
+		{
+			puck.Update(dt, m_rules, m_match.player1, m_match.player2);
+			if(puck.HitPlayer())
+				Audio::Play(SoundEffect::PADDLE_HIT);
+			if(puck.Scored())
+			{
+				anyPuckScored = true;
 
-		m_puck.Update(dt, m_player1, m_player2);
+				// One message per goal, so the client can verify each score change
+				if(IsServer())
+				{
+					Byte scores[]{ (Byte)m_match.player1.GetScore(), (Byte)m_match.player2.GetScore() };
+					WriteMessageTCP(TCP_MESSAGE_PLAYER_SCORED, scores, sizeof(scores));
+				}
+			}
+		}
+		if(IsMultiPuck() && !IsClient())
+			HandlePuckCollisions();
 
 		if(IsClient())
 		{
-			m_outputBufferUDP.WriteByte(UDP_MESSAGE_PLAYER_Y);
-			m_outputBufferUDP.WriteUInt(m_nextUDPSequenceNum++);
-			m_outputBufferUDP.WriteFloat(m_player2.GetPosition().y);
+			GetOutputBufferUDP().WriteByte(UDP_MESSAGE_PLAYER_Y);
+			GetOutputBufferUDP().WriteUInt(m_nextUDPSequenceNum++);
+			GetOutputBufferUDP().WriteFloat(m_match.player2.GetPosition().y);
+			WriteSnapshotAck();
 		}
 		else if(IsServer())
+			WriteNetworkSnapshot();
+
+		if(anyPuckScored)
+		{
+			if(m_match.player1.GetScore() >= m_rules.scoreToWin || m_match.player2.GetScore() >= m_rules.scoreToWin)
+			{
+				m_match.state = GameState::GAME_OVER;
+				Audio::Play(SoundEffect::GAME_OVER);
+				SendNetworkData();
+			}
+			else
+			{
+				Audio::Play(SoundEffect::GOAL_SCORED);
+				if(IsMultiPuck())
+				{
+					for(Puck& puck : m_pucks)
+						if(puck.Scored())
+							ServePuck(puck);
+				}
+				else
+					ResetRound();
+			}
+		}
+	}
+	void Game::WriteNetworkSnapshot()
+	{
+		// The server's paddle and every puck, encoded against the newest snapshot the
+		// client has acknowledged, with its pucks moved forward to now. Pucks go out in
+		// chunks of consecutive pucks that share one sequence number. When the datagram
+		// is full, the next chunk starts a new one; all of them are sent together with
+		// the rest of the frame's UDP messages.
+		unsigned sequenceNum = m_nextUDPSequenceNum++;
+		const SnapshotDelta::Record* baselinePtr{ nullptr };
+		if(m_hasSnapshotAck && sequenceNum - m_snapshotAck < SnapshotDelta::HISTORY_SIZE)
+			baselinePtr = m_snapshotHistory.FindComplete(m_snapshotAck);
+		Byte baselineAge{ baselinePtr ? (Byte)(sequenceNum - m_snapshotAck) : (Byte)0 };
+		float paddleY{ m_match.player1.GetPosition().y };
+
+		// Where the client will have the pucks without being told
+		bool pucksPredicted{ baselinePtr && baselinePtr->pucks.size() == m_pucks.size() };
+		m_predictedPucks.resize(baselinePtr ? baselinePtr->pucks.size() : 0);
+		for(size_t i = 0; i < m_predictedPucks.size(); ++i)
 		{
-			m_outputBufferUDP.WriteByte(UDP_MESSAGE_PUCK_POSITION_VELOCITY);
-			m_outputBufferUDP.WriteUInt(m_nextUDPSequenceNum++);
-			m_outputBufferUDP.WriteFloat(m_puck.GetPosition().x);
-			m_outputBufferUDP.WriteFloat(m_puck.GetPosition().y);
-			m_outputBufferUDP.WriteFloat(m_puck.GetVelocity().x);
-			m_outputBufferUDP.WriteFloat(m_puck.GetVelocity().y);
-
-			m_outputBufferUDP.WriteByte(UDP_MESSAGE_PLAYER_Y);
-			m_outputBufferUDP.WriteUInt(m_nextUDPSequenceNum++);
-			m_outputBufferUDP.WriteFloat(m_player1.GetPosition().y);
+			m_predictedPucks[i] = PredictPuck(baselinePtr->pucks[i], baselineAge);
+			if(pucksPredicted && !SnapshotDelta::Matches(m_predictedPucks[i], { m_pucks[i].GetPosition(), m_pucks[i].GetVelocity() }))
+				pucksPredicted = false;
 		}
 
-		if(m_puck.Scored())
+		// Between paddle hits, serves and collisions there's nothing to say. A snapshot
+		// still goes now and then, so a lost one is made up for and the baseline stays recent.
+		// Until the client acknowledges a change, it's sent again every step.
+		if(pucksPredicted && paddleY == baselinePtr->paddleY &&
+			baselineAge < SnapshotDelta::HISTORY_SIZE / 2 &&
+			(sequenceNum - m_lastSentSnapshot) * m_tickSeconds < m_networkSettings.snapshotHeartbeatSeconds)
+			return;
+		m_lastSentSnapshot = sequenceNum;
+
+		// Keep what the client will reconstruct, for encoding later snapshots
+		SnapshotDelta::Record& record{ m_snapshotHistory.Begin(sequenceNum, m_pucks.size()) };
+		record.paddleY = paddleY;
+		record.hasPaddle = true;
+		record.receivedPuckCount = m_pucks.size();
+
+		size_t firstPuck{ 0 };
+		do
 		{
-			if(IsServer())
+			bool writePaddle{ firstPuck == 0 && (!baselinePtr || baselinePtr->paddleY != record.paddleY) };
+			int headerBytes{ SNAPSHOT_HEADER_BYTES + (writePaddle ? (int)sizeof(float) : 0) };
+			if(GetOutputBufferUDP().BytesAvailable() < headerBytes + SnapshotDelta::MAX_PUCK_BYTES)
 			{
-				m_outputBufferTCP.WriteByte(TCP_MESSAGE_PLAYER_SCORED);
-				m_outputBufferTCP.WriteByte((Byte)m_player1.GetScore());
-				m_outputBufferTCP.WriteByte((Byte)m_player2.GetScore());
+				StartNextOutputBufferUDP();
+				if(GetOutputBufferUDP().BytesAvailable() < headerBytes + SnapshotDelta::MAX_PUCK_BYTES)
+					throw GameException{ "Game::WriteNetworkSnapshot: Snapshot chunk doesn't fit in an empty UDP buffer" };
 			}
 
-			if(m_player1.GetScore() >= SCORE_TO_WIN || m_player2.GetScore() >= SCORE_TO_WIN)
+			Buffer& output{ GetOutputBufferUDP() };
+			output.WriteByte(UDP_MESSAGE_SNAPSHOT);
+			output.WriteUInt(sequenceNum);
+			output.WriteByte(baselineAge);
+			output.WriteUInt16((Uint16)m_pucks.size());
+			output.WriteUInt16((Uint16)firstPuck);
+			int puckCountIndex{ output.length };
+			output.WriteByte(0);
+			output.WriteByte((writePaddle ? SNAPSHOT_HAS_PADDLE : 0) | (pucksPredicted ? SNAPSHOT_PUCKS_PREDICTED : 0));
+			if(writePaddle)
+				output.WriteFloat(record.paddleY);
+			if(pucksPredicted)
 			{
-				m_state = GameState::GAME_OVER;
-				SendNetworkData();
+				std::copy(m_predictedPucks.begin(), m_predictedPucks.end(), record.pucks.begin());
+				break;
 			}
-			else
-				ResetRound();
+
+			// Fill the datagram, then go back for the count
+			size_t puckCount{ 0 };
+			while(firstPuck + puckCount < m_pucks.size() && puckCount < std::numeric_limits<Byte>::max() &&
+				output.BytesAvailable() >= SnapshotDelta::MAX_PUCK_BYTES)
+			{
+				size_t i{ firstPuck + puckCount };
+				SnapshotDelta::PuckState current{ m_pucks[i].GetPosition(), m_pucks[i].GetVelocity() };
+				SnapshotDelta::WritePuck(output, i < m_predictedPucks.size() ? &m_predictedPucks[i] : nullptr, current, record.pucks[i]);
+				++puckCount;
+			}
+			output.bytes[puckCountIndex] = (Byte)puckCount;
+			firstPuck += puckCount;
+		} while(firstPuck < m_pucks.size());
+	}
+	SnapshotDelta::PuckState Game::PredictPuck(const SnapshotDelta::PuckState& from, unsigned ticks) const
+	{
+		// The same steps the client's puck takes on its own
+		Puck puck;
+		puck.SetPosition(from.position);
+		puck.SetVelocity(from.velocity);
+		puck.Extrapolate(m_tickSeconds, ticks);
+		return { puck.GetPosition(), puck.GetVelocity() };
+	}
+	void Game::WriteTimeRequest()
+	{
+		// Every step until the clocks agree, then now and then to follow drift
+		double now{ ClockSync::Now() };
+		double interval{ m_clockSync.IsSynchronized() ? m_networkSettings.clockSyncIntervalSeconds : 0.0 };
+		if(now - m_lastTimeRequestTime < interval)
+			return;
+		m_lastTimeRequestTime = now;
+		GetOutputBufferUDP().WriteByte(UDP_MESSAGE_TIME_REQUEST);
+		GetOutputBufferUDP().WriteUInt64(ClockSync::ToMicroseconds(now));
+	}
+	void Game::WriteSnapshotAck()
+	{
+		// Every frame, so a lost one costs nothing
+		if(m_hasSnapshotAck)
+		{
+			GetOutputBufferUDP().WriteByte(UDP_MESSAGE_SNAPSHOT_ACK);
+			GetOutputBufferUDP().WriteUInt(m_snapshotAck);
 		}
 	}
 
@@ -949,7 +1548,11 @@ namespace Pong
 	{
 		return m_side;
 	}
-	const b2Vec2& Player::GetPosition() const
+	b2Vec2 Player::GetPosition() const
+	{
+		return PhysicsMath::ToB2Vec2(m_position);
+	}
+	const PhysicsVec2& Player::GetPhysicsPosition() const
 	{
 		return m_position;
 	}
@@ -973,27 +1576,27 @@ namespace Pong
 	void Player::SetMovementFactor(float factor)
 	{
 		d2d::Clamp(factor, { -1.0f, 1.0f });
-		m_movementFactor = factor;
+		m_movementFactor = PhysicsScalar{ factor };
 	}
 	void Player::SetY(float newY)
 	{
 		if(newY < GAME_RECT.lowerBound.y || newY + PLAYER_SIZE.y > GAME_RECT.upperBound.y)
 			throw GameException{ std::string{"Player::SetY: Out of bounds: y="} +d2d::ToString(newY) };
-		m_position.y = newY;
+		m_position.y = PhysicsScalar{ newY };
 	}
-	void Player::Update(float dt)
+	void Player::Update(float dt, const RulesDef& rules)
 	{
 		// Move
 		{
-			const float MAX_DISPLACEMENT{ PLAYER_MAX_SPEED * dt };
+			const PhysicsScalar MAX_DISPLACEMENT{ PhysicsScalar{ rules.playerMaxSpeed } * PhysicsScalar{ dt } };
 			m_position.y += m_movementFactor * MAX_DISPLACEMENT;
 		}
 
 		// Clamp to top/bottom walls
 		{
-			const float MIN_Y{ GAME_RECT.lowerBound.y };
-			const float MAX_Y{ GAME_RECT.upperBound.y - PLAYER_SIZE.y };
-			d2d::Clamp(m_position.y, { MIN_Y, MAX_Y });
+			const PhysicsScalar MIN_Y{ GAME_RECT.lowerBound.y };
+			const PhysicsScalar MAX_Y{ GAME_RECT.upperBound.y - PLAYER_SIZE.y };
+			m_position.y = std::clamp(m_position.y, MIN_Y, MAX_Y);
 		}
 	}
 	void Player::Init(Side newSide)
@@ -1005,79 +1608,122 @@ namespace Pong
 	void Player::ResetRound()
 	{
 		if(m_side == Side::LEFT)
-			m_position.x = GAME_RECT.lowerBound.x;
+			m_position.x = PhysicsScalar{ GAME_RECT.lowerBound.x };
 		else
-			m_position.x = GAME_RECT.upperBound.x - PLAYER_SIZE.x;
-		m_position.y = GAME_RECT.GetCenter().y - (0.5f * PLAYER_SIZE.y);
+			m_position.x = PhysicsScalar{ GAME_RECT.upperBound.x - PLAYER_SIZE.x };
+		m_position.y = PhysicsScalar{ GAME_RECT.GetCenter().y - (0.5f * PLAYER_SIZE.y) };
 
-		m_movementFactor = 0.0f;
+		m_movementFactor = PhysicsScalar{ 0.0f };
 
 		m_isReady = false;
 	}
-	void Player::Draw() const
-	{
-		d2d::Window::SetColor(PLAYER_COLOR);
-		d2d::Window::DrawRect({ m_position, m_position + PLAYER_SIZE }, true);
-	}
 
 	//+--------------------------------\--------------------------------------
 	//|				Puck	    	   |
 	//\--------------------------------/--------------------------------------
-	void Puck::ResetRound()
+	float Puck::GetRandomStartAngle(const RulesDef& rules)
 	{
-		m_position = GAME_RECT.GetCenter() - 0.5f * PUCK_SIZE;
-
-		if(IsClient())
-			m_velocity = b2Vec2_zero;
-		else
+		/*float halfAngleRange = START_ANGLE_RANGE * 0.5f;
+		float angle = d2d::RandomFloat({ -halfAngleRange, halfAngleRange });
+		if (d2d::RandomBool())
+			angle += d2d::PI;*/
+		float angle = d2d::RandomBool() ? rules.startAngle : -rules.startAngle;
+		if(d2d::RandomBool())
+			angle += d2d::PI;
+		d2d::WrapRadians(angle);
+		return angle;
+	}
+	void Puck::SetFollowsServer(bool followsServer)
+	{
+		m_followsServer = followsServer;
+	}
+	void Puck::ResetRound(const RulesDef& rules)
+	{
+		float angle{ 0.0f };
+		if(!m_followsServer)
 		{
 			// Randomize puck angle
 			d2d::SeedRandomNumberGenerator();
-			/*float halfAngleRange = START_ANGLE_RANGE * 0.5f;
-			float angle = d2d::RandomFloat({ -halfAngleRange, halfAngleRange });
-			if (d2d::RandomBool())
-				angle += d2d::PI;*/
-			float angle = d2d::RandomBool() ? START_ANGLE : -START_ANGLE;
-			if(d2d::RandomBool())
-				angle += d2d::PI;
-			d2d::WrapRadians(angle);
-
-			m_velocity.Set(cos(angle), sin(angle));
-			m_velocity *= INITIAL_PUCK_SPEED;
+			angle = GetRandomStartAngle(rules);
+		}
+		ResetRound(rules, angle);
+	}
+	void Puck::ResetRound(const RulesDef& rules, float startAngle)
+	{
+		ResetRound(rules, GAME_RECT.GetCenter() - 0.5f * PUCK_SIZE, startAngle);
+	}
+	void Puck::ResetRound(const RulesDef& rules, const b2Vec2& startPosition, float startAngle)
+	{
+		m_position = PhysicsMath::ToPhysics(startPosition);
+
+		if(m_followsServer)
+			m_velocity = PhysicsMath::ToPhysics(b2Vec2_zero);
+		else
+		{
+			const PhysicsScalar ANGLE{ startAngle };
+			m_velocity.Set(PhysicsMath::Cos(ANGLE), PhysicsMath::Sin(ANGLE));
+			m_velocity *= PhysicsScalar{ rules.initialPuckSpeed };
 		}
 
+		m_drawOffset = b2Vec2_zero;
 		m_gotPastPlayer = false;
 		m_scored = false;
+		m_hitPlayer = false;
 	}
 	bool Puck::Scored() const
 	{
 		return m_scored;
 	}
-	void Puck::Update(float dt, Player& player1, Player& player2)
+	bool Puck::HitPlayer() const
+	{
+		return m_hitPlayer;
+	}
+	void Puck::Update(float dt, const RulesDef& rules, Player& player1, Player& player2)
 	{
+		m_hitPlayer = false;
 		UpdatePosition(dt);
-		if(!IsClient())
+		if(!m_followsServer)
 		{
 			if(!m_gotPastPlayer)
 			{
-				HandlePlayerCollision(player1);
-				HandlePlayerCollision(player2);
+				HandlePlayerCollision(player1, rules);
+				HandlePlayerCollision(player2, rules);
 			}
 			HandleGoal(player1);
 			HandleGoal(player2);
 		}
+		else if(m_drawOffset.LengthSquared() > MIN_SMOOTHED_PUCK_CORRECTION * MIN_SMOOTHED_PUCK_CORRECTION)
+			m_drawOffset *= std::exp(-dt / PUCK_CORRECTION_SECONDS);
+		else
+			m_drawOffset = b2Vec2_zero;
+	}
+	void Puck::Extrapolate(float dt, unsigned steps)
+	{
+		for(unsigned i = 0; i < steps; ++i)
+			UpdatePosition(dt);
+	}
+	void Puck::CorrectTo(const b2Vec2& position, const b2Vec2& velocity)
+	{
+		b2Vec2 error{ GetDrawPosition() - position };
+		m_drawOffset = error.LengthSquared() <= MAX_SMOOTHED_PUCK_CORRECTION * MAX_SMOOTHED_PUCK_CORRECTION ? error : b2Vec2_zero;
+		SetPosition(position);
+		SetVelocity(velocity);
+	}
+	b2Vec2 Puck::GetDrawPosition() const
+	{
+		return GetPosition() + m_drawOffset;
 	}
 	void Puck::UpdatePosition(float dt)
 	{
-		const float MIN_Y{ GAME_RECT.lowerBound.y };
-		const float MAX_Y{ GAME_RECT.upperBound.y - PUCK_SIZE.y };
+		const PhysicsScalar MIN_Y{ GAME_RECT.lowerBound.y };
+		const PhysicsScalar MAX_Y{ GAME_RECT.upperBound.y - PUCK_SIZE.y };
 
-		m_position += dt * m_velocity;
+		m_position += PhysicsScalar{ dt } * m_velocity;
 
 		// Bounce ball off top wall
 		if(m_position.y >= MAX_Y)
 		{
-			const float PROTRUSION_Y{ m_position.y - MAX_Y };
+			const PhysicsScalar PROTRUSION_Y{ m_position.y - MAX_Y };
 			m_position.y = MAX_Y - PROTRUSION_Y;
 			m_velocity.y = -m_velocity.y;
 		}
@@ -1085,47 +1731,52 @@ namespace Pong
 		// Bounce ball off bottom wall
 		if(m_position.y <= MIN_Y)
 		{
-			const float PROTRUSION_Y{ MIN_Y - m_position.y };
+			const PhysicsScalar PROTRUSION_Y{ MIN_Y - m_position.y };
 			m_position.y = MIN_Y + PROTRUSION_Y;
 			m_velocity.y = -m_velocity.y;
 		}
 	}
-	const b2Vec2& Puck::GetPosition() const
+	b2Vec2 Puck::GetPosition() const
 	{
-		return m_position;
+		return PhysicsMath::ToB2Vec2(m_position);
 	}
-	const b2Vec2& Puck::GetVelocity() const
+	b2Vec2 Puck::GetVelocity() const
 	{
-		return m_velocity;
+		return PhysicsMath::ToB2Vec2(m_velocity);
 	}
 	void Puck::SetPosition(const b2Vec2& position)
 	{
-		m_position = position;
+		m_position = PhysicsMath::ToPhysics(position);
 	}
 	void Puck::SetVelocity(const b2Vec2& velocity)
 	{
-		m_velocity = velocity;
+		m_velocity = PhysicsMath::ToPhysics(velocity);
 	}
-	void Puck::HandlePlayerCollision(const Player& player)
+	void Puck::HandlePlayerCollision(const Player& player, const RulesDef& rules)
 	{
-		float overlapX;
+		const PhysicsVec2& playerPosition{ player.GetPhysicsPosition() };
+		const PhysicsVec2 playerSize{ PhysicsMath::ToPhysics(PLAYER_SIZE) };
+		const PhysicsVec2 puckSize{ PhysicsMath::ToPhysics(PUCK_SIZE) };
+		const PhysicsScalar ZERO{ 0.0f };
+		const PhysicsScalar ONE{ 1.0f };
+		PhysicsScalar overlapX;
 
 		// How much did the puck go past front of player along the x-axis?
 		if(player.GetSide() == Side::LEFT)
-			overlapX = (player.GetPosition().x + PLAYER_SIZE.x) - m_position.x;
+			overlapX = (playerPosition.x + playerSize.x) - m_position.x;
 		else
-			overlapX = (m_position.x + PUCK_SIZE.x) - player.GetPosition().x;
+			overlapX = (m_position.x + puckSize.x) - playerPosition.x;
 
 		// If puck went past front of player along x-axis
-		if(overlapX >= 0.0f)
+		if(overlapX >= ZERO)
 		{
 			// If the ball is traveling towards the player
-			if((m_velocity.x < 0.0f && player.GetSide() == Side::LEFT) ||
-				(m_velocity.x > 0.0f && player.GetSide() == Side::RIGHT))
+			if((m_velocity.x < ZERO && player.GetSide() == Side::LEFT) ||
+				(m_velocity.x > ZERO && player.GetSide() == Side::RIGHT))
 			{
 				// If there is separation along the Y-axis
-				if(m_position.y > player.GetPosition().y + PLAYER_SIZE.y ||
-					m_position.y + PUCK_SIZE.y < player.GetPosition().y)
+				if(m_position.y > playerPosition.y + playerSize.y ||
+					m_position.y + puckSize.y < playerPosition.y)
 				{
 					// The paddle missed
 					m_gotPastPlayer = true;
@@ -1133,53 +1784,54 @@ namespace Pong
 				else
 				{
 					// Take ball back in time to where overlap along the x-axis occured.
-					float secondsSinceOverlap = overlapX / std::abs(m_velocity.x);
+					PhysicsScalar secondsSinceOverlap = overlapX / PhysicsMath::Abs(m_velocity.x);
 					m_position -= secondsSinceOverlap * m_velocity;
 
 					// Reverse direction
 					m_velocity.x = -m_velocity.x;
+					m_hitPlayer = true;
 
 					// Convert ball's velocity to polar coordinates
-					float angleOut = atan2(m_velocity.y, m_velocity.x);
-					float speed = sqrtf(powf(m_velocity.x, 2) + powf(m_velocity.y, 2));
+					PhysicsScalar angleOut = PhysicsMath::Atan2(m_velocity.y, m_velocity.x);
+					PhysicsScalar speed = PhysicsMath::Length(m_velocity);
 
 					// Simulate curved paddle
 					{
 						// Determine how far off the player's center the ball hit
-						float hitRangeBottom = player.GetPosition().y - PUCK_SIZE.y;
-						float hitRangeTop = player.GetPosition().y + PLAYER_SIZE.y;
-						float hitRangeLength = hitRangeTop - hitRangeBottom;
-						float puckPercentFromBottom = (m_position.y - hitRangeBottom) / hitRangeLength;
+						PhysicsScalar hitRangeBottom = playerPosition.y - puckSize.y;
+						PhysicsScalar hitRangeTop = playerPosition.y + playerSize.y;
+						PhysicsScalar hitRangeLength = hitRangeTop - hitRangeBottom;
+						PhysicsScalar puckPercentFromBottom = (m_position.y - hitRangeBottom) / hitRangeLength;
 
 						// Convert to a range of [-1,1] 
-						float puckPercentFromCenterToEdge = puckPercentFromBottom * 2.0f - 1.0f;
-						d2d::Clamp(puckPercentFromCenterToEdge, { -1.0f, 1.0f });
+						PhysicsScalar puckPercentFromCenterToEdge = puckPercentFromBottom * PhysicsScalar{ 2.0f } - ONE;
+						puckPercentFromCenterToEdge = std::clamp(puckPercentFromCenterToEdge, -ONE, ONE);
 
 						// Change angle based on how far off center it hit the player
-						float angleChange = MAX_CURVATURE_ANGLE_CHANGE * puckPercentFromCenterToEdge;
+						PhysicsScalar angleChange = PhysicsScalar{ rules.maxCurvatureAngleChange } * puckPercentFromCenterToEdge;
 						if(player.GetSide() == Side::LEFT)
 							angleOut += angleChange;
 						else
 							angleOut -= angleChange;
-						d2d::WrapRadians(angleOut);
+						PhysicsMath::WrapRadians(angleOut);
 					}
 
 					// Clamp angle to range
-					float angleLimitTop, angleLimitBottom;
-					float halfAngleRange = BOUNCE_ANGLE_RANGE / 2.0f;
+					PhysicsScalar angleLimitTop, angleLimitBottom;
+					PhysicsScalar halfAngleRange{ 0.5f * rules.bounceAngleRange };
 					if(player.GetSide() == Side::LEFT)
 					{
 						angleLimitTop = halfAngleRange;
-						angleLimitBottom = d2d::TWO_PI - halfAngleRange;
-						if(angleOut > angleLimitTop&& angleOut < d2d::PI)
+						angleLimitBottom = PhysicsMath::TWO_PI - halfAngleRange;
+						if(angleOut > angleLimitTop&& angleOut < PhysicsMath::PI)
 							angleOut = angleLimitTop;
-						else if(angleOut < angleLimitBottom && angleOut >= d2d::PI)
+						else if(angleOut < angleLimitBottom && angleOut >= PhysicsMath::PI)
 							angleOut = angleLimitBottom;
 					}
 					else
 					{
-						angleLimitTop = d2d::PI - halfAngleRange;
-						angleLimitBottom = d2d::PI + halfAngleRange;
+						angleLimitTop = PhysicsMath::PI - halfAngleRange;
+						angleLimitBottom = PhysicsMath::PI + halfAngleRange;
 						if(angleOut < angleLimitTop)
 							angleOut = angleLimitTop;
 						else if(angleOut > angleLimitBottom)
@@ -1187,8 +1839,8 @@ namespace Pong
 					}
 
 					// Apply new angle with extra 2% speed boost
-					m_velocity.Set(cos(angleOut), sin(angleOut));
-					m_velocity *= speed * PUCK_SPEED_BOOST_MULTIPLIER;
+					m_velocity.Set(PhysicsMath::Cos(angleOut), PhysicsMath::Sin(angleOut));
+					m_velocity *= speed * PhysicsScalar{ rules.puckSpeedBoostMultiplier };
 
 					// Now that ball is going in the right direction...
 					// Give time back
@@ -1197,21 +1849,59 @@ namespace Pong
 			}
 		}
 	}
+	void Puck::HandlePuckCollision(Puck& other)
+	{
+		// Equal mass elastic collision between two axis-aligned boxes. Separate along
+		// the axis of least penetration and swap velocities along it if approaching.
+		const PhysicsVec2 puckSize{ PhysicsMath::ToPhysics(PUCK_SIZE) };
+		const PhysicsScalar ZERO{ 0.0f };
+		const PhysicsScalar HALF{ 0.5f };
+
+		PhysicsVec2 offset{ other.m_position - m_position };
+		PhysicsScalar overlapX{ puckSize.x - PhysicsMath::Abs(offset.x) };
+		PhysicsScalar overlapY{ puckSize.y - PhysicsMath::Abs(offset.y) };
+		if(overlapX <= ZERO || overlapY <= ZERO)
+			return;
+
+		if(overlapX < overlapY)
+		{
+			PhysicsScalar push{ offset.x < ZERO ? -HALF * overlapX : HALF * overlapX };
+			m_position.x -= push;
+			other.m_position.x += push;
+			if((other.m_velocity.x - m_velocity.x) * offset.x < ZERO)
+				std::swap(m_velocity.x, other.m_velocity.x);
+		}
+		else
+		{
+			// The lower puck goes down and the upper one up, half each. A puck against a
+			// wall can't give way, so the other takes the rest; pushed out of the field,
+			// UpdatePosition would bounce it off a wall it never hit.
+			const PhysicsScalar MIN_Y{ GAME_RECT.lowerBound.y };
+			const PhysicsScalar MAX_Y{ GAME_RECT.upperBound.y - PUCK_SIZE.y };
+			Puck& lower{ offset.y < ZERO ? other : *this };
+			Puck& upper{ offset.y < ZERO ? *this : other };
+			PhysicsScalar lowerRoom{ std::max(lower.m_position.y - MIN_Y, ZERO) };
+			PhysicsScalar upperRoom{ std::max(MAX_Y - upper.m_position.y, ZERO) };
+			PhysicsScalar lowerPush{ std::min(HALF * overlapY, lowerRoom) };
+			PhysicsScalar upperPush{ std::min(overlapY - lowerPush, upperRoom) };
+			lowerPush = std::min(overlapY - upperPush, lowerRoom);
+			lower.m_position.y = std::clamp(lower.m_position.y - lowerPush, MIN_Y, MAX_Y);
+			upper.m_position.y = std::clamp(upper.m_position.y + upperPush, MIN_Y, MAX_Y);
+			if((other.m_velocity.y - m_velocity.y) * offset.y < ZERO)
+				std::swap(m_velocity.y, other.m_velocity.y);
+		}
+	}
 	void Puck::HandleGoal(Player& player)
 	{
 		if(m_scored)
 			return;
 
-		if((player.GetSide() == Side::LEFT && m_position.x + PUCK_SIZE.x >= GAME_RECT.upperBound.x) ||
-			(player.GetSide() == Side::RIGHT && m_position.x <= GAME_RECT.lowerBound.x))
+		const PhysicsScalar PUCK_WIDTH{ PUCK_SIZE.x };
+		if((player.GetSide() == Side::LEFT && m_position.x + PUCK_WIDTH >= PhysicsScalar{ GAME_RECT.upperBound.x }) ||
+			(player.GetSide() == Side::RIGHT && m_position.x <= PhysicsScalar{ GAME_RECT.lowerBound.x }))
 		{
 			player.ScorePoint();
 			m_scored = true;
 		}
 	}
-	void Puck::Draw() const
-	{
-		d2d::Window::SetColor(PUCK_COLOR);
-		d2d::Window::DrawRect({ m_position, m_position + PUCK_SIZE }, true);
-	}
-}
\ No newline at end of file
+}
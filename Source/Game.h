@@ -11,6 +11,13 @@
 #include "d2d.h"
 #include "NetworkDef.h"
 #include "GameInitSettings.h"
+#include "RulesDef.h"
+#include "PhysicsMath.h"
+#include "PuckGrid.h"
+#include "UdpSocket.h"
+#include "TcpConnector.h"
+#include "SnapshotDelta.h"
+#include "ClockSync.h"
 #include "Exceptions.h"
 
 namespace Pong
@@ -21,25 +28,21 @@ namespace Pong
 	const b2Vec2 PUCK_SIZE{ 0.01f * GAME_RECT.GetWidth(), 
 							0.01f * GAME_RECT.GetWidth() };
 
-	const unsigned SCORE_TO_WIN{ 3u };
 	const float INITIAL_COUNTDOWN{ 3.0f };
-	const float INITIAL_PUCK_SPEED{ 0.35f * GAME_RECT.GetWidth() };
-	const float START_ANGLE{ 0.2f * d2d::PI };
-	const float BOUNCE_ANGLE_RANGE{ 0.72f * d2d::PI };
-	const float MAX_CURVATURE_ANGLE_CHANGE = d2d::PI / 4.0f;
-
-	const float PUCK_SPEED_BOOST_MULTIPLIER{ 1.07f };
-	//const float PLAYER_MAX_SPEED{ 0.9f * INITIAL_PUCK_SPEED };
-	const float PLAYER_MAX_SPEED{ 250.0f };
-
 	const d2d::Color BOUNDARY_COLOR{ 0.8f, 0.3f, 0.3f };
 	const d2d::Color NET_COLOR{ 0.8f, 0.3f, 0.3f };
 	const d2d::Color PLAYER_COLOR{ 0.8f, 0.3f, 0.3f };
 	const d2d::Color PUCK_COLOR{ 0.8f, 0.3f, 0.3f };
+	// A client's puck draws a correction from the server away over about this long,
+	// unless it's further off than MAX_SMOOTHED_PUCK_CORRECTION, like a serve
+	const float PUCK_CORRECTION_SECONDS{ 0.1f };
+	const float MAX_SMOOTHED_PUCK_CORRECTION{ 0.1f * GAME_RECT.GetWidth() };
+	const float MIN_SMOOTHED_PUCK_CORRECTION{ 0.001f };	// Closer than this, it's done
+	const float BOUNDARY_THICKNESS{ 0.005f * GAME_RECT.GetHeight() };
+	const float NET_THICKNESS{ 0.005f * GAME_RECT.GetHeight() };
 
 	const float SLIGHTLY_LESS_THAN_ONE{ 0.99999f };
 
-	const Uint32 TCP_SERVER_CHECK_FOR_CLIENT_CONNECTION_TIMEOUT_MILLISECONDS{ 15 };
 	const float MAX_TIME_TO_WAIT_FOR_CLIENT_UDP{ 10.0f };
 
 	using Byte = Uint8;
@@ -47,14 +50,32 @@ namespace Pong
 	const Byte TCP_MESSAGE_CLIENT_INIT_UDP_TIMEOUT = 101;
 	const Byte TCP_MESSAGE_PLAYER_READY = 102;
 	const Byte TCP_MESSAGE_PLAYER_SCORED = 103;
-	const Byte UDP_MESSAGE_COUNTDOWN_LEFT = 104;
 	const Byte TCP_MESSAGE_COUNTDOWN_OVER = 105;
-	const Byte UDP_MESSAGE_PUCK_POSITION_VELOCITY = 106;
 	const Byte UDP_MESSAGE_PLAYER_Y = 107;
 	const Byte TCP_MESSAGE_PLAYER_QUIT = 108;
-
-	const int BUFFER_SIZE{ 100 };
+	const Byte TCP_MESSAGE_REMATCH = 109;
+	const Byte UDP_MESSAGE_SNAPSHOT = 110;
+	const Byte UDP_MESSAGE_SNAPSHOT_ACK = 111;
+	const Byte TCP_MESSAGE_COUNTDOWN_END = 112;
+	const Byte UDP_MESSAGE_TIME_REQUEST = 113;
+	const Byte UDP_MESSAGE_TIME_RESPONSE = 114;
+	const Byte TCP_MESSAGE_RULES = 115;
+
+	// A RULES message: the server's RulesDef, six floats then scoreToWin and puckCount
+	const int RULES_MESSAGE_BYTES{ 1 + 6 * sizeof(float) + 2 * sizeof(Uint32) };
+
+	// A SNAPSHOT chunk: sequence number, baseline age (0 for none), total pucks, first puck,
+	// puck count and flags, then the server's paddle Y if flagged and the pucks (see SnapshotDelta)
+	const int SNAPSHOT_HEADER_BYTES{ 1 + sizeof(unsigned) + sizeof(Byte) + 2 * sizeof(Uint16) + 2 * sizeof(Byte) };
+	const Byte SNAPSHOT_HAS_PADDLE{ 1 << 0 };
+	// No pucks follow: all of them are where the baseline predicts
+	const Byte SNAPSHOT_PUCKS_PREDICTED{ 1 << 1 };
+
+	// Large enough for a multi-puck snapshot chunk, small enough to not fragment
+	const int BUFFER_SIZE{ 1200 };
 	using ByteBuffer = Byte[BUFFER_SIZE];
+	// Datagrams drained per receive call; a peer sends about one per frame
+	const int UDP_RECEIVE_BATCH{ 4 };
 	struct Buffer
 	{
 		ByteBuffer bytes;
@@ -87,30 +108,68 @@ namespace Pong
 		void WriteByte(Byte value)
 		{
 			if(length + sizeof(Byte) > BUFFER_SIZE)
-				throw GameException{ "Buffer::WriteByte: Overflow: Increase buffer size" };
+				Fail("Buffer::WriteByte: Overflow: Increase buffer size");
 			bytes[length] = value;
 			++length;
 		}
+		void WriteUInt64(Uint64 value)
+		{
+			WriteUInt((unsigned)(value >> 32));
+			WriteUInt((unsigned)value);
+		}
+		Uint64 ReadUInt64(int index) const
+		{
+			if(index < 0 || index + (int)sizeof(Uint64) > length)
+				Fail("Buffer::ReadUInt64: out of range");
+			return ReadUInt64(&bytes[index]);
+		}
+		static Uint64 ReadUInt64(const Byte* bytes)
+		{
+			return ((Uint64)SDLNet_Read32(bytes) << 32) | SDLNet_Read32(bytes + sizeof(Uint32));
+		}
 		void WriteUInt(unsigned value)
 		{
 			static_assert(sizeof(Uint32) == sizeof(unsigned));
 			if(length + sizeof(unsigned) > BUFFER_SIZE)
-				throw GameException{ "Buffer::WriteUInt: Overflow: Increase buffer size" };
+				Fail("Buffer::WriteUInt: Overflow: Increase buffer size");
 			SDLNet_Write32(value, &bytes[length]);
 			length += sizeof(Uint32);
 		}
+		void WriteUInt16(Uint16 value)
+		{
+			if(length + sizeof(Uint16) > BUFFER_SIZE)
+				Fail("Buffer::WriteUInt16: Overflow: Increase buffer size");
+			SDLNet_Write16(value, &bytes[length]);
+			length += sizeof(Uint16);
+		}
+		// 7 bits per byte, low bits first; the high bit means more bytes follow
+		void WriteVarUInt(unsigned value)
+		{
+			do
+			{
+				Byte next{ (Byte)(value & 0x7F) };
+				value >>= 7;
+				WriteByte(value ? (Byte)(next | 0x80) : next);
+			} while(value);
+		}
+		Uint16 ReadUInt16(int index) const
+		{
+			if(index < 0 || index + (int)sizeof(Uint16) > length)
+				Fail("Buffer::ReadUInt16: out of range");
+			return SDLNet_Read16(&bytes[index]);
+		}
 		unsigned ReadUInt(int index) const
 		{
 			static_assert(sizeof(Uint32) == sizeof(unsigned));
 			if(index < 0 || index + (int)sizeof(unsigned) > length)
-				throw GameException{ "Buffer::ReadUInt: out of range" };
+				Fail("Buffer::ReadUInt: out of range");
 			return SDLNet_Read32(&bytes[index]);
 		}
 		void WriteFloat(float value)
 		{
 			static_assert(sizeof(Uint32) == sizeof(float));
 			if(length + sizeof(float) > BUFFER_SIZE)
-				throw GameException{ "Buffer::WriteFloat: Overflow: Increase buffer size" };
+				Fail("Buffer::WriteFloat: Overflow: Increase buffer size");
 			union { float f; Uint32 i; } u;
 			u.f = value;
 			SDLNet_Write32(u.i, &bytes[length]);
@@ -118,17 +177,21 @@ namespace Pong
 		}
 		float ReadFloat(int index) const
 		{
-			static_assert(sizeof(Uint32) == sizeof(float));
 			if(index < 0 || index + (int)sizeof(float) > length)
-				throw GameException{ "Buffer::ReadFloat: out of range" };
+				Fail("Buffer::ReadFloat: out of range");
+			return ReadFloat(&bytes[index]);
+		}
+		static float ReadFloat(const Byte* bytes)
+		{
+			static_assert(sizeof(Uint32) == sizeof(float));
 			union { float f; Uint32 i; } u;
-			u.i = SDLNet_Read32(&bytes[index]);
+			u.i = SDLNet_Read32(bytes);
 			return u.f;
 		}
 		void MakeNewFront(int newStartIndex)
 		{
 			if(newStartIndex < 0 || newStartIndex > length)
-				throw GameException{ "Buffer::MakeNewFront: out of range" };
+				Fail("Buffer::MakeNewFront: out of range");
 			if(newStartIndex == 0)
 				return;
 			int newLength{ length - newStartIndex };
@@ -136,6 +199,61 @@ namespace Pong
 				memmove(FirstBytePtr(), &bytes[newStartIndex], newLength);
 			length = newLength;
 		}
+
+		// Out of line so the inlined accessors don't carry exception construction code
+		[[noreturn]] static void Fail(const char* message);
+	};
+
+	// TCP messages are framed as a varint length followed by that many bytes: the
+	// message type, then its payload. Receivers skip types they don't know.
+	const int MAX_TCP_MESSAGE_SIZE{ 64 * 1024 };
+	const int MAX_VAR_UINT_BYTES{ 5 };
+	// Free space guaranteed at the back before each TCP receive
+	const int TCP_MIN_RECEIVE_SIZE{ 256 };
+	// Unsent TCP output allowed before the peer is treated as gone
+	const int MAX_TCP_QUEUED_BYTES{ 4 * MAX_TCP_MESSAGE_SIZE };
+	// Queue for a byte stream. Bytes are added at the back and consumed from the front:
+	// whole messages as input is parsed, or whatever was sent for output. The unconsumed
+	// remainder moves to the front only when the back runs out of room, and the storage
+	// grows when it still doesn't fit.
+	struct StreamBuffer
+	{
+		std::vector<Byte> bytes = std::vector<Byte>(BUFFER_SIZE);
+		int readIndex{ 0 };	// Bytes before this have been parsed
+		int length{ 0 };	// Bytes before this have been received
+
+		void Clear()
+		{
+			readIndex = 0;
+			length = 0;
+		}
+		int UnreadBytes() const
+		{
+			return length - readIndex;
+		}
+		const Byte* FirstUnreadBytePtr() const
+		{
+			return bytes.data() + readIndex;
+		}
+		Byte* FirstAvailableBytePtr()
+		{
+			return bytes.data() + length;
+		}
+		int BytesAvailable() const
+		{
+			return (int)bytes.size() - length;
+		}
+		// Makes room for at least byteCount more bytes at the back
+		void Reserve(int byteCount);
+		// Append at the back, growing the storage if needed
+		void Write(const Byte* data, int byteCount);
+		void WriteVarUInt(unsigned value);
+		// Marks bytes as parsed. Once everything is parsed the buffer starts over at
+		// the front, so the common case moves no bytes.
+		void Consume(int byteCount);
+		// Decodes a varint starting index bytes past readIndex. Returns the number of
+		// bytes it took, or 0 if the rest of it hasn't arrived yet.
+		int ReadVarUInt(int index, unsigned& value) const;
 	};
 
 	enum class Side
@@ -151,179 +269,296 @@ namespace Pong
 		unsigned GetScore() const;
 		void ScorePoint();
 		Side GetSide() const;
-		const b2Vec2& GetPosition() const;
+		b2Vec2 GetPosition() const;
+		const PhysicsVec2& GetPhysicsPosition() const;
 		bool IsReady() const;
 		void SetReady();
 		void SetMovementFactor(float factor);
 		void SetY(float newY);
-		void Update(float dt);
-		void Draw() const;
+		void Update(float dt, const RulesDef& rules);
 
 	private:
 		unsigned m_score;
 		Side m_side;
 
-		b2Vec2 m_position;	// Lower-left corner
-		float m_movementFactor;
+		PhysicsVec2 m_position;	// Lower-left corner
+		PhysicsScalar m_movementFactor;
 		bool m_isReady;
 	};
 
 	struct Puck
 	{
 	public:
-		void ResetRound();
+		static float GetRandomStartAngle(const RulesDef& rules);
+		// A client's puck follows server snapshots: it only moves, and serves without velocity
+		void SetFollowsServer(bool followsServer);
+		void ResetRound(const RulesDef& rules);
+		void ResetRound(const RulesDef& rules, float startAngle);
+		void ResetRound(const RulesDef& rules, const b2Vec2& startPosition, float startAngle);
 		bool Scored() const;
-		void Update(float dt, Player& player1, Player& player2);
-		const b2Vec2& GetPosition() const;
-		const b2Vec2& GetVelocity() const;
+		// During the last Update
+		bool HitPlayer() const;
+		void Update(float dt, const RulesDef& rules, Player& player1, Player& player2);
+		void HandlePuckCollision(Puck& other);
+		b2Vec2 GetPosition() const;
+		b2Vec2 GetVelocity() const;
 		void SetPosition(const b2Vec2& position);
 		void SetVelocity(const b2Vec2& velocity);
-		void Draw() const;
+		// Moves as Update would if nothing but walls were hit
+		void Extrapolate(float dt, unsigned steps);
+		// For a puck that follows the server: takes the new state, but keeps drawing
+		// near the old position for a moment so small corrections don't jump
+		void CorrectTo(const b2Vec2& position, const b2Vec2& velocity);
+		b2Vec2 GetDrawPosition() const;
 
 	private:
-		b2Vec2 m_position;	// Lower-left corner
-		b2Vec2 m_velocity;
+		PhysicsVec2 m_position;	// Lower-left corner
+		PhysicsVec2 m_velocity;
+		b2Vec2 m_drawOffset{ b2Vec2_zero };
 		bool m_gotPastPlayer;
 		bool m_scored;
+		bool m_hitPlayer{ false };
+		bool m_followsServer{ false };
 
 		void UpdatePosition(float dt);
-		void HandlePlayerCollision(const Player& player);
+		void HandlePlayerCollision(const Player& player, const RulesDef& rules);
 		void HandleGoal(Player& player);
 	};
 
 	class Game
 	{
 	public:
+		enum class GameState
+		{
+			CONNECT_TO_SERVER,
+			WAIT_FOR_CLIENT_TCP_CONNECTION,
+			CONFIRM_PLAYERS_READY,
+			COUNTDOWN,
+			PLAY,
+			GAME_OVER,
+			GAME_OVER_DEFAULT_WIN
+		};
+
+		// Everything Draw needs, copied out of the simulation so it can be drawn on another thread
+		struct Snapshot
+		{
+			struct PlayerView
+			{
+				b2Vec2 position;
+				unsigned score;
+				Side side;
+				bool isReady;
+				bool wantsRematch;
+			};
+			GameState state{ GameState::CONFIRM_PLAYERS_READY };
+			float countdownSecondsLeft{ 0.0f };
+			int connectAttempt{ 0 };
+			bool canRematch{ false };
+			PlayerView player1, player2;
+			std::vector<b2Vec2> puckPositions;
+		};
+
+		// Simulation state carried from one step to the next, apart from the pucks,
+		// whose number varies. Trivially copyable and one cache line, so many matches
+		// pack densely on a server and rollback or replay can save it with a copy.
+		struct alignas(64) MatchState
+		{
+			GameState state{ GameState::CONFIRM_PLAYERS_READY };
+			float countdownSecondsLeft{ 0.0f };
+			Player player1, player2;
+			bool player1WantsRematch{ false };
+			bool player2WantsRematch{ false };
+		};
+		static_assert(std::is_trivially_copyable_v<MatchState> && std::is_trivially_copyable_v<Puck>,
+			"Match state and pucks are saved and restored by copying bytes");
+		static_assert(sizeof(MatchState) == 64, "MatchState should fit one cache line");
+
+		// Everything needed to rewind the simulation. Saving into the same object
+		// again reuses the puck capacity, so it doesn't allocate.
+		struct SavedState
+		{
+			MatchState match;
+			std::vector<Puck> pucks;
+		};
+
+		// Something to tell the player that doesn't end the game. Game never shows UI
+		// itself, since it may run on a simulation thread.
+		struct Notice
+		{
+			Uint32 messageBoxFlags{ 0 };	// SDL_MESSAGEBOX_INFORMATION, WARNING or ERROR
+			std::string title;
+			std::string text;
+		};
+
+		// Told about remote state as it is applied, so a harness can time the netcode
+		class NetworkObserver
+		{
+		public:
+			virtual ~NetworkObserver() = default;
+			virtual void OnRemotePlayerY(float y) = 0;
+			virtual void OnPuckReceived(size_t puckIndex, const b2Vec2& position) = 0;
+		};
+
+		// Uses the mode from GameInitSettings and network settings from Data\network.hjson
 		void Init();
+		// Lets a server and a client run side by side in one process
+		void Init(GameInitSettings::Mode mode, const NetworkDef& networkSettings);
+		void SetNetworkObserver(NetworkObserver* observerPtr);
 		void Update(float dt);
-		void Draw() const;
+		void WriteSnapshot(Snapshot& snapshot) const;
+
+		// Network state is not saved; loading is meant for local rollback and replay
+		void SaveState(SavedState& saved) const;
+		void LoadState(const SavedState& saved);
+
+		// This object plus the heap memory it owns
+		size_t GetMemoryBytes() const;
+		// A client's estimate of the server's clock
+		const ClockSync& GetClockSync() const;
+		// Returns false if there's nothing new. Only the latest notice is kept.
+		bool TakeNotice(Notice& notice);
+
+		// A server with no client has nothing to simulate. Rather than tick, its
+		// thread can block until a client knocks or maxSeconds pass.
+		bool IsWaitingForPeer() const;
+		void WaitForPeer(float maxSeconds);
 
 		~Game();
 		void OnQuit();
 
+		// Also asks for a rematch once the game is over
 		void Player1PressedAButton();
 		void Player2PressedAButton();
 		void SetPlayer1MovementFactor(float factor); // [-1.0,1.0]
 		void SetPlayer2MovementFactor(float factor); // [-1.0,1.0]
 
+		// Message parsing doesn't touch sockets, so it can also be fed synthetic data
+		// Consumes every complete message; a partial one stays buffered
+		void ProcessMessagesTCP(StreamBuffer& data);
+		// message[0] is the type, followed by size - 1 bytes of payload
+		void ProcessMessageTCP(const Byte* message, int size);
+
+		// Messages that carry times take receiveTime as when the datagram arrived
+		void ProcessMessagesUDP(Buffer& data, double receiveTime = 0.0);
+		// Returns start of next message
+		int ProcessMessageUDP(const Buffer& data, int first);
+
 	private:
+		bool IsClient() const;
+		bool IsServer() const;
+		bool IsNetworked() const;
+
 		void ResetRound();
+		void StartCountdown();
+		void PostNotice(Uint32 messageBoxFlags, const std::string& title, const std::string& text);
+		// The server's rules are the match's; a client adopts them on connecting
+		void WriteRules();
+		void ReadRules(const Byte* message, int size);
+		// Once both players asked, starts the next game on the same connection
+		bool CanRematch() const;
+		void StartRematchIfAgreed();
+		void SetPuckCount(size_t count);
+		void ServePuck(Puck& puck);
+		void HandlePuckCollisions();
+		bool IsMultiPuck() const;
 
 		void UpdateUDPInit(float dt);
 
+		void StartConnectAttempt();
+		void UpdateConnectToServer(float dt);
+		void FinishConnectToServer();
+
 		void UpdateWaitForClientTCPConnection(float dt);
 		void UpdateConfirmPlayersReady(float dt);
 		void UpdateCountdown(float dt);
 		void UpdatePlay(float dt);
 
-		void DrawPlayerResult(Side playerSide, bool isWinner) const;
-		void DrawCountdown() const;
-		void DrawScore(const Player& player) const;
-		void DrawWaitingMessage(const Player& player) const;
-
 		void InitNetwork();
+		// Closes everything but a server's listening socket, which stays open for the next game
 		void CloseNetwork();
+		void CloseListener();
+		// While a client is connected, the server accepts and closes anyone else
+		void RefuseExtraClient();
 		void SendNetworkData();
+		void SendDataTCP();
+		void SendDataUDP();
+		void WriteMessageTCP(Byte messageType, const Byte* payload = nullptr, int payloadSize = 0);
+		Buffer& GetOutputBufferUDP();
+		void StartNextOutputBufferUDP();
+		void WriteNetworkSnapshot();
+		void WriteSnapshotAck();
+		void WriteTimeRequest();
+		// Where a puck in a snapshot will be after ticks more simulation steps, if it hits nothing
+		SnapshotDelta::PuckState PredictPuck(const SnapshotDelta::PuckState& from, unsigned ticks) const;
 		void CheckMessages();
 		bool TCPReady() const;
 		void GetDataTCP();
-		bool GetDataUDP();
-
-		void ProcessMessagesTCP(Buffer& data);
-		// Returns start of next message
-		int ProcessMessageTCP(const Buffer& data, int first);
-
-		void ProcessMessagesUDP(Buffer& data);
-		// Returns start of next message
-		int ProcessMessageUDP(const Buffer& data, int first);
+		// Returns the number of datagrams received. drainedCount gets how many
+		// were taken off the socket, including any that were dropped.
+		int GetDataUDP(int& drainedCount);
 
 		// Game
-		enum class GameState
-		{
-			WAIT_FOR_CLIENT_TCP_CONNECTION,
-			CONFIRM_PLAYERS_READY,
-			COUNTDOWN,
-			PLAY,
-			GAME_OVER,
-			GAME_OVER_DEFAULT_WIN
-		} m_state;
-		Player m_player1, m_player2;
-		Puck m_puck;
-		float m_countdownSecondsLeft;
+		GameInitSettings::Mode m_mode{ GameInitSettings::Mode::LOCAL };
+		MatchState m_match;
+		RulesDef m_rules;
+		std::vector<Puck> m_pucks;
+		PuckGrid m_puckGrid;
+		std::vector<PuckGrid::Pair> m_puckPairs;
 
 		// Network
 		NetworkDef m_networkSettings;
+		NetworkObserver* m_networkObserverPtr{ nullptr };
+		Notice m_notice;
+		bool m_hasNotice{ false };
 		TCPsocket m_clientSocketTCP{ nullptr };
-		UDPsocket m_clientSocketUDP{ nullptr };
+		UdpSocket m_socketUDP;
+		IPaddress m_peerAddressUDP{};
 		SDLNet_SocketSet m_socketSet{ nullptr };
-		Buffer m_inputBufferTCP;
-		Buffer m_outputBufferTCP;
-		Buffer m_inputBufferUDP;
-		Buffer m_outputBufferUDP;
+		StreamBuffer m_inputBufferTCP;
+		StreamBuffer m_outputBufferTCP;	// Unsent bytes wait here for the next send
+		// Packets point at the buffers, so datagrams are parsed where they land
+		Buffer m_inputBuffersUDP[UDP_RECEIVE_BATCH];
+		UDPpacket m_inputPacketsUDP[UDP_RECEIVE_BATCH]{};
+		double m_inputReceiveTimesUDP[UDP_RECEIVE_BATCH]{};
+		double m_receiveTimeUDP{ 0.0 };	// Of the datagram being parsed
+		// One datagram per buffer, all sent in one batch at the end of the frame
+		std::vector<Buffer> m_outputBuffersUDP = std::vector<Buffer>(1);
+		size_t m_outputBufferUDPIndex{ 0 };
+		std::vector<UDPpacket> m_outputPacketsUDP;
 		unsigned m_nextUDPSequenceNum{ 0 };
+		unsigned m_droppedSendsUDP{ 0 };
 		unsigned m_lastUDPPlayerSequenceNum{ 0 };
-		UDPpacket* m_inputUDPPacketPtr{ nullptr };
-		UDPpacket* m_outputUDPPacketPtr{ nullptr };
+		// Server: snapshots sent. Client: snapshots received.
+		SnapshotDelta::History m_snapshotHistory;
+		// Server: newest snapshot the client has in full. Client: newest one to acknowledge.
+		unsigned m_snapshotAck{ 0 };
+		bool m_hasSnapshotAck{ false };
+		// Both peers step at the same fixed rate, which snapshots predict pucks with
+		float m_tickSeconds{ 0.0f };
 		bool m_serverWaitingForClientUDP{ false };
 		bool m_serverTimedOutWaitingForClientUDP{ false };
+		Uint32 m_networkStartTicks{ 0 };	// For logging time to ready
+		bool m_peerLeft{ false };	// After a game, so there's no rematch
 
 		// For server use only
-		TCPsocket m_serverSocketTCP{ nullptr };
+		TCPsocket m_serverSocketTCP{ nullptr };	// Listening, kept open between games
+		int m_listeningPort{ 0 };
+		unsigned m_lastSentSnapshot{ 0 };	// For the heartbeat
+		std::vector<SnapshotDelta::PuckState> m_predictedPucks;
 		float m_timeWaitingForClientUDP{ 0.0f };
+		double m_countdownEndTime{ 0.0 };
 
 		// For client use only
-		unsigned m_lastUDPCountdownSequenceNum{ 0 };
-		unsigned m_lastUDPPuckSequenceNum{ 0 };
-
-		// Assets
-		d2d::FontReference m_orbitronLightFont{ "Fonts\\OrbitronLight.otf" };
-
-		// Text
-		const b2Vec2 edgeGapPercent{ 0.015f, 0.015f };
-
-		// FPS text
-		const b2Vec2 m_fpsPosition{ GAME_RECT.GetPointAtPercent(b2Vec2{1.0f, 1.0f } - edgeGapPercent) };
-		const d2d::Alignment m_fpsAlignment{ d2d::Alignment::RIGHT_TOP };
-		const d2d::TextStyle m_fpsTextStyle{ m_orbitronLightFont, { 1.0f, 1.0f, 0.0f }, 0.05f * GAME_RECT.GetHeight() };
-
-		// Score text
-		const b2Vec2 m_scoreLeftPosition{ GAME_RECT.GetPointAtPercent({ 0.5f - edgeGapPercent.x, 1.0f - edgeGapPercent.y }) };
-		const d2d::Alignment m_scoreLeftAlignment{ d2d::Alignment::RIGHT_TOP };
-		
-		const b2Vec2 m_scoreRightPosition{ GAME_RECT.GetPointAtPercent({ 0.5f + edgeGapPercent.x, 1.0f - edgeGapPercent.y }) };
-		const d2d::Alignment m_scoreRightAlignment{ d2d::Alignment::LEFT_TOP };
-		
-		const d2d::TextStyle m_scoreTextStyle{ m_orbitronLightFont, { 1.0f, 1.0f, 0.0f }, 0.05f * GAME_RECT.GetHeight() };
-
-		// Waiting for client text
-		const std::string m_waitingForClientText{ "Waiting for client to connect..." };
-
-		// Waiting for player text
-		const std::string m_waitingForRemotePlayerText{ "Waiting for player to press a button..." };
-
-		const std::string m_waitingForPlayerLeftText{ "Press W or S when ready" };
-		const b2Vec2 m_waitingForPlayerLeftPosition{ GAME_RECT.GetPointAtPercent({ 0.25f, 0.5f }) };
-		const d2d::Alignment m_waitingForPlayerLeftAlignment{ d2d::Alignment::CENTERED };
-
-		const std::string m_waitingForPlayerRightText{ "Press UP or DOWN when ready" };
-		const b2Vec2 m_waitingForPlayerRightPosition{ GAME_RECT.GetPointAtPercent({ 0.75f, 0.5f }) };
-		const d2d::Alignment m_waitingForPlayerRightAlignment{ d2d::Alignment::CENTERED };
-
-		const d2d::TextStyle m_waitingForPlayerTextStyle{ m_orbitronLightFont, { 1.0f, 1.0f, 0.0f }, 0.05f * GAME_RECT.GetHeight() };
-
-		// Countdown text
-		const b2Vec2 m_countdownPosition{ GAME_RECT.GetCenter() };
-		const d2d::Alignment m_countdownAlignment{ d2d::Alignment::CENTERED };
-		const d2d::TextStyle m_countdownTextStyle{ m_orbitronLightFont, { 1.0f, 1.0f, 0.0f }, 0.20f * GAME_RECT.GetHeight() };
-
-		// Result text
-		const std::string m_playerWinsText{ "You win!" };
-		const std::string m_playerLosesText{ "You lose!" };
-		const b2Vec2 m_playerResultLeftPosition{ GAME_RECT.GetPointAtPercent({ 0.25f, 0.5f }) };
-		const b2Vec2 m_playerResultRightPosition{ GAME_RECT.GetPointAtPercent({ 0.75f, 0.5f }) };
-		const d2d::Alignment m_playerResultLeftAlignment{ d2d::Alignment::CENTERED };
-		const d2d::Alignment m_playerResultRightAlignment{ d2d::Alignment::CENTERED };
-		const d2d::TextStyle m_playerWinsTextStyle{ m_orbitronLightFont, { 0.1f, 0.9f, 0.1f }, 0.10f * GAME_RECT.GetHeight() };
-		const d2d::TextStyle m_playerLosesTextStyle{ m_orbitronLightFont, { 0.6f, 0.1f, 0.1f }, 0.10f * GAME_RECT.GetHeight() };
+		TcpConnector m_connector;
+		int m_connectAttempt{ 0 };
+		float m_connectAttemptTime{ 0.0f };	// Or time waiting to retry
+		ClockSync m_clockSync;
+		double m_lastTimeRequestTime{ 0.0 };
+		// The server's countdown end, in server time
+		double m_countdownEndServerTime{ 0.0 };
+		// Until the clock is synchronized: the end as if the message took no time
+		double m_countdownEndUnsyncedTime{ 0.0 };
+		bool m_hasCountdownEnd{ false };
+		std::vector<unsigned> m_lastUDPPuckSequenceNums;
 	};
 }
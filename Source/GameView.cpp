@@ -0,0 +1,238 @@
+/**************************************************************************************\
+** File: GameView.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the GameView class
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "GameView.h"
+#include "Trace.h"
+
+namespace Pong
+{
+	void GameView::Init(GameInitSettings::Mode mode)
+	{
+		m_mode = mode;
+		InitStaticGeometry();
+		m_textCache.Clear();
+	}
+	bool GameView::IsClient() const
+	{
+		return m_mode == GameInitSettings::Mode::CLIENT;
+	}
+	bool GameView::IsServer() const
+	{
+		return m_mode == GameInitSettings::Mode::SERVER;
+	}
+	void GameView::InitStaticGeometry()
+	{
+		m_quadBatch.ClearStaticGeometry();
+		m_quadBatch.AddOutline(GAME_RECT, BOUNDARY_THICKNESS, BOUNDARY_COLOR);
+		{
+			float netCenterX{ GAME_RECT.GetCenter().x };
+			m_quadBatch.AddQuad({ { netCenterX - 0.5f * NET_THICKNESS, GAME_RECT.lowerBound.y },
+								  { netCenterX + 0.5f * NET_THICKNESS, GAME_RECT.upperBound.y } }, NET_COLOR);
+		}
+		m_quadBatch.FinishStaticGeometry();
+	}
+	void GameView::Draw(const Game::Snapshot& snapshot)
+	{
+		TraceScope trace{ "GameView::Draw" };
+		b2Vec2 gameDim{ GAME_RECT.GetWidth(), GAME_RECT.GetHeight() };
+		{
+			b2Vec2 deadSpace;
+			{
+				float gameAspectRatio{ gameDim.x / gameDim.y };
+				float screenAspectRatio{ d2d::Window::GetXYAspectRatio() };
+
+				// Fill as much of screen as possible while maintaining game aspect ratio
+				if(screenAspectRatio > gameAspectRatio)
+				{
+					// Screen will be wider than game
+					float cameraWidth{ screenAspectRatio * gameDim.y };
+					deadSpace.Set(0.5f * (cameraWidth - gameDim.x), 0.0f);
+				}
+				else
+				{
+					// Screen will be taller than or equal to the game
+					float cameraHeight{ gameDim.x / screenAspectRatio };
+					deadSpace.Set(0.0f, 0.5f * (cameraHeight - gameDim.y));
+				}
+			}
+			d2d::Window::SetCameraRect(
+				{ GAME_RECT.lowerBound - deadSpace,
+				  GAME_RECT.upperBound + deadSpace });
+		}
+
+		d2d::Window::DisableTextures();
+		d2d::Window::EnableBlending();
+
+		// Draw game objects, border and net in one batch
+		m_quadBatch.Reserve(2 + snapshot.puckPositions.size());
+		m_quadBatch.Clear();
+		m_quadBatch.AddQuad({ snapshot.player1.position, snapshot.player1.position + PLAYER_SIZE }, PLAYER_COLOR);
+		m_quadBatch.AddQuad({ snapshot.player2.position, snapshot.player2.position + PLAYER_SIZE }, PLAYER_COLOR);
+		for(const b2Vec2& puckPosition : snapshot.puckPositions)
+			m_quadBatch.AddQuad({ puckPosition, puckPosition + PUCK_SIZE }, PUCK_COLOR);
+		m_quadBatch.Draw();
+
+		// Draw text
+		{
+			switch(snapshot.state)
+			{
+			case Game::GameState::CONNECT_TO_SERVER:
+				DrawConnecting(snapshot.connectAttempt);
+				break;
+			case Game::GameState::WAIT_FOR_CLIENT_TCP_CONNECTION:
+				d2d::Window::PushMatrix();
+				d2d::Window::SetColor(m_waitingForPlayerTextStyle.color);
+				d2d::Window::Translate(m_waitingForPlayerLeftPosition);
+				m_textCache.DrawString(m_waitingForClientText, m_waitingForPlayerLeftAlignment,
+					m_waitingForPlayerTextStyle.size, m_waitingForPlayerTextStyle.font);
+				d2d::Window::PopMatrix();
+				break;
+			case Game::GameState::CONFIRM_PLAYERS_READY:
+				if(!snapshot.player1.isReady)
+					DrawWaitingMessage(snapshot.player1);
+				if(!snapshot.player2.isReady)
+					DrawWaitingMessage(snapshot.player2);
+				break;
+			case Game::GameState::COUNTDOWN:
+				DrawCountdown(snapshot.countdownSecondsLeft);
+				break;
+			case Game::GameState::GAME_OVER:
+				DrawPlayerResult(snapshot.player1.side, snapshot.player1.score > snapshot.player2.score);
+				DrawPlayerResult(snapshot.player2.side, snapshot.player2.score > snapshot.player1.score);
+				if(snapshot.canRematch)
+				{
+					if(!snapshot.player1.wantsRematch)
+						DrawRematchMessage(snapshot.player1);
+					if(!snapshot.player2.wantsRematch)
+						DrawRematchMessage(snapshot.player2);
+				}
+				break;
+			case Game::GameState::GAME_OVER_DEFAULT_WIN:
+				DrawPlayerResult(snapshot.player1.side, IsServer() ? true : false);
+				DrawPlayerResult(snapshot.player2.side, IsServer() ? false : true);
+				break;
+			}
+			DrawScore(snapshot.player1);
+			DrawScore(snapshot.player2);
+
+			// Draw FPS
+			d2d::Window::PushMatrix();
+			d2d::Window::Translate(m_fpsPosition);
+			d2d::Window::SetColor(m_fpsTextStyle.color);
+			m_textCache.DrawNumber((int)(d2d::Window::GetFPS() + 0.5f), m_fpsAlignment,
+				m_fpsTextStyle.size, m_fpsTextStyle.font);
+			d2d::Window::PopMatrix();
+		}
+	}
+	void GameView::DrawPlayerResult(Side playerSide, bool isWinner)
+	{
+		const std::string& resultText{ isWinner ? m_playerWinsText : m_playerLosesText };
+		const d2d::TextStyle& resultTextStyle{ isWinner ? m_playerWinsTextStyle : m_playerLosesTextStyle };
+
+		d2d::Window::PushMatrix();
+		d2d::Window::SetColor(resultTextStyle.color);
+		if(playerSide == Side::LEFT && !IsClient())
+		{
+			d2d::Window::Translate(m_playerResultLeftPosition);
+			m_textCache.DrawString(resultText, m_playerResultLeftAlignment,
+				resultTextStyle.size, resultTextStyle.font);
+		}
+		else if(playerSide == Side::RIGHT && !IsServer())
+		{
+			d2d::Window::Translate(m_playerResultRightPosition);
+			m_textCache.DrawString(resultText, m_playerResultRightAlignment,
+				resultTextStyle.size, resultTextStyle.font);
+		}
+		d2d::Window::PopMatrix();
+	}
+	void GameView::DrawCountdown(float countdownSecondsLeft)
+	{
+		int countdownInt = (int)(countdownSecondsLeft + SLIGHTLY_LESS_THAN_ONE);
+		if(countdownInt > 0)
+		{
+			d2d::Window::PushMatrix();
+			d2d::Window::Translate(m_countdownPosition);
+			d2d::Window::SetColor(m_countdownTextStyle.color);
+			m_textCache.DrawNumber(countdownInt, m_countdownAlignment,
+				m_countdownTextStyle.size, m_countdownTextStyle.font);
+			d2d::Window::PopMatrix();
+		}
+	}
+	void GameView::DrawScore(const Game::Snapshot::PlayerView& player)
+	{
+		d2d::Window::PushMatrix();
+		d2d::Window::SetColor(m_scoreTextStyle.color);
+		if(player.side == Side::LEFT)
+		{
+			d2d::Window::Translate(m_scoreLeftPosition);
+			m_textCache.DrawNumber((int)player.score, m_scoreLeftAlignment,
+				m_scoreTextStyle.size, m_scoreTextStyle.font);
+		}
+		else
+		{
+			d2d::Window::Translate(m_scoreRightPosition);
+			m_textCache.DrawNumber((int)player.score, m_scoreRightAlignment,
+				m_scoreTextStyle.size, m_scoreTextStyle.font);
+		}
+		d2d::Window::PopMatrix();
+	}
+	void GameView::DrawWaitingMessage(const Game::Snapshot::PlayerView& player)
+	{
+		d2d::Window::PushMatrix();
+		d2d::Window::SetColor(m_waitingForPlayerTextStyle.color);
+		if(player.side == Side::LEFT)
+		{
+			// Different text for remote player
+			const std::string& textRef = IsClient() ? m_waitingForRemotePlayerText : m_waitingForPlayerLeftText;
+			d2d::Window::Translate(m_waitingForPlayerLeftPosition);
+			m_textCache.DrawString(textRef, m_waitingForPlayerLeftAlignment,
+				m_waitingForPlayerTextStyle.size, m_waitingForPlayerTextStyle.font);
+		}
+		else
+		{
+			// Different text for remote player
+			const std::string& textRef = IsServer() ? m_waitingForRemotePlayerText : m_waitingForPlayerRightText;
+			d2d::Window::Translate(m_waitingForPlayerRightPosition);
+			m_textCache.DrawString(textRef, m_waitingForPlayerRightAlignment,
+				m_waitingForPlayerTextStyle.size, m_waitingForPlayerTextStyle.font);
+		}
+		d2d::Window::PopMatrix();
+	}
+	void GameView::DrawRematchMessage(const Game::Snapshot::PlayerView& player)
+	{
+		// Different text for remote player
+		bool isLeft{ player.side == Side::LEFT };
+		bool isRemote{ isLeft ? IsClient() : IsServer() };
+		const std::string& textRef{ isRemote ? m_waitingForRemoteRematchText : (isLeft ? m_rematchLeftText : m_rematchRightText) };
+
+		d2d::Window::PushMatrix();
+		d2d::Window::SetColor(m_waitingForPlayerTextStyle.color);
+		d2d::Window::Translate(isLeft ? m_rematchLeftPosition : m_rematchRightPosition);
+		m_textCache.DrawString(textRef, d2d::Alignment::CENTERED,
+			m_waitingForPlayerTextStyle.size, m_waitingForPlayerTextStyle.font);
+		d2d::Window::PopMatrix();
+	}
+	void GameView::DrawConnecting(int attempt)
+	{
+		if(attempt != m_connectingTextAttempt)
+		{
+			m_connectingTextAttempt = attempt;
+			m_connectingText = attempt > 1 ? "Connecting to server (attempt " + d2d::ToString(attempt) + ")..." : "Connecting to server...";
+		}
+
+		// The client is the right player, opposite where the server waits for it
+		d2d::Window::PushMatrix();
+		d2d::Window::SetColor(m_waitingForPlayerTextStyle.color);
+		d2d::Window::Translate(m_waitingForPlayerRightPosition);
+		m_textCache.DrawString(m_connectingText, m_waitingForPlayerRightAlignment,
+			m_waitingForPlayerTextStyle.size, m_waitingForPlayerTextStyle.font);
+		d2d::Window::PopMatrix();
+	}
+}
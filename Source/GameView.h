@@ -0,0 +1,104 @@
+/**************************************************************************************\
+** File: GameView.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the GameView class
+**
+\**************************************************************************************/
+#pragma once
+#include "Game.h"
+#include "QuadBatch.h"
+#include "TextCache.h"
+
+namespace Pong
+{
+	// Draws Game snapshots. Holds the fonts, text and GL resources, so the Game
+	// itself only carries simulation and network state. Render thread only.
+	class GameView
+	{
+	public:
+		// Uses GL, so only call from the thread that owns the window
+		void Init(GameInitSettings::Mode mode);
+		void Draw(const Game::Snapshot& snapshot);
+
+	private:
+		bool IsClient() const;
+		bool IsServer() const;
+
+		void InitStaticGeometry();
+		void DrawPlayerResult(Side playerSide, bool isWinner);
+		void DrawCountdown(float countdownSecondsLeft);
+		void DrawScore(const Game::Snapshot::PlayerView& player);
+		void DrawWaitingMessage(const Game::Snapshot::PlayerView& player);
+		void DrawConnecting(int attempt);
+		void DrawRematchMessage(const Game::Snapshot::PlayerView& player);
+
+		GameInitSettings::Mode m_mode{ GameInitSettings::Mode::LOCAL };
+		QuadBatch m_quadBatch;	// Border and net are static, players and pucks rebuilt each Draw
+		TextCache m_textCache;
+
+		// Assets
+		d2d::FontReference m_orbitronLightFont{ "Fonts/OrbitronLight.otf" };
+
+		// Text
+		const b2Vec2 edgeGapPercent{ 0.015f, 0.015f };
+
+		// FPS text
+		const b2Vec2 m_fpsPosition{ GAME_RECT.GetPointAtPercent(b2Vec2{1.0f, 1.0f } - edgeGapPercent) };
+		const d2d::Alignment m_fpsAlignment{ d2d::Alignment::RIGHT_TOP };
+		const d2d::TextStyle m_fpsTextStyle{ m_orbitronLightFont, { 1.0f, 1.0f, 0.0f }, 0.05f * GAME_RECT.GetHeight() };
+
+		// Score text
+		const b2Vec2 m_scoreLeftPosition{ GAME_RECT.GetPointAtPercent({ 0.5f - edgeGapPercent.x, 1.0f - edgeGapPercent.y }) };
+		const d2d::Alignment m_scoreLeftAlignment{ d2d::Alignment::RIGHT_TOP };
+		
+		const b2Vec2 m_scoreRightPosition{ GAME_RECT.GetPointAtPercent({ 0.5f + edgeGapPercent.x, 1.0f - edgeGapPercent.y }) };
+		const d2d::Alignment m_scoreRightAlignment{ d2d::Alignment::LEFT_TOP };
+		
+		const d2d::TextStyle m_scoreTextStyle{ m_orbitronLightFont, { 1.0f, 1.0f, 0.0f }, 0.05f * GAME_RECT.GetHeight() };
+
+		// Waiting for client text
+		const std::string m_waitingForClientText{ "Waiting for client to connect..." };
+
+		// Connecting text, rebuilt only when the attempt changes
+		std::string m_connectingText;
+		int m_connectingTextAttempt{ 0 };
+
+		// Waiting for player text
+		const std::string m_waitingForRemotePlayerText{ "Waiting for player to press a button..." };
+
+		const std::string m_waitingForPlayerLeftText{ "Press W or S when ready" };
+		const b2Vec2 m_waitingForPlayerLeftPosition{ GAME_RECT.GetPointAtPercent({ 0.25f, 0.5f }) };
+		const d2d::Alignment m_waitingForPlayerLeftAlignment{ d2d::Alignment::CENTERED };
+
+		const std::string m_waitingForPlayerRightText{ "Press UP or DOWN when ready" };
+		const b2Vec2 m_waitingForPlayerRightPosition{ GAME_RECT.GetPointAtPercent({ 0.75f, 0.5f }) };
+		const d2d::Alignment m_waitingForPlayerRightAlignment{ d2d::Alignment::CENTERED };
+
+		const d2d::TextStyle m_waitingForPlayerTextStyle{ m_orbitronLightFont, { 1.0f, 1.0f, 0.0f }, 0.05f * GAME_RECT.GetHeight() };
+
+		// Countdown text
+		const b2Vec2 m_countdownPosition{ GAME_RECT.GetCenter() };
+		const d2d::Alignment m_countdownAlignment{ d2d::Alignment::CENTERED };
+		const d2d::TextStyle m_countdownTextStyle{ m_orbitronLightFont, { 1.0f, 1.0f, 0.0f }, 0.20f * GAME_RECT.GetHeight() };
+
+		// Result text
+		const std::string m_playerWinsText{ "You win!" };
+		const std::string m_playerLosesText{ "You lose!" };
+		const b2Vec2 m_playerResultLeftPosition{ GAME_RECT.GetPointAtPercent({ 0.25f, 0.5f }) };
+		const b2Vec2 m_playerResultRightPosition{ GAME_RECT.GetPointAtPercent({ 0.75f, 0.5f }) };
+		const d2d::Alignment m_playerResultLeftAlignment{ d2d::Alignment::CENTERED };
+		const d2d::Alignment m_playerResultRightAlignment{ d2d::Alignment::CENTERED };
+		const d2d::TextStyle m_playerWinsTextStyle{ m_orbitronLightFont, { 0.1f, 0.9f, 0.1f }, 0.10f * GAME_RECT.GetHeight() };
+		const d2d::TextStyle m_playerLosesTextStyle{ m_orbitronLightFont, { 0.6f, 0.1f, 0.1f }, 0.10f * GAME_RECT.GetHeight() };
+
+		// Rematch text, under the result
+		const std::string m_rematchLeftText{ "Press W or S for a rematch" };
+		const std::string m_rematchRightText{ "Press UP or DOWN for a rematch" };
+		const std::string m_waitingForRemoteRematchText{ "Waiting for opponent..." };
+		const b2Vec2 m_rematchLeftPosition{ GAME_RECT.GetPointAtPercent({ 0.25f, 0.3f }) };
+		const b2Vec2 m_rematchRightPosition{ GAME_RECT.GetPointAtPercent({ 0.75f, 0.3f }) };
+	};
+}
@@ -12,16 +12,25 @@
 #include "Game.h"
 #include "AppState.h"
 #include "Exceptions.h"
+#include "Trace.h"
 
 namespace Pong
 {
+	Gameplay::~Gameplay()
+	{
+		StopSimulation();
+	}
 	void Gameplay::Init()
 	{
+		StopSimulation();
+
 		m_gotoMenu = false;
 		m_player1Up = false;
 		m_player1Down = false;
 		m_player2Up = false;
 		m_player2Down = false;
+		m_player1PressedAButton = false;
+		m_player2PressedAButton = false;
 
 		try {
 			m_game.Init();
@@ -31,6 +40,14 @@ namespace Pong
 			m_gotoMenu = true;
 		}
 
+		m_view.Init(GameInitSettings::GetGameMode());
+
+		// Something to draw before the first simulation step
+		m_game.WriteSnapshot(m_snapshots.GetWriteBuffer());
+		m_snapshots.Publish();
+		if(!m_gotoMenu)
+			StartSimulation();
+
 		d2d::Window::SetClearColor(d2d::BLACK_OPAQUE);
 
 		//m_showFPS = true;
@@ -47,19 +64,19 @@ namespace Pong
 				break;
 			case SDLK_UP:
 				m_player2Up = true;
-				m_game.Player2PressedAButton(); 
+				m_player2PressedAButton = true; 
 				break;
 			case SDLK_DOWN:
 				m_player2Down = true;
-				m_game.Player2PressedAButton(); 
+				m_player2PressedAButton = true; 
 				break;
 			case SDLK_w:
 				m_player1Up = true;
-				m_game.Player1PressedAButton(); 
+				m_player1PressedAButton = true; 
 				break;
 			case SDLK_s:
 				m_player1Down = true;
-				m_game.Player1PressedAButton(); 
+				m_player1PressedAButton = true; 
 				break;
 			} 
 			break;
@@ -136,26 +153,95 @@ namespace Pong
 	}
 	AppStateID Gameplay::Update(float dt)
 	{
-		if(!m_gotoMenu)
+		// The game itself updates on the simulation thread
+		if(m_simulationFailed.load(std::memory_order_acquire))
 		{
-			try {
-				MapInputToGameActions();
-				m_game.Update(dt);
-			}
-			catch(const GameException & e) {
-				SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Game Update Error", e.what(), nullptr);
-				m_gotoMenu = true;
-			}
+			SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Game Update Error", m_simulationError.c_str(), nullptr);
+			m_gotoMenu = true;
+		}
+		else if(m_hasSimulationNotice.load(std::memory_order_acquire))
+		{
+			// Blocks this thread only; the game keeps ticking behind the box
+			SDL_ShowSimpleMessageBox(m_simulationNotice.messageBoxFlags, m_simulationNotice.title.c_str(),
+				m_simulationNotice.text.c_str(), nullptr);
+			m_hasSimulationNotice.store(false, std::memory_order_release);
 		}
 
 		if(m_gotoMenu)
 		{
+			StopSimulation();
+			d2LogInfo << "Simulation ran " << m_tickScheduler.GetTicksRun() << " ticks, missed "
+				<< m_tickScheduler.GetMissedDeadlineCount() << " deadlines, started "
+				<< 1000.0 * m_tickScheduler.GetMeanLatenessSeconds() << " ms late on average and at most "
+				<< 1000.0 * m_tickScheduler.GetMaxLatenessSeconds() << " ms";
 			m_game.OnQuit();
 			return AppStateID::MAIN_MENU;
 		}
 
 		return AppStateID::GAMEPLAY;
 	}
+	void Gameplay::StartSimulation()
+	{
+		m_stopSimulation = false;
+		m_simulationFailed = false;
+		m_hasSimulationNotice = false;
+		m_simulationThread = std::thread{ &Gameplay::RunSimulation, this };
+	}
+	void Gameplay::StopSimulation()
+	{
+		if(m_simulationThread.joinable())
+		{
+			m_stopSimulation.store(true, std::memory_order_release);
+			m_simulationThread.join();
+		}
+	}
+	void Gameplay::RunSimulation()
+	{
+		Trace::SetThreadName("simulation");
+		m_tickScheduler.Init(SIMULATION_DT, MAX_SIMULATION_STEPS_BEHIND);
+		while(!m_stopSimulation.load(std::memory_order_acquire))
+		{
+			try {
+				// Until a client connects, sleep on the listening socket instead of ticking
+				if(m_game.IsWaitingForPeer())
+				{
+					m_game.WaitForPeer(MAX_SIMULATION_IDLE_SECONDS);
+					m_tickScheduler.Restart();
+				}
+				else
+					m_tickScheduler.WaitForNextTick();
+
+				if(m_player1PressedAButton.exchange(false))
+					m_game.Player1PressedAButton();
+				if(m_player2PressedAButton.exchange(false))
+					m_game.Player2PressedAButton();
+				MapInputToGameActions();
+				m_game.Update(SIMULATION_DT);
+				m_game.WriteSnapshot(m_snapshots.GetWriteBuffer());
+				m_snapshots.Publish();
+
+				// While the last notice is still on screen, a new one waits in the game
+				if(!m_hasSimulationNotice.load(std::memory_order_acquire) && m_game.TakeNotice(m_simulationNotice))
+					m_hasSimulationNotice.store(true, std::memory_order_release);
+			}
+			// Nothing may escape the thread, or std::terminate ends the app without a word
+			catch(const GameException & e) {
+				m_simulationError = e.what();
+				m_simulationFailed.store(true, std::memory_order_release);
+				return;
+			}
+			catch(const d2d::Exception & e) {
+				m_simulationError = e.what();
+				m_simulationFailed.store(true, std::memory_order_release);
+				return;
+			}
+			catch(const std::exception & e) {
+				m_simulationError = e.what();
+				m_simulationFailed.store(true, std::memory_order_release);
+				return;
+			}
+		}
+	}
 	void Gameplay::MapInputToGameActions()
 	{
 		// Map Player1 controller to game
@@ -181,6 +267,6 @@ namespace Pong
 	void Gameplay::Draw()
 	{
 		d2d::Window::SetShowCursor(false);
-		m_game.Draw();
+		m_view.Draw(m_snapshots.Read());
 	}
 }
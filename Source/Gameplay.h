@@ -10,6 +10,10 @@
 #pragma once
 #include "AppState.h"
 #include "Game.h"
+#include "GameView.h"
+#include "TripleBuffer.h"
+#include "TickScheduler.h"
+#include <thread>
 
 namespace Pong
 {
@@ -23,9 +27,18 @@ namespace Pong
 		CLIENT_INPUT_PORT
 	};*/
 
+	// Game::Update, including networking, runs at a fixed rate on its own thread.
+	// The main thread only polls events and draws the latest published snapshot,
+	// so a slow buffer swap never holds up physics or packet handling.
+	const float SIMULATION_DT{ 1.0f / 120.0f };
+	const int MAX_SIMULATION_STEPS_BEHIND{ 8 };
+	// A server waiting for a client blocks on its socket this long at most, so quitting stays quick
+	const float MAX_SIMULATION_IDLE_SECONDS{ 0.1f };
+
 	class Gameplay : public AppState
 	{
 	public:
+		~Gameplay();
 		void Init() override;
 		void ProcessEvent(const SDL_Event& event) override;
 		AppStateID Update(float dt) override;
@@ -33,14 +46,31 @@ namespace Pong
 		void Draw() override;
 
 	private:
+		void StartSimulation();
+		void StopSimulation();
+		void RunSimulation();
 		void MapInputToGameActions();
 
 		Game m_game;
+		GameView m_view;	// Main thread only
+		TripleBuffer<Game::Snapshot> m_snapshots;
+		TickScheduler m_tickScheduler;	// Simulation thread only, while it runs
+
+		std::thread m_simulationThread;
+		std::atomic<bool> m_stopSimulation{ false };
+		std::atomic<bool> m_simulationFailed{ false };
+		std::string m_simulationError;	// Set before m_simulationFailed
+		// Shown by the main thread, which clears the flag once it has read the notice
+		std::atomic<bool> m_hasSimulationNotice{ false };
+		Game::Notice m_simulationNotice;	// Set before m_hasSimulationNotice
 
-		bool m_gotoMenu;
-		bool m_player1Up;
-		bool m_player1Down;
-		bool m_player2Up;
-		bool m_player2Down;
+		// Written by the main thread, read by the simulation thread
+		std::atomic<bool> m_gotoMenu{ false };
+		std::atomic<bool> m_player1Up{ false };
+		std::atomic<bool> m_player1Down{ false };
+		std::atomic<bool> m_player2Up{ false };
+		std::atomic<bool> m_player2Down{ false };
+		std::atomic<bool> m_player1PressedAButton{ false };
+		std::atomic<bool> m_player2PressedAButton{ false };
 	};
 }
@@ -22,8 +22,8 @@ namespace Pong
 		void Draw() override;
 
 	private:
-		d2d::FontReference m_alexBrushFont{ "Fonts\\AlexBrush.otf"s };
-		d2d::FontReference m_orbitronLightFont{ "Fonts\\OrbitronLight.otf"s };
+		d2d::FontReference m_alexBrushFont{ "Fonts/AlexBrush.otf"s };
+		d2d::FontReference m_orbitronLightFont{ "Fonts/OrbitronLight.otf"s };
 
 		const std::string m_titleText{ "Ping"s };
 		const d2d::Alignment m_titleAlignment{ d2d::Alignment::CENTER_BOTTOM };
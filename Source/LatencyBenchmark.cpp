@@ -0,0 +1,627 @@
+/**************************************************************************************\
+** File: LatencyBenchmark.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the LatencyBenchmark namespace
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "LatencyBenchmark.h"
+#include "Game.h"
+#include "GameInitSettings.h"
+#include "NetworkDef.h"
+#include "RulesDef.h"
+#include "CommandLine.h"
+#include "Exceptions.h"
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+
+namespace Pong
+{
+	namespace LatencyBenchmark
+	{
+		namespace
+		{
+			const char* const LOOPBACK_IP{ "127.0.0.1" };
+			const size_t MAX_PENDING_VALUES{ 4096 };
+
+			struct Settings
+			{
+				double seconds{ 10.0 };
+				double tickHz{ 120.0 };
+				double delaySeconds{ 0.0 };
+				double jitterSeconds{ 0.0 };
+				double lossPercent{ 0.0 };
+				int relayPort{ 0 };	// 0 means serverPort + 1
+				unsigned seed{ 1u };
+				double maxP99Milliseconds{ 0.0 };
+
+				bool UsesRelay() const
+				{
+					return delaySeconds > 0.0 || jitterSeconds > 0.0 || lossPercent > 0.0;
+				}
+			};
+
+			Settings ParseArguments(const std::vector<std::string>& arguments)
+			{
+				Settings settings;
+				for(const CommandLine::Argument& argument : CommandLine::Parse(arguments))
+				{
+					const std::string& name{ argument.name };
+					if(name == "seconds")
+						settings.seconds = CommandLine::ToDouble(argument);
+					else if(name == "tickHz")
+						settings.tickHz = CommandLine::ToDouble(argument);
+					else if(name == "delayMs")
+						settings.delaySeconds = 0.001 * CommandLine::ToDouble(argument);
+					else if(name == "jitterMs")
+						settings.jitterSeconds = 0.001 * CommandLine::ToDouble(argument);
+					else if(name == "lossPercent")
+						settings.lossPercent = CommandLine::ToDouble(argument);
+					else if(name == "relayPort")
+						settings.relayPort = CommandLine::ToInt(argument);
+					else if(name == "seed")
+						settings.seed = (unsigned)CommandLine::ToUnsigned(argument);
+					else if(name == "maxP99Ms")
+						settings.maxP99Milliseconds = CommandLine::ToDouble(argument);
+					else
+						throw BenchmarkException{ "Unknown setting: " + name };
+				}
+				if(settings.seconds <= 0.0)
+					throw BenchmarkException{ "seconds must be positive" };
+				if(settings.tickHz <= 0.0)
+					throw BenchmarkException{ "tickHz must be positive" };
+				if(settings.delaySeconds < 0.0 || settings.jitterSeconds < 0.0)
+					throw BenchmarkException{ "delayMs and jitterMs can't be negative" };
+				if(settings.lossPercent < 0.0 || settings.lossPercent >= 100.0)
+					throw BenchmarkException{ "lossPercent must be in [0,100)" };
+				if(settings.relayPort < 0)
+					throw BenchmarkException{ "relayPort can't be negative" };
+				return settings;
+			}
+
+			double Now()
+			{
+				using Clock = std::chrono::steady_clock;
+				static const Clock::time_point start{ Clock::now() };
+				return std::chrono::duration<double>{ Clock::now() - start }.count();
+			}
+			IPaddress ResolveLoopback(int port)
+			{
+				IPaddress address;
+				SDLNet_SetError("");
+				if(SDLNet_ResolveHost(&address, LOOPBACK_IP, (Uint16)port) != 0)
+					throw BenchmarkException{ std::string{ "Failed to resolve loopback port " } +
+						d2d::ToString(port) + ": " + SDLNet_GetError() };
+				return address;
+			}
+
+			// Matches values produced on one side with the same values applied on the
+			// other, to within a tolerance for values the netcode rounds. Values that never
+			// arrive, or are overtaken by a newer one, count as missed.
+			class LatencyTracker
+			{
+			public:
+				explicit LatencyTracker(const std::string& name, float tolerance = 0.0f)
+					: m_name{ name }, m_tolerance{ tolerance }
+				{
+				}
+				void Sent(const b2Vec2& value, double time)
+				{
+					// Unchanged values are sent again every tick; time from the first one
+					if(!m_pending.empty() && Equal(m_pending.back().value, value))
+						return;
+					m_pending.push_back({ value, time });
+					if(m_pending.size() > MAX_PENDING_VALUES)
+					{
+						m_pending.pop_front();
+						++m_missed;
+					}
+				}
+				void Received(const b2Vec2& value, double time)
+				{
+					if(m_hasReceived && Equal(m_lastReceived, value))
+						return;
+					m_lastReceived = value;
+					m_hasReceived = true;
+
+					for(size_t i = 0; i < m_pending.size(); ++i)
+					{
+						if(Equal(m_pending[i].value, value))
+						{
+							m_latencies.push_back(time - m_pending[i].time);
+							m_missed += i;
+							m_pending.erase(m_pending.begin(), m_pending.begin() + i + 1);
+							return;
+						}
+					}
+				}
+				// Returns p99 in milliseconds, or a negative number if nothing arrived
+				double Print()
+				{
+					std::cout << m_name << '\t' << m_latencies.size() << '\t' << m_missed << '\t';
+					if(m_latencies.empty())
+					{
+						std::cout << "-\t-\t-\t-\t-" << std::endl;
+						return -1.0;
+					}
+					std::sort(m_latencies.begin(), m_latencies.end());
+					auto percentile = [this](double fraction) {
+						return 1000.0 * m_latencies[(size_t)(fraction * (m_latencies.size() - 1))];
+					};
+					double mean{ 0.0 };
+					for(double seconds : m_latencies)
+						mean += seconds;
+					mean = 1000.0 * mean / m_latencies.size();
+					double p99{ percentile(0.99) };
+					std::cout << std::fixed << std::setprecision(3)
+						<< mean << '\t' << percentile(0.5) << '\t' << percentile(0.9) << '\t'
+						<< p99 << '\t' << 1000.0 * m_latencies.back()
+						<< std::defaultfloat << std::endl;
+					return p99;
+				}
+
+			private:
+				struct Pending
+				{
+					b2Vec2 value;
+					double time;
+				};
+				bool Equal(const b2Vec2& a, const b2Vec2& b) const
+				{
+					return std::abs(a.x - b.x) <= m_tolerance && std::abs(a.y - b.y) <= m_tolerance;
+				}
+
+				std::string m_name;
+				float m_tolerance;
+				std::deque<Pending> m_pending;
+				b2Vec2 m_lastReceived{ b2Vec2_zero };
+				bool m_hasReceived{ false };
+				std::vector<double> m_latencies;
+				size_t m_missed{ 0 };
+			};
+
+			struct Trackers
+			{
+				LatencyTracker paddleToServer{ "paddle client->server" };
+				LatencyTracker paddleToClient{ "paddle server->client" };
+				// Snapshots round puck positions
+				LatencyTracker puckToClient{ "puck server->client", SnapshotDelta::POSITION_STEP };
+				// From the later of the two rematch requests until both sides count down again
+				std::vector<double> rematchSeconds;
+				// The client's estimate of the server's clock minus the real thing, which
+				// here is the same clock
+				std::vector<double> clockErrorSeconds;
+			};
+
+			class ServerObserver : public Game::NetworkObserver
+			{
+			public:
+				explicit ServerObserver(Trackers& trackers) : m_trackers{ trackers } {}
+				void OnRemotePlayerY(float y) override
+				{
+					m_trackers.paddleToServer.Received({ 0.0f, y }, Now());
+				}
+				void OnPuckReceived(size_t puckIndex, const b2Vec2& position) override {}
+
+			private:
+				Trackers& m_trackers;
+			};
+			class ClientObserver : public Game::NetworkObserver
+			{
+			public:
+				explicit ClientObserver(Trackers& trackers) : m_trackers{ trackers } {}
+				void OnRemotePlayerY(float y) override
+				{
+					m_trackers.paddleToClient.Received({ 0.0f, y }, Now());
+				}
+				void OnPuckReceived(size_t puckIndex, const b2Vec2& position) override
+				{
+					if(puckIndex == 0)
+						m_trackers.puckToClient.Received(position, Now());
+				}
+
+			private:
+				Trackers& m_trackers;
+			};
+
+			// Forwards TCP and UDP between the client and the server. Every packet is
+			// held for the delay plus random jitter, and UDP packets are dropped at the
+			// loss rate. TCP is never reordered.
+			class Relay
+			{
+			public:
+				Relay(const Settings& settings, int serverPort)
+					: m_settings{ settings },
+					  m_generator{ settings.seed },
+					  m_serverAddress{ ResolveLoopback(serverPort) }
+				{
+					SDLNet_SetError("");
+					if(!(m_socketSet = SDLNet_AllocSocketSet(5)))
+						throw BenchmarkException{ std::string{ "Relay: Unable to allocate socket set: " } + SDLNet_GetError() };
+
+					IPaddress listenAddress;
+					if(SDLNet_ResolveHost(&listenAddress, nullptr, (Uint16)settings.relayPort) != 0 ||
+						!(m_listenSocketTCP = SDLNet_TCP_Open(&listenAddress)))
+						throw BenchmarkException{ std::string{ "Relay: Failed to open TCP port " } +
+							d2d::ToString(settings.relayPort) + ": " + SDLNet_GetError() };
+					if(!(m_clientSideUDP = SDLNet_UDP_Open((Uint16)settings.relayPort)))
+						throw BenchmarkException{ std::string{ "Relay: Failed to open UDP port " } +
+							d2d::ToString(settings.relayPort) + ": " + SDLNet_GetError() };
+					if(!(m_serverSideUDP = SDLNet_UDP_Open(0)))
+						throw BenchmarkException{ std::string{ "Relay: Failed to open any available UDP port: " } + SDLNet_GetError() };
+					if(!(m_packetPtr = SDLNet_AllocPacket(BUFFER_SIZE)))
+						throw BenchmarkException{ "Relay: Failed to allocate UDP packet: Out of memory" };
+
+					SDLNet_TCP_AddSocket(m_socketSet, m_listenSocketTCP);
+					SDLNet_UDP_AddSocket(m_socketSet, m_clientSideUDP);
+					SDLNet_UDP_AddSocket(m_socketSet, m_serverSideUDP);
+				}
+				~Relay()
+				{
+					for(TCPsocket socket : { m_listenSocketTCP, m_clientSocketTCP, m_serverSocketTCP })
+						if(socket)
+							SDLNet_TCP_Close(socket);
+					for(UDPsocket socket : { m_clientSideUDP, m_serverSideUDP })
+						if(socket)
+							SDLNet_UDP_Close(socket);
+					if(m_packetPtr)
+						SDLNet_FreePacket(m_packetPtr);
+					if(m_socketSet)
+						SDLNet_FreeSocketSet(m_socketSet);
+				}
+				Relay(const Relay&) = delete;
+				Relay& operator=(const Relay&) = delete;
+
+				void Pump()
+				{
+					SDLNet_SetError("");
+					if(SDLNet_CheckSockets(m_socketSet, 0) == -1)
+						throw BenchmarkException{ std::string{ "Relay: Failed to check sockets: " } + SDLNet_GetError() };
+
+					if(m_listenSocketTCP && SDLNet_SocketReady(m_listenSocketTCP))
+						AcceptClient();
+					if(m_clientSocketTCP && SDLNet_SocketReady(m_clientSocketTCP))
+						ReceiveTCP(m_clientSocketTCP, true);
+					if(m_serverSocketTCP && SDLNet_SocketReady(m_serverSocketTCP))
+						ReceiveTCP(m_serverSocketTCP, false);
+					while(SDLNet_UDP_Recv(m_clientSideUDP, m_packetPtr) > 0)
+					{
+						m_clientAddress = m_packetPtr->address;
+						m_knowClientAddress = true;
+						ReceiveUDP(true);
+					}
+					while(SDLNet_UDP_Recv(m_serverSideUDP, m_packetPtr) > 0)
+						ReceiveUDP(false);
+
+					SendDuePackets();
+				}
+
+			private:
+				struct DelayedPacket
+				{
+					double releaseTime;
+					bool toServer;
+					bool isTCP;
+					std::vector<Byte> bytes;
+				};
+
+				void AcceptClient()
+				{
+					if(!(m_clientSocketTCP = SDLNet_TCP_Accept(m_listenSocketTCP)))
+						return;
+					SDLNet_TCP_DelSocket(m_socketSet, m_listenSocketTCP);
+					SDLNet_TCP_Close(m_listenSocketTCP);
+					m_listenSocketTCP = nullptr;
+
+					SDLNet_SetError("");
+					if(!(m_serverSocketTCP = SDLNet_TCP_Open(&m_serverAddress)))
+						throw BenchmarkException{ std::string{ "Relay: Failed to connect to server: " } + SDLNet_GetError() };
+					SDLNet_TCP_AddSocket(m_socketSet, m_clientSocketTCP);
+					SDLNet_TCP_AddSocket(m_socketSet, m_serverSocketTCP);
+				}
+				void ReceiveTCP(TCPsocket socket, bool toServer)
+				{
+					Byte bytes[BUFFER_SIZE];
+					int byteCount{ SDLNet_TCP_Recv(socket, bytes, BUFFER_SIZE) };
+					if(byteCount <= 0)
+						throw BenchmarkException{ "Relay: TCP connection closed" };
+					Schedule(toServer, true, bytes, byteCount);
+				}
+				void ReceiveUDP(bool toServer)
+				{
+					std::bernoulli_distribution dropPacket{ 0.01 * m_settings.lossPercent };
+					if(dropPacket(m_generator))
+						return;
+					Schedule(toServer, false, m_packetPtr->data, m_packetPtr->len);
+				}
+				void Schedule(bool toServer, bool isTCP, const Byte* bytes, int byteCount)
+				{
+					std::uniform_real_distribution<double> jitter{ 0.0, m_settings.jitterSeconds };
+					double releaseTime{ Now() + m_settings.delaySeconds + jitter(m_generator) };
+
+					// A byte stream can't overtake itself
+					if(isTCP)
+					{
+						double& lastReleaseTime{ toServer ? m_lastReleaseToServerTCP : m_lastReleaseToClientTCP };
+						releaseTime = std::max(releaseTime, lastReleaseTime);
+						lastReleaseTime = releaseTime;
+					}
+					m_packets.push_back({ releaseTime, toServer, isTCP, { bytes, bytes + byteCount } });
+				}
+				void SendDuePackets()
+				{
+					double now{ Now() };
+					size_t kept{ 0 };
+					for(size_t i = 0; i < m_packets.size(); ++i)
+					{
+						DelayedPacket& packet{ m_packets[i] };
+						if(packet.releaseTime > now)
+						{
+							if(kept != i)
+								m_packets[kept] = std::move(packet);
+							++kept;
+						}
+						else if(packet.isTCP)
+							SendTCP(packet);
+						else
+							SendUDP(packet);
+					}
+					m_packets.resize(kept);
+				}
+				void SendTCP(const DelayedPacket& packet)
+				{
+					TCPsocket socket{ packet.toServer ? m_serverSocketTCP : m_clientSocketTCP };
+					int byteCount{ (int)packet.bytes.size() };
+					if(SDLNet_TCP_Send(socket, packet.bytes.data(), byteCount) < byteCount)
+						throw BenchmarkException{ std::string{ "Relay: Failed to send TCP data: " } + SDLNet_GetError() };
+				}
+				void SendUDP(const DelayedPacket& packet)
+				{
+					if(!packet.toServer && !m_knowClientAddress)
+						return;
+					memcpy(m_packetPtr->data, packet.bytes.data(), packet.bytes.size());
+					m_packetPtr->len = (int)packet.bytes.size();
+					m_packetPtr->address = packet.toServer ? m_serverAddress : m_clientAddress;
+
+					// Server replies go to the relay's server side socket and are forwarded from there
+					UDPsocket socket{ packet.toServer ? m_serverSideUDP : m_clientSideUDP };
+					if(SDLNet_UDP_Send(socket, -1, m_packetPtr) < 1)
+						throw BenchmarkException{ std::string{ "Relay: Failed to send UDP packet: " } + SDLNet_GetError() };
+				}
+
+				const Settings& m_settings;
+				std::mt19937 m_generator;
+				IPaddress m_serverAddress;
+				IPaddress m_clientAddress{};
+				bool m_knowClientAddress{ false };
+
+				SDLNet_SocketSet m_socketSet{ nullptr };
+				TCPsocket m_listenSocketTCP{ nullptr };
+				TCPsocket m_clientSocketTCP{ nullptr };
+				TCPsocket m_serverSocketTCP{ nullptr };
+				UDPsocket m_clientSideUDP{ nullptr };
+				UDPsocket m_serverSideUDP{ nullptr };
+				UDPpacket* m_packetPtr{ nullptr };
+
+				std::vector<DelayedPacket> m_packets;
+				double m_lastReleaseToServerTCP{ 0.0 };
+				double m_lastReleaseToClientTCP{ 0.0 };
+			};
+
+			// Tracks the puck so rallies last and paddle inputs keep flowing
+			float GetBotMovementFactor(const Game::Snapshot::PlayerView& bot, const Game::Snapshot& view,
+				const RulesDef& rules, float dt)
+			{
+				float maxDisplacement{ rules.playerMaxSpeed * dt };
+				if(view.puckPositions.empty() || maxDisplacement <= 0.0f)
+					return 0.0f;
+
+				float paddleCenterY{ bot.position.y + 0.5f * PLAYER_SIZE.y };
+				float targetY{ view.puckPositions.front().y + 0.5f * PUCK_SIZE.y };
+				float factor{ (targetY - paddleCenterY) / maxDisplacement };
+				d2d::Clamp(factor, { -1.0f, 1.0f });
+				return factor;
+			}
+			bool IsGameOver(const Game::Snapshot& view)
+			{
+				return view.state == Game::GameState::GAME_OVER || view.state == Game::GameState::GAME_OVER_DEFAULT_WIN;
+			}
+			// Both bots ask for a rematch as soon as a game ends
+			bool IsSessionOver(const Game::Snapshot& view)
+			{
+				return IsGameOver(view) && !view.canRematch;
+			}
+			bool WantsRematch(const Game::Snapshot& view, const Game::Snapshot::PlayerView& bot)
+			{
+				return view.state == Game::GameState::GAME_OVER && view.canRematch && !bot.wantsRematch;
+			}
+
+			// Plays games on one connection until one side can't rematch, or until endTime.
+			// The relay, if any, is destroyed last.
+			struct Session
+			{
+				std::unique_ptr<Relay> relayPtr;
+				std::unique_ptr<Game> serverPtr{ std::make_unique<Game>() };
+				std::unique_ptr<Game> clientPtr{ std::make_unique<Game>() };
+			};
+			void PlaySession(const Settings& settings, const NetworkDef& serverSettings, const RulesDef& rules,
+				Trackers& trackers, double endTime)
+			{
+				NetworkDef clientSettings{ serverSettings };
+				clientSettings.serverIP = LOOPBACK_IP;
+
+				// The server listens first so the client's first connect attempt succeeds
+				Session session;
+				session.serverPtr->Init(GameInitSettings::Mode::SERVER, serverSettings);
+				if(settings.UsesRelay())
+				{
+					clientSettings.serverPort = settings.relayPort;
+					session.relayPtr = std::make_unique<Relay>(settings, serverSettings.serverPort);
+				}
+				session.clientPtr->Init(GameInitSettings::Mode::CLIENT, clientSettings);
+
+				ServerObserver serverObserver{ trackers };
+				ClientObserver clientObserver{ trackers };
+				session.serverPtr->SetNetworkObserver(&serverObserver);
+				session.clientPtr->SetNetworkObserver(&clientObserver);
+
+				// Two machines don't tick in step, so run the client half a tick out of phase
+				const double tickSeconds{ 1.0 / settings.tickHz };
+				const float dt{ (float)tickSeconds };
+				double nextServerTick{ Now() };
+				double nextClientTick{ nextServerTick + 0.5 * tickSeconds };
+				Game::Snapshot serverView;
+				Game::Snapshot clientView;
+				int rematchRequests{ 0 };
+				double lastRematchRequestTime{ 0.0 };
+				while(Now() < endTime)
+				{
+					if(Now() >= nextServerTick)
+					{
+						Game& server{ *session.serverPtr };
+						server.WriteSnapshot(serverView);
+						if(serverView.state == Game::GameState::CONFIRM_PLAYERS_READY && !serverView.player1.isReady)
+							server.Player1PressedAButton();
+						if(WantsRematch(serverView, serverView.player1))
+						{
+							lastRematchRequestTime = Now();
+							++rematchRequests;
+							server.Player1PressedAButton();
+						}
+						server.SetPlayer1MovementFactor(GetBotMovementFactor(serverView.player1, serverView, rules, dt));
+
+						double inputTime{ Now() };
+						server.Update(dt);
+						server.WriteSnapshot(serverView);
+						if(serverView.state == Game::GameState::PLAY)
+						{
+							trackers.paddleToClient.Sent({ 0.0f, serverView.player1.position.y }, inputTime);
+							if(!serverView.puckPositions.empty())
+								trackers.puckToClient.Sent(serverView.puckPositions.front(), inputTime);
+						}
+						if(IsSessionOver(serverView))
+							return;
+						nextServerTick = std::max(nextServerTick + tickSeconds, Now() - tickSeconds);
+					}
+					if(Now() >= nextClientTick)
+					{
+						Game& client{ *session.clientPtr };
+						client.WriteSnapshot(clientView);
+						if(clientView.state == Game::GameState::CONFIRM_PLAYERS_READY && !clientView.player2.isReady)
+							client.Player2PressedAButton();
+						if(WantsRematch(clientView, clientView.player2))
+						{
+							lastRematchRequestTime = Now();
+							++rematchRequests;
+							client.Player2PressedAButton();
+						}
+						client.SetPlayer2MovementFactor(GetBotMovementFactor(clientView.player2, clientView, rules, dt));
+						if(client.GetClockSync().IsSynchronized())
+						{
+							double now{ ClockSync::Now() };
+							trackers.clockErrorSeconds.push_back(client.GetClockSync().ToServerTime(now) - now);
+						}
+
+						double inputTime{ Now() };
+						client.Update(dt);
+						client.WriteSnapshot(clientView);
+						if(clientView.state == Game::GameState::PLAY)
+							trackers.paddleToServer.Sent({ 0.0f, clientView.player2.position.y }, inputTime);
+						if(IsSessionOver(clientView))
+							return;
+						nextClientTick = std::max(nextClientTick + tickSeconds, Now() - tickSeconds);
+					}
+					if(rematchRequests == 2 &&
+						serverView.state == Game::GameState::COUNTDOWN && clientView.state == Game::GameState::COUNTDOWN)
+					{
+						trackers.rematchSeconds.push_back(Now() - lastRematchRequestTime);
+						rematchRequests = 0;
+					}
+					if(session.relayPtr)
+						session.relayPtr->Pump();
+
+					// Spin rather than sleep, so timer resolution doesn't show up as latency
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		int Run(const std::vector<std::string>& arguments)
+		{
+			try {
+				Settings settings{ ParseArguments(arguments) };
+				NetworkDef networkSettings;
+				networkSettings.LoadFrom("Data/network.hjson");
+				if(settings.relayPort == 0)
+					settings.relayPort = networkSettings.serverPort + 1;
+				RulesDef rules;
+				rules.LoadFrom("Data/rules.hjson");
+
+				d2d::Init(d2LogSeverityTrace, "LatencyBenchmark.log");
+
+				Trackers trackers;
+				int sessions{ 0 };
+				double endTime{ Now() + settings.seconds };
+				while(Now() < endTime)
+				{
+					PlaySession(settings, networkSettings, rules, trackers, endTime);
+					++sessions;
+				}
+
+				std::cout << "tickHz=" << settings.tickHz
+					<< " delayMs=" << 1000.0 * settings.delaySeconds
+					<< " jitterMs=" << 1000.0 * settings.jitterSeconds
+					<< " lossPercent=" << settings.lossPercent
+					<< " sessions=" << sessions
+					<< " rematches=" << trackers.rematchSeconds.size();
+				if(!trackers.rematchSeconds.empty())
+				{
+					const std::vector<double>& rematchSeconds{ trackers.rematchSeconds };
+					std::cout << " rematch mean ms=" << 1000.0 * std::accumulate(rematchSeconds.begin(), rematchSeconds.end(), 0.0) / rematchSeconds.size()
+						<< " max ms=" << 1000.0 * *std::max_element(rematchSeconds.begin(), rematchSeconds.end());
+				}
+				std::cout << std::endl;
+				if(!trackers.clockErrorSeconds.empty())
+				{
+					std::vector<double>& errors{ trackers.clockErrorSeconds };
+					for(double& error : errors)
+						error = std::abs(error);
+					std::sort(errors.begin(), errors.end());
+					std::cout << "clock error ms: mean=" << 1000.0 * std::accumulate(errors.begin(), errors.end(), 0.0) / errors.size()
+						<< " p99=" << 1000.0 * errors[(size_t)(0.99 * (errors.size() - 1))]
+						<< " max=" << 1000.0 * errors.back() << std::endl;
+				}
+				std::cout << "path\tsamples\tmissed\tmean ms\tp50 ms\tp90 ms\tp99 ms\tmax ms" << std::endl;
+				bool passed{ true };
+				for(LatencyTracker* trackerPtr : { &trackers.paddleToServer, &trackers.paddleToClient, &trackers.puckToClient })
+				{
+					double p99{ trackerPtr->Print() };
+					if(p99 < 0.0 || (settings.maxP99Milliseconds > 0.0 && p99 > settings.maxP99Milliseconds))
+						passed = false;
+				}
+				d2d::Shutdown();
+
+				if(!passed)
+				{
+					std::cerr << "Latency benchmark failed: no samples on a path, or p99 above "
+						<< settings.maxP99Milliseconds << " ms" << std::endl;
+					return 1;
+				}
+				return 0;
+			}
+			catch(const std::exception& e) {
+				std::cerr << "Latency benchmark error: " << e.what() << std::endl;
+				d2d::Shutdown();
+				return 1;
+			}
+		}
+	}
+}
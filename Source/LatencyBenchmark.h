@@ -0,0 +1,35 @@
+/**************************************************************************************\
+** File: LatencyBenchmark.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the LatencyBenchmark namespace
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	// Runs a server and a client Game in one process over loopback sockets and
+	// measures end to end netcode latency. Bots drive both paddles; each paddle
+	// input is timed until the peer applies it with Player::SetY, and each puck
+	// position from the server's UpdatePlay is timed until the client applies it.
+	// If a game ends, both bots ask for a rematch at once, timed until both count down.
+	// An optional relay between the two adds one-way delay, jitter and UDP loss.
+	// Also reports how far off the client's estimate of the server's clock is,
+	// which is easy to know here, as both share one clock.
+	//
+	// Usage: Pong --benchmark-latency [name=value]...
+	//	seconds=<run length> tickHz=<updates per second> delayMs=<one-way delay>
+	//	jitterMs=<extra random delay> lossPercent=<UDP packets dropped each way>
+	//	relayPort=<port for the relay> seed=<random seed> maxP99Ms=<fail above this p99>
+	//	Needs no window. Uses serverPort from Data\network.hjson.
+	namespace LatencyBenchmark
+	{
+		const std::string COMMAND_LINE_FLAG{ "--benchmark-latency" };
+
+		// Returns process exit code
+		int Run(const std::vector<std::string>& arguments);
+	}
+}
@@ -22,7 +22,7 @@ namespace Pong
 		void Draw() override;
 
 	private:
-		d2d::FontReference m_orbitronLightFont{ "Fonts\\OrbitronLight.otf" };
+		d2d::FontReference m_orbitronLightFont{ "Fonts/OrbitronLight.otf" };
 
 		// Main Menu
 		const std::string m_startTwoPlayerLocalText{ "START LOCAL" };
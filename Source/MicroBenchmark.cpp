@@ -0,0 +1,402 @@
+/**************************************************************************************\
+** File: MicroBenchmark.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the MicroBenchmark namespace
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "MicroBenchmark.h"
+#include "AllocationCounter.h"
+#include "Game.h"
+#include "GameView.h"
+#include "GameInitSettings.h"
+#include "PuckGrid.h"
+#include "RulesDef.h"
+#include "UdpSocket.h"
+#include "CommandLine.h"
+#include "Exceptions.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace Pong
+{
+	namespace MicroBenchmark
+	{
+		namespace
+		{
+			const float SIMULATION_DT{ 1.0f / 120.0f };
+			const int SNAPSHOT_PUCKS{ 8 };
+			const int GRID_PUCKS{ 256 };
+
+			struct Settings
+			{
+				std::string filter;
+				double batchSeconds{ 0.05 };
+				int repetitions{ 7 };
+			};
+			struct Result
+			{
+				double medianNanoseconds;
+				double minNanoseconds;
+				double maxNanoseconds;
+				double allocationsPerOperation;
+			};
+
+			// Keeps results alive so the optimizer can't drop the work
+			volatile float floatSink;
+			volatile int intSink;
+
+			Settings ParseArguments(const std::vector<std::string>& arguments)
+			{
+				Settings settings;
+				for(const CommandLine::Argument& argument : CommandLine::Parse(arguments))
+				{
+					if(argument.name == "filter")
+						settings.filter = argument.value;
+					else if(argument.name == "batchMs")
+						settings.batchSeconds = 0.001 * CommandLine::ToDouble(argument);
+					else if(argument.name == "repetitions")
+						settings.repetitions = CommandLine::ToInt(argument);
+					else
+						throw BenchmarkException{ "Unknown setting: " + argument.name };
+				}
+				if(settings.batchSeconds <= 0.0)
+					throw BenchmarkException{ "batchMs must be positive" };
+				if(settings.repetitions < 1)
+					throw BenchmarkException{ "repetitions must be at least 1" };
+				return settings;
+			}
+
+			template<typename Operation>
+			double TimeBatch(Operation& operation, Uint64 iterations)
+			{
+				auto start{ std::chrono::steady_clock::now() };
+				for(Uint64 i = 0; i < iterations; ++i)
+					operation();
+				return std::chrono::duration<double>{ std::chrono::steady_clock::now() - start }.count();
+			}
+			template<typename Operation>
+			Result Measure(Operation& operation, const Settings& settings)
+			{
+				// Grow the batch until it takes batchSeconds, which also warms caches
+				Uint64 iterations{ 1 };
+				double seconds{ TimeBatch(operation, iterations) };
+				while(seconds < settings.batchSeconds)
+				{
+					double scale{ seconds > 0.0 ? 1.2 * settings.batchSeconds / seconds : 10.0 };
+					iterations = std::max(iterations + 1, (Uint64)(iterations * std::min(scale, 10.0)));
+					seconds = TimeBatch(operation, iterations);
+				}
+
+				std::vector<double> nanoseconds((size_t)settings.repetitions);
+				Uint64 allocationsBefore{ AllocationCounter::GetCount() };
+				for(double& batchNanoseconds : nanoseconds)
+					batchNanoseconds = 1e9 * TimeBatch(operation, iterations) / (double)iterations;
+				Uint64 allocations{ AllocationCounter::GetCount() - allocationsBefore };
+
+				std::sort(nanoseconds.begin(), nanoseconds.end());
+				return { nanoseconds[nanoseconds.size() / 2], nanoseconds.front(), nanoseconds.back(),
+					(double)allocations / (double)(iterations * settings.repetitions) };
+			}
+			template<typename Operation>
+			void RunBenchmark(const std::string& name, const Settings& settings, Operation operation)
+			{
+				if(name.find(settings.filter) == std::string::npos)
+					return;
+				Result result{ Measure(operation, settings) };
+				std::cout << std::left << std::setw(36) << name << std::right << std::fixed
+					<< std::setprecision(2)
+					<< std::setw(12) << result.medianNanoseconds
+					<< std::setw(12) << result.minNanoseconds
+					<< std::setw(12) << result.maxNanoseconds
+					<< std::setprecision(3)
+					<< std::setw(12);
+				if(AllocationCounter::ENABLED)
+					std::cout << result.allocationsPerOperation;
+				else
+					std::cout << '-';
+				std::cout << std::defaultfloat << std::endl;
+			}
+
+			void BenchmarkBuffer(const Settings& settings)
+			{
+				Buffer buffer;
+				float value{ 1.0f };
+				RunBenchmark("Buffer::WriteFloat", settings, [&]() {
+					if(buffer.BytesAvailable() < (int)sizeof(float))
+						buffer.Clear();
+					buffer.WriteFloat(value);
+					value += 1.0f;
+				});
+
+				buffer.Clear();
+				while(buffer.BytesAvailable() >= (int)sizeof(float))
+					buffer.WriteFloat(value);
+				int readIndex{ 0 };
+				RunBenchmark("Buffer::ReadFloat", settings, [&]() {
+					floatSink = buffer.ReadFloat(readIndex);
+					readIndex += sizeof(float);
+					if(readIndex + (int)sizeof(float) > buffer.length)
+						readIndex = 0;
+				});
+
+				// Typical TCP case: a few processed bytes dropped from a mostly full buffer
+				const int fullLength{ BUFFER_SIZE - 200 };
+				RunBenchmark("Buffer::MakeNewFront", settings, [&]() {
+					buffer.length = fullLength;
+					buffer.MakeNewFront(17);
+				});
+			}
+			std::vector<SnapshotDelta::PuckState> MakeSnapshotPucks()
+			{
+				std::vector<SnapshotDelta::PuckState> pucks(SNAPSHOT_PUCKS);
+				for(int i = 0; i < SNAPSHOT_PUCKS; ++i)
+				{
+					pucks[i].position.Set(GAME_RECT.GetCenter().x + i, GAME_RECT.GetCenter().y);
+					pucks[i].velocity.Set(100.0f, -50.0f);
+				}
+				return pucks;
+			}
+			// One server frame in a single chunk, as Game::WriteNetworkSnapshot writes it.
+			// The paddle is only sent without a baseline, as if it never moves.
+			void WriteSnapshot(Buffer& output, unsigned sequenceNum, Byte baselineAge,
+				const std::vector<SnapshotDelta::PuckState>* baselinePtr,
+				const std::vector<SnapshotDelta::PuckState>& pucks, std::vector<SnapshotDelta::PuckState>& reconstructed)
+			{
+				output.WriteByte(UDP_MESSAGE_SNAPSHOT);
+				output.WriteUInt(sequenceNum);
+				output.WriteByte(baselineAge);
+				output.WriteUInt16((Uint16)pucks.size());
+				output.WriteUInt16(0);
+				output.WriteByte((Byte)pucks.size());
+				output.WriteByte(baselinePtr ? 0 : SNAPSHOT_HAS_PADDLE);
+				if(!baselinePtr)
+					output.WriteFloat(GAME_RECT.GetCenter().y);
+				reconstructed.resize(pucks.size());
+				for(size_t i = 0; i < pucks.size(); ++i)
+					SnapshotDelta::WritePuck(output, baselinePtr ? &(*baselinePtr)[i] : nullptr, pucks[i], reconstructed[i]);
+			}
+			void BenchmarkMessages(const Settings& settings)
+			{
+				// A local game parses server messages the same way the client does, without needing a connection
+				std::unique_ptr<Game> gamePtr{ std::make_unique<Game>() };
+				gamePtr->Init(GameInitSettings::Mode::LOCAL, NetworkDef{});
+
+				// One full server frame: paddle position and a chunk of pucks
+				std::vector<SnapshotDelta::PuckState> pucks{ MakeSnapshotPucks() };
+				std::vector<SnapshotDelta::PuckState> reconstructed;
+				Buffer udpStream;
+				WriteSnapshot(udpStream, 1, 0, nullptr, pucks, reconstructed);
+				Buffer udpInput;
+				RunBenchmark("Game::ProcessMessagesUDP (copy+parse)", settings, [&]() {
+					memcpy(udpInput.bytes, udpStream.bytes, udpStream.length);
+					udpInput.length = udpStream.length;
+					gamePtr->ProcessMessagesUDP(udpInput);
+				});
+
+				// Framed single byte messages ending in a partial PLAYER_SCORED, which stays buffered
+				Buffer tcpStream;
+				for(int i = 0; i < 16; ++i)
+				{
+					tcpStream.WriteVarUInt(1);
+					tcpStream.WriteByte(TCP_MESSAGE_PLAYER_READY);
+					tcpStream.WriteVarUInt(1);
+					tcpStream.WriteByte(TCP_MESSAGE_COUNTDOWN_OVER);
+				}
+				tcpStream.WriteVarUInt(3);
+				tcpStream.WriteByte(TCP_MESSAGE_PLAYER_SCORED);
+				StreamBuffer tcpInput;
+				RunBenchmark("Game::ProcessMessagesTCP (copy+parse)", settings, [&]() {
+					tcpInput.Clear();
+					tcpInput.Reserve(tcpStream.length);
+					memcpy(tcpInput.FirstAvailableBytePtr(), tcpStream.bytes, tcpStream.length);
+					tcpInput.length += tcpStream.length;
+					gamePtr->ProcessMessagesTCP(tcpInput);
+				});
+			}
+			void BenchmarkMatchState(const Settings& settings)
+			{
+				std::unique_ptr<Game> gamePtr{ std::make_unique<Game>() };
+				gamePtr->Init(GameInitSettings::Mode::LOCAL, NetworkDef{});
+
+				// What rollback and replay would do every step
+				Game::SavedState saved;
+				RunBenchmark("Game::SaveState", settings, [&]() {
+					gamePtr->SaveState(saved);
+				});
+				RunBenchmark("Game::LoadState", settings, [&]() {
+					gamePtr->LoadState(saved);
+				});
+			}
+			void BenchmarkSimulation(const Settings& settings, const RulesDef& rules)
+			{
+				Player player;
+				player.Init(Side::LEFT);
+				float factor{ 1.0f };
+				RunBenchmark("Player::Update", settings, [&]() {
+					player.SetMovementFactor(factor);
+					player.Update(SIMULATION_DT, rules);
+					factor = -factor;
+				});
+
+				// Paddles track the puck, so it keeps bouncing off walls and paddles
+				Player left, right;
+				left.Init(Side::LEFT);
+				right.Init(Side::RIGHT);
+				Puck puck;
+				puck.ResetRound(rules, rules.startAngle);
+				RunBenchmark("Puck::Update (with collisions)", settings, [&]() {
+					float paddleY{ puck.GetPosition().y + 0.5f * PUCK_SIZE.y - 0.5f * PLAYER_SIZE.y };
+					d2d::Clamp(paddleY, { GAME_RECT.lowerBound.y, GAME_RECT.upperBound.y - PLAYER_SIZE.y });
+					left.SetY(paddleY);
+					right.SetY(paddleY);
+					puck.Update(SIMULATION_DT, rules, left, right);
+					if(puck.Scored())
+						puck.ResetRound(rules, rules.startAngle);
+				});
+
+				std::mt19937 generator{ 1u };
+				std::uniform_real_distribution<float> xDistribution{ GAME_RECT.lowerBound.x, GAME_RECT.upperBound.x - PUCK_SIZE.x };
+				std::uniform_real_distribution<float> yDistribution{ GAME_RECT.lowerBound.y, GAME_RECT.upperBound.y - PUCK_SIZE.y };
+				std::vector<Puck> pucks(GRID_PUCKS);
+				for(Puck& gridPuck : pucks)
+					gridPuck.ResetRound(rules, { xDistribution(generator), yDistribution(generator) }, rules.startAngle);
+				PuckGrid grid;
+				std::vector<PuckGrid::Pair> pairs;
+				RunBenchmark("PuckGrid Build+Find (256 pucks)", settings, [&]() {
+					grid.Build(pucks);
+					grid.FindOverlappingPairs(pucks, pairs);
+					intSink = (int)pairs.size();
+				});
+			}
+			void BenchmarkUdpSocket(const Settings& settings)
+			{
+				UdpSocket receiver, sender;
+				receiver.Open(0);
+				sender.Open(0);
+				IPaddress receiverAddress;
+				if(SDLNet_ResolveHost(&receiverAddress, "127.0.0.1", receiver.GetLocalPort()) != 0)
+					throw BenchmarkException{ std::string{ "Failed to resolve loopback address: " } + SDLNet_GetError() };
+
+				// Frame sized datagrams over loopback. Each operation is one datagram
+				// sent and received, so 1e9 / ns is packets per second on one core.
+				std::vector<Buffer> buffers(UdpSocket::MAX_BATCH);
+				std::vector<UDPpacket> outPackets(UdpSocket::MAX_BATCH);
+				std::vector<UDPpacket> inPackets(UdpSocket::MAX_BATCH);
+				for(int i = 0; i < UdpSocket::MAX_BATCH; ++i)
+				{
+					outPackets[i].data = buffers[i].FirstBytePtr();
+					outPackets[i].len = 64;
+					outPackets[i].address = receiverAddress;
+					inPackets[i].data = buffers[i].FirstBytePtr();
+					inPackets[i].maxlen = BUFFER_SIZE;
+				}
+				for(int batch : { 1, UdpSocket::MAX_BATCH })
+				{
+					int queued{ 0 };
+					RunBenchmark("UdpSocket loopback (batch " + std::to_string(batch) + ")", settings, [&]() {
+						if(queued == 0)
+						{
+							int sent{ sender.Send(outPackets.data(), batch) };
+							for(int received = 0; received < sent;)
+								received += receiver.Receive(inPackets.data() + received, sent - received);
+							queued = sent;
+						}
+						--queued;
+					});
+				}
+			}
+			void ReportBytes(const std::string& name, const Settings& settings, size_t bytes)
+			{
+				if(name.find(settings.filter) != std::string::npos)
+					std::cout << std::left << std::setw(36) << name << std::right << std::setw(12) << bytes << std::endl;
+			}
+			void ReportSnapshotBytes(const Settings& settings)
+			{
+				std::vector<SnapshotDelta::PuckState> pucks{ MakeSnapshotPucks() };
+				std::vector<SnapshotDelta::PuckState> baseline;
+				Buffer full;
+				WriteSnapshot(full, 1, 0, nullptr, pucks, baseline);
+
+				// Next frame: every puck moves, none bounces, so each is where the client
+				// predicts. Game::WriteNetworkSnapshot only sends that if the paddle moved.
+				Buffer predicted;
+				predicted.WriteByte(UDP_MESSAGE_SNAPSHOT);
+				predicted.WriteUInt(2);
+				predicted.WriteByte(1);
+				predicted.WriteUInt16((Uint16)pucks.size());
+				predicted.WriteUInt16(0);
+				predicted.WriteByte(0);
+				predicted.WriteByte(SNAPSHOT_HAS_PADDLE | SNAPSHOT_PUCKS_PREDICTED);
+				predicted.WriteFloat(GAME_RECT.GetCenter().y + 1.0f);
+
+				// Unless one hits a paddle
+				for(SnapshotDelta::PuckState& puck : baseline)
+					puck.position += SIMULATION_DT * puck.velocity;
+				for(SnapshotDelta::PuckState& puck : pucks)
+					puck.position += SIMULATION_DT * puck.velocity;
+				pucks.front().velocity.x = -pucks.front().velocity.x;
+				std::vector<SnapshotDelta::PuckState> reconstructed;
+				Buffer hit;
+				WriteSnapshot(hit, 2, 1, &baseline, pucks, reconstructed);
+
+				std::string puckCount{ std::to_string(SNAPSHOT_PUCKS) + " pucks" };
+				std::cout << std::endl << std::left << std::setw(36) << "snapshot" << std::right
+					<< std::setw(12) << "bytes" << std::endl;
+				ReportBytes("snapshot full (" + puckCount + ")", settings, full.length);
+				ReportBytes("snapshot paddle hit (" + puckCount + ")", settings, hit.length);
+				ReportBytes("snapshot paddle moved (" + puckCount + ")", settings, predicted.length);
+			}
+			void ReportMatchMemory(const Settings& settings, const RulesDef& rules)
+			{
+				std::unique_ptr<Game> gamePtr{ std::make_unique<Game>() };
+				gamePtr->Init(GameInitSettings::Mode::LOCAL, NetworkDef{});
+
+				std::cout << std::endl << std::left << std::setw(36) << "memory" << std::right
+					<< std::setw(12) << "bytes" << std::endl;
+				ReportBytes("Game::MatchState", settings, sizeof(Game::MatchState));
+				ReportBytes("Puck", settings, sizeof(Puck));
+				ReportBytes("Game (puckCount=" + std::to_string(rules.puckCount) + ", with heap)", settings, gamePtr->GetMemoryBytes());
+				ReportBytes("GameView (one per window)", settings, sizeof(GameView));
+			}
+		}
+
+		int Run(const std::vector<std::string>& arguments)
+		{
+			try {
+				Settings settings{ ParseArguments(arguments) };
+				RulesDef rules;
+				rules.LoadFrom("Data/rules.hjson");
+
+				if(!AllocationCounter::ENABLED)
+					std::cerr << "Allocations aren't counted; define PONG_COUNT_ALLOCATIONS in pch.h to measure them" << std::endl;
+				std::cout << std::left << std::setw(36) << "benchmark" << std::right
+					<< std::setw(12) << "ns/op" << std::setw(12) << "min" << std::setw(12) << "max"
+					<< std::setw(12) << "allocs/op" << std::endl;
+				BenchmarkBuffer(settings);
+				BenchmarkMessages(settings);
+				BenchmarkMatchState(settings);
+				BenchmarkSimulation(settings, rules);
+
+				// Sockets need SDL_net, which d2d starts
+				d2d::Init(d2LogSeverityTrace, "MicroBenchmark.log");
+				BenchmarkUdpSocket(settings);
+				d2d::Shutdown();
+
+				ReportMatchMemory(settings, rules);
+				ReportSnapshotBytes(settings);
+				return 0;
+			}
+			catch(const d2d::Exception& e) {
+				std::cerr << "Benchmark error: " << e.what() << std::endl;
+				d2d::Shutdown();
+				return 1;
+			}
+		}
+	}
+}
@@ -0,0 +1,31 @@
+/**************************************************************************************\
+** File: MicroBenchmark.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the MicroBenchmark namespace
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	// Times the network codec, UDP socket and simulation hot paths in isolation
+	// and prints ns/op and allocations/op. Each benchmark is calibrated to a
+	// batch length, then run for several batches; the median batch is reported
+	// along with the spread so runs can be compared. Also reports per-match memory
+	// and the size of a server snapshot, in full and with pucks predicted or not.
+	//
+	// Usage: Pong --benchmark-micro [name=value]...
+	//	filter=<substring of benchmark name> batchMs=<milliseconds> repetitions=<count>
+	//	Needs no window; sockets only use loopback. Run from the working directory so
+	//	Data\rules.hjson loads.
+	namespace MicroBenchmark
+	{
+		const std::string COMMAND_LINE_FLAG{ "--benchmark-micro" };
+
+		// Returns process exit code
+		int Run(const std::vector<std::string>& arguments);
+	}
+}
@@ -23,6 +23,11 @@ namespace Pong
 			serverIP = d2d::GetString(data, "serverIP");
 			serverPort = d2d::GetInt(data, "serverPort");
 			//clientUDPPort = d2d::GetInt(data, "clientUDPPort");
+			connectTimeoutSeconds = d2d::GetFloat(data, "connectTimeoutSeconds");
+			connectAttempts = d2d::GetInt(data, "connectAttempts");
+			connectRetryDelaySeconds = d2d::GetFloat(data, "connectRetryDelaySeconds");
+			snapshotHeartbeatSeconds = d2d::GetFloat(data, "snapshotHeartbeatSeconds");
+			clockSyncIntervalSeconds = d2d::GetFloat(data, "clockSyncIntervalSeconds");
 		}
 		catch(const d2d::HjsonFailedQueryException& e) {
 			throw LoadSettingsFileException{ gameFilePath + ": Invalid value: " + e.what() };
@@ -40,5 +45,10 @@ namespace Pong
 		if(serverIP.empty()) throw SettingOutOfRangeException{ "serverIP" };
 		if(serverPort <= 0) throw SettingOutOfRangeException{ "serverPort" };
 		//if(clientUDPPort <= 0) throw SettingOutOfRangeException{ "clientPortUDP" };
+		if(connectTimeoutSeconds <= 0.0f) throw SettingOutOfRangeException{ "connectTimeoutSeconds" };
+		if(connectAttempts < 1) throw SettingOutOfRangeException{ "connectAttempts" };
+		if(connectRetryDelaySeconds < 0.0f) throw SettingOutOfRangeException{ "connectRetryDelaySeconds" };
+		if(snapshotHeartbeatSeconds < 0.0f) throw SettingOutOfRangeException{ "snapshotHeartbeatSeconds" };
+		if(clockSyncIntervalSeconds <= 0.0f) throw SettingOutOfRangeException{ "clockSyncIntervalSeconds" };
 	}
 }
\ No newline at end of file
@@ -18,5 +18,16 @@ namespace Pong
 		std::string serverIP;
 		int serverPort;
 		//int clientUDPPort;
+
+		// Client connect sequence
+		float connectTimeoutSeconds{ 5.0f };	// Per attempt, resolve and TCP connect
+		int connectAttempts{ 3 };
+		float connectRetryDelaySeconds{ 1.0f };
+
+		// Server: longest gap between snapshots while the paddle is still and every
+		// puck is where the client predicts. 0 sends one every step.
+		float snapshotHeartbeatSeconds{ 0.25f };
+		// Client: time between clock synchronization exchanges, once synchronized
+		float clockSyncIntervalSeconds{ 0.1f };
 	};
 }
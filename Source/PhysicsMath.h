@@ -0,0 +1,85 @@
+/**************************************************************************************\
+** File: PhysicsMath.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the physics scalar types and the PhysicsMath namespace
+**
+\**************************************************************************************/
+#pragma once
+#include "Fixed.h"
+
+namespace Pong
+{
+	// Puck and Player simulate with these types. Defining PONG_FIXED_POINT_PHYSICS
+	// (see pch.h) switches them to fixed point for deterministic lockstep.
+#ifdef PONG_FIXED_POINT_PHYSICS
+	using PhysicsScalar = Fixed;
+	using PhysicsVec2 = FixedVec2;
+
+	namespace PhysicsMath
+	{
+		using namespace FixedMath;
+
+		inline PhysicsVec2 ToPhysics(const b2Vec2& v)
+		{
+			return { Fixed{ v.x }, Fixed{ v.y } };
+		}
+		inline b2Vec2 ToB2Vec2(const PhysicsVec2& v)
+		{
+			return { v.x.ToFloat(), v.y.ToFloat() };
+		}
+		inline float ToFloat(PhysicsScalar value)
+		{
+			return value.ToFloat();
+		}
+	}
+#else
+	using PhysicsScalar = float;
+	using PhysicsVec2 = b2Vec2;
+
+	namespace PhysicsMath
+	{
+		const float PI{ d2d::PI };
+		const float TWO_PI{ d2d::TWO_PI };
+
+		inline float Abs(float value)
+		{
+			return std::abs(value);
+		}
+		inline float Length(const b2Vec2& v)
+		{
+			return sqrtf(v.x * v.x + v.y * v.y);
+		}
+		inline float Sin(float radians)
+		{
+			return sin(radians);
+		}
+		inline float Cos(float radians)
+		{
+			return cos(radians);
+		}
+		inline float Atan2(float y, float x)
+		{
+			return atan2(y, x);
+		}
+		inline void WrapRadians(float& radians)
+		{
+			d2d::WrapRadians(radians);
+		}
+		inline const b2Vec2& ToPhysics(const b2Vec2& v)
+		{
+			return v;
+		}
+		inline const b2Vec2& ToB2Vec2(const b2Vec2& v)
+		{
+			return v;
+		}
+		inline float ToFloat(float value)
+		{
+			return value;
+		}
+	}
+#endif
+}
@@ -0,0 +1,212 @@
+/**************************************************************************************\
+** File: Profiler.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the frame profiler
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "Profiler.h"
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdio>
+
+namespace Pong
+{
+	namespace
+	{
+		const char* const PHASE_NAMES[]{ "events", "update", "network", "draw", "swap" };
+		static_assert(std::size(PHASE_NAMES) == (size_t)ProfilePhase::COUNT, "Every phase needs a name");
+
+		// Timed on the simulation thread, which ticks at its own rate, so these are
+		// averaged per tick rather than per rendered frame
+		const bool PHASE_PER_TICK[]{ false, true, true, false, false };
+		static_assert(std::size(PHASE_PER_TICK) == (size_t)ProfilePhase::COUNT, "Every phase needs a rate");
+
+		const float SIXTY_HZ_FRAME{ 1.0f / 60.0f };
+		const float THIRTY_HZ_FRAME{ 1.0f / 30.0f };
+
+		std::atomic<Uint64> phaseCounts[(int)ProfilePhase::COUNT];
+		std::atomic<Uint64> phaseScopes[(int)ProfilePhase::COUNT];
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			  ScopedTimer		   |
+	//\--------------------------------/--------------------------------------
+	ScopedTimer::ScopedTimer(ProfilePhase phase)
+		: m_phase{ phase },
+		  m_start{ SDL_GetPerformanceCounter() }
+	{
+	}
+	ScopedTimer::~ScopedTimer()
+	{
+		phaseCounts[(int)m_phase].fetch_add(SDL_GetPerformanceCounter() - m_start, std::memory_order_relaxed);
+		phaseScopes[(int)m_phase].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	//+--------------------------------\--------------------------------------
+	//|			ProfilerOverlay		   |
+	//\--------------------------------/--------------------------------------
+	void ProfilerOverlay::Init(const ProfilerDef& settings)
+	{
+		m_visible = settings.showOverlay;
+		m_historySeconds = settings.historySeconds;
+
+		m_frameTimes.assign(MAX_HISTORY_FRAMES, 0.0f);
+		m_nextFrame = 0;
+		m_frameCount = 0;
+
+		std::fill(std::begin(m_phaseSeconds), std::end(m_phaseSeconds), 0.0);
+		std::fill(std::begin(m_phaseScopes), std::end(m_phaseScopes), 0);
+		m_phaseFrames = 0;
+		m_phaseAllocations = 0;
+		m_lastAllocationCount = AllocationCounter::GetCount();
+		m_secondsUntilTextUpdate = 0.0f;
+		for(std::string& textLine : m_textLines)
+			textLine.reserve(MAX_TEXT_LINE_LENGTH);
+		for(std::atomic<Uint64>& counts : phaseCounts)
+			counts = 0;
+		for(std::atomic<Uint64>& scopes : phaseScopes)
+			scopes = 0;
+
+		m_sortScratch.reserve(MAX_HISTORY_FRAMES);
+		m_graph.Reserve(GRAPH_FRAMES + 3);
+	}
+	void ProfilerOverlay::ToggleVisible()
+	{
+		m_visible = !m_visible;
+	}
+	void ProfilerOverlay::EndFrame(float frameSeconds)
+	{
+		m_frameTimes[m_nextFrame] = frameSeconds;
+		m_nextFrame = (m_nextFrame + 1) % MAX_HISTORY_FRAMES;
+		m_frameCount = std::min(m_frameCount + 1, MAX_HISTORY_FRAMES);
+
+		double secondsPerCount{ 1.0 / (double)SDL_GetPerformanceFrequency() };
+		for(int i = 0; i < PHASE_COUNT; ++i)
+		{
+			m_phaseSeconds[i] += (double)phaseCounts[i].exchange(0, std::memory_order_relaxed) * secondsPerCount;
+			m_phaseScopes[i] += phaseScopes[i].exchange(0, std::memory_order_relaxed);
+		}
+		++m_phaseFrames;
+
+		Uint64 allocationCount{ AllocationCounter::GetCount() };
+		m_phaseAllocations += allocationCount - m_lastAllocationCount;
+		m_lastAllocationCount = allocationCount;
+
+		// Text only changes a few times per second so it can be read
+		m_secondsUntilTextUpdate -= frameSeconds;
+		if(m_secondsUntilTextUpdate <= 0.0f)
+		{
+			if(m_visible)
+				UpdateText();
+			std::fill(std::begin(m_phaseSeconds), std::end(m_phaseSeconds), 0.0);
+			std::fill(std::begin(m_phaseScopes), std::end(m_phaseScopes), 0);
+			m_phaseFrames = 0;
+			m_phaseAllocations = 0;
+			m_secondsUntilTextUpdate = TEXT_UPDATE_DELAY;
+		}
+	}
+	void ProfilerOverlay::UpdateText()
+	{
+		char line[MAX_TEXT_LINE_LENGTH];
+		for(int i = 0; i < PHASE_COUNT; ++i)
+		{
+			Uint64 samples{ PHASE_PER_TICK[i] ? m_phaseScopes[i] : (Uint64)m_phaseFrames };
+			double averageMs{ samples > 0 ? 1000.0 * m_phaseSeconds[i] / samples : 0.0 };
+			std::snprintf(line, sizeof(line), "%s %.2f ms/%s", PHASE_NAMES[i], averageMs, PHASE_PER_TICK[i] ? "tick" : "frame");
+			m_textLines[i] = line;
+		}
+
+		// Percentiles over the frames in the history window
+		m_sortScratch.clear();
+		float windowSeconds{ 0.0f };
+		for(int framesAgo = 0; framesAgo < m_frameCount && windowSeconds < m_historySeconds; ++framesAgo)
+		{
+			float frameTime{ GetFrameTime(framesAgo) };
+			m_sortScratch.push_back(frameTime);
+			windowSeconds += frameTime;
+		}
+		if(m_sortScratch.empty())
+			m_textLines[PHASE_COUNT].clear();
+		else
+		{
+			auto percentile = [this](float fraction) {
+				auto it = m_sortScratch.begin() + (size_t)(fraction * (m_sortScratch.size() - 1));
+				std::nth_element(m_sortScratch.begin(), it, m_sortScratch.end());
+				return 1000.0f * *it;
+			};
+			float p50{ percentile(0.50f) };
+			float p99{ percentile(0.99f) };
+			float max{ 1000.0f * *std::max_element(m_sortScratch.begin(), m_sortScratch.end()) };
+			std::snprintf(line, sizeof(line), "frame p50 %.1f p99 %.1f max %.1f ms", p50, p99, max);
+			m_textLines[PHASE_COUNT] = line;
+		}
+
+		// Heap allocations from all threads, which should be zero in steady state
+		double averageAllocations{ m_phaseFrames > 0 ? (double)m_phaseAllocations / m_phaseFrames : 0.0 };
+		if(AllocationCounter::ENABLED)
+			std::snprintf(line, sizeof(line), "allocs/frame %.1f", averageAllocations);
+		else
+			std::snprintf(line, sizeof(line), "allocs/frame not counted");
+		m_textLines[PHASE_COUNT + 1] = line;
+	}
+	float ProfilerOverlay::GetFrameTime(int framesAgo) const
+	{
+		return m_frameTimes[(m_nextFrame - 1 - framesAgo + MAX_HISTORY_FRAMES) % MAX_HISTORY_FRAMES];
+	}
+	void ProfilerOverlay::Draw()
+	{
+		if(!m_visible)
+			return;
+
+		// Lay out in pixels along the top-left of the screen
+		b2Vec2 resolution{ d2d::Window::GetScreenResolution() };
+		d2d::Window::SetCameraRect({ b2Vec2_zero, resolution });
+		d2d::Window::DisableTextures();
+		d2d::Window::EnableBlending();
+
+		const float margin{ 0.01f * resolution.y };
+		const float lineHeight{ 0.025f * resolution.y };
+		const float graphHeight{ 0.12f * resolution.y };
+		const float width{ 0.3f * resolution.x };
+		const float panelHeight{ graphHeight + TEXT_LINE_COUNT * lineHeight + 3.0f * margin };
+		const b2Vec2 panelTopLeft{ margin, resolution.y - margin };
+
+		// Background, reference lines at 60 and 30 Hz, and one bar per recent frame
+		m_graph.Clear();
+		m_graph.AddQuad({ { panelTopLeft.x, panelTopLeft.y - panelHeight }, { panelTopLeft.x + width, panelTopLeft.y } },
+			m_backgroundColor);
+		const b2Vec2 graphLowerLeft{ panelTopLeft.x + margin, panelTopLeft.y - panelHeight + margin };
+		const float graphWidth{ width - 2.0f * margin };
+		const float barWidth{ graphWidth / GRAPH_FRAMES };
+		for(float referenceSeconds : { SIXTY_HZ_FRAME, THIRTY_HZ_FRAME })
+		{
+			float y{ graphLowerLeft.y + graphHeight * referenceSeconds / GRAPH_MAX_SECONDS };
+			m_graph.AddQuad({ { graphLowerLeft.x, y }, { graphLowerLeft.x + graphWidth, y + 1.0f } }, m_referenceLineColor);
+		}
+		int graphFrames{ std::min(m_frameCount, (int)GRAPH_FRAMES) };
+		for(int framesAgo = 0; framesAgo < graphFrames; ++framesAgo)
+		{
+			float frameTime{ GetFrameTime(framesAgo) };
+			float x{ graphLowerLeft.x + graphWidth - (framesAgo + 1) * barWidth };
+			float barHeight{ graphHeight * std::min(frameTime, GRAPH_MAX_SECONDS) / GRAPH_MAX_SECONDS };
+			const d2d::Color& color{ frameTime > THIRTY_HZ_FRAME ? m_verySlowFrameColor :
+				frameTime > SIXTY_HZ_FRAME ? m_slowFrameColor : m_goodFrameColor };
+			m_graph.AddQuad({ { x, graphLowerLeft.y }, { x + barWidth, graphLowerLeft.y + barHeight } }, color);
+		}
+		m_graph.Draw();
+
+		// Text, top down
+		d2d::Window::SetColor(m_textColor);
+		for(int i = 0; i < TEXT_LINE_COUNT; ++i)
+		{
+			d2d::Window::PushMatrix();
+			d2d::Window::Translate({ panelTopLeft.x + margin, panelTopLeft.y - margin - i * lineHeight });
+			d2d::Window::DrawString(m_textLines[i], d2d::Alignment::LEFT_TOP, 0.8f * lineHeight, m_font);
+			d2d::Window::PopMatrix();
+		}
+	}
+}
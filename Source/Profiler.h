@@ -0,0 +1,95 @@
+/**************************************************************************************\
+** File: Profiler.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the frame profiler
+**
+\**************************************************************************************/
+#pragma once
+#include "AppDef.h"
+#include "QuadBatch.h"
+
+namespace Pong
+{
+	enum class ProfilePhase
+	{
+		EVENTS,
+		UPDATE,
+		NETWORK,
+		DRAW,
+		SWAP,
+		COUNT
+	};
+
+	// Adds the time spent in its scope to a phase total. Safe to use from any
+	// thread; the cost is two counter reads and one relaxed atomic add.
+	class ScopedTimer
+	{
+	public:
+		explicit ScopedTimer(ProfilePhase phase);
+		~ScopedTimer();
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	private:
+		ProfilePhase m_phase;
+		Uint64 m_start;
+	};
+
+	// Collects the phase totals once per frame and keeps a rolling frame time
+	// history. Draws per-phase averages (per tick for the phases timed on the
+	// simulation thread), a frame time graph, p50/p99/max over
+	// the history window and heap allocations per frame on top of the current
+	// app state.
+	class ProfilerOverlay
+	{
+	public:
+		void Init(const ProfilerDef& settings);
+		void ToggleVisible();
+
+		// Call once per frame with the duration of the previous frame
+		void EndFrame(float frameSeconds);
+		void Draw();
+
+	private:
+		static const int MAX_HISTORY_FRAMES{ 8192 };
+		static const int GRAPH_FRAMES{ 240 };
+		static const int PHASE_COUNT{ (int)ProfilePhase::COUNT };
+		static const int TEXT_LINE_COUNT{ PHASE_COUNT + 2 };
+		static const int MAX_TEXT_LINE_LENGTH{ 64 };
+		const float TEXT_UPDATE_DELAY{ 0.25f };
+		const float GRAPH_MAX_SECONDS{ 0.050f };
+
+		void UpdateText();
+		float GetFrameTime(int framesAgo) const;
+
+		bool m_visible{ false };
+		float m_historySeconds{ 5.0f };
+
+		// Rolling frame time history, newest at m_nextFrame - 1
+		std::vector<float> m_frameTimes;
+		int m_nextFrame{ 0 };
+		int m_frameCount{ 0 };
+		std::vector<float> m_sortScratch;	// Reserved for the whole history by Init
+
+		// Phase totals since the text was last updated
+		double m_phaseSeconds[PHASE_COUNT]{};
+		Uint64 m_phaseScopes[PHASE_COUNT]{};
+		int m_phaseFrames{ 0 };
+		Uint64 m_phaseAllocations{ 0 };
+		Uint64 m_lastAllocationCount{ 0 };
+		float m_secondsUntilTextUpdate{ 0.0f };
+		std::string m_textLines[TEXT_LINE_COUNT];
+
+		QuadBatch m_graph;
+		d2d::FontReference m_font{ "Fonts/OrbitronLight.otf" };
+		const d2d::Color m_textColor{ 1.0f, 1.0f, 0.0f };
+		const d2d::Color m_backgroundColor{ 0.0f, 0.0f, 0.0f, 0.6f };
+		const d2d::Color m_goodFrameColor{ 0.1f, 0.9f, 0.1f };
+		const d2d::Color m_slowFrameColor{ 0.9f, 0.9f, 0.1f };
+		const d2d::Color m_verySlowFrameColor{ 0.9f, 0.1f, 0.1f };
+		const d2d::Color m_referenceLineColor{ 1.0f, 1.0f, 1.0f, 0.4f };
+	};
+}
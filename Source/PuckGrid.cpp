@@ -0,0 +1,102 @@
+/**************************************************************************************\
+** File: PuckGrid.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the PuckGrid class
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "PuckGrid.h"
+#include "Game.h"
+
+namespace Pong
+{
+	namespace
+	{
+		// A puck can only touch pucks in its own cell or the 8 around it
+		const float CELL_SIZE{ 2.0f * std::max(PUCK_SIZE.x, PUCK_SIZE.y) };
+	}
+	size_t PuckGrid::GetHeapBytes() const
+	{
+		return (m_puckCells.capacity() + m_cellStarts.capacity() + m_sortedPucks.capacity() + m_cellFill.capacity()) * sizeof(int);
+	}
+	void PuckGrid::Build(const std::vector<Puck>& pucks)
+	{
+		m_columns = std::max(1, (int)std::ceil(GAME_RECT.GetWidth() / CELL_SIZE));
+		m_rows = std::max(1, (int)std::ceil(GAME_RECT.GetHeight() / CELL_SIZE));
+		int cellCount{ m_columns * m_rows };
+
+		// Count pucks per cell
+		m_cellStarts.assign(cellCount + 1, 0);
+		m_puckCells.resize(pucks.size());
+		for(size_t i = 0; i < pucks.size(); ++i)
+		{
+			m_puckCells[i] = GetCellIndex(pucks[i].GetPosition());
+			++m_cellStarts[m_puckCells[i] + 1];
+		}
+
+		// Prefix sum gives each cell's start
+		for(int cell = 0; cell < cellCount; ++cell)
+			m_cellStarts[cell + 1] += m_cellStarts[cell];
+
+		// Scatter puck indices, keeping them in ascending order within a cell
+		m_sortedPucks.resize(pucks.size());
+		m_cellFill.assign(m_cellStarts.begin(), m_cellStarts.end() - 1);
+		for(size_t i = 0; i < pucks.size(); ++i)
+			m_sortedPucks[m_cellFill[m_puckCells[i]]++] = (int)i;
+	}
+	void PuckGrid::FindOverlappingPairs(const std::vector<Puck>& pucks, std::vector<Pair>& pairsOut) const
+	{
+		pairsOut.clear();
+		for(int i = 0; i < (int)pucks.size() && i < (int)m_puckCells.size(); ++i)
+		{
+			int cell{ m_puckCells[i] };
+			int column{ cell % m_columns };
+			int row{ cell / m_columns };
+
+			// Same cell, then the forward half of the neighborhood so each pair is visited once
+			AddOverlappingPairs(pucks, i, cell, true, pairsOut);
+			const int NEIGHBOR_OFFSETS[4][2]{ { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+			for(const auto& offset : NEIGHBOR_OFFSETS)
+			{
+				int neighborColumn{ column + offset[0] };
+				int neighborRow{ row + offset[1] };
+				if(neighborColumn < 0 || neighborColumn >= m_columns || neighborRow < 0 || neighborRow >= m_rows)
+					continue;
+				AddOverlappingPairs(pucks, i, neighborRow * m_columns + neighborColumn, false, pairsOut);
+			}
+		}
+	}
+	int PuckGrid::GetCellIndex(const b2Vec2& position) const
+	{
+		// Pucks past the goal lines still go in the edge cells
+		int column{ (int)((position.x - GAME_RECT.lowerBound.x) / CELL_SIZE) };
+		int row{ (int)((position.y - GAME_RECT.lowerBound.y) / CELL_SIZE) };
+		d2d::Clamp(column, { 0, m_columns - 1 });
+		d2d::Clamp(row, { 0, m_rows - 1 });
+		return row * m_columns + column;
+	}
+	void PuckGrid::AddOverlappingPairs(const std::vector<Puck>& pucks, int puckIndex, int cellIndex,
+		bool sameCell, std::vector<Pair>& pairsOut) const
+	{
+		const b2Vec2 position{ pucks[puckIndex].GetPosition() };
+		for(int slot = m_cellStarts[cellIndex]; slot < m_cellStarts[cellIndex + 1]; ++slot)
+		{
+			int otherIndex{ m_sortedPucks[slot] };
+			if(sameCell && otherIndex <= puckIndex)
+				continue;
+
+			const b2Vec2 otherPosition{ pucks[otherIndex].GetPosition() };
+			if(std::abs(otherPosition.x - position.x) < PUCK_SIZE.x &&
+				std::abs(otherPosition.y - position.y) < PUCK_SIZE.y)
+			{
+				if(puckIndex < otherIndex)
+					pairsOut.push_back({ puckIndex, otherIndex });
+				else
+					pairsOut.push_back({ otherIndex, puckIndex });
+			}
+		}
+	}
+}
@@ -0,0 +1,47 @@
+/**************************************************************************************\
+** File: PuckGrid.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the PuckGrid class
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	struct Puck;
+
+	// Uniform grid broadphase over GAME_RECT. Pucks are bucketed with a counting
+	// sort into one contiguous index array, so building and querying are linear
+	// in the number of pucks and walk memory in order.
+	class PuckGrid
+	{
+	public:
+		struct Pair
+		{
+			int first;
+			int second;
+		};
+
+		void Build(const std::vector<Puck>& pucks);
+
+		// Pairs of pucks whose boxes overlap, each pair once with first < second
+		void FindOverlappingPairs(const std::vector<Puck>& pucks, std::vector<Pair>& pairsOut) const;
+
+		size_t GetHeapBytes() const;
+
+	private:
+		int GetCellIndex(const b2Vec2& position) const;
+		void AddOverlappingPairs(const std::vector<Puck>& pucks, int puckIndex, int cellIndex,
+			bool sameCell, std::vector<Pair>& pairsOut) const;
+
+		int m_columns{ 0 };
+		int m_rows{ 0 };
+		std::vector<int> m_puckCells;	// Cell of each puck
+		std::vector<int> m_cellStarts;	// Index into m_sortedPucks, one extra at end
+		std::vector<int> m_sortedPucks;	// Puck indices grouped by cell
+		std::vector<int> m_cellFill;	// Scratch for Build
+	};
+}
@@ -0,0 +1,79 @@
+/**************************************************************************************\
+** File: QuadBatch.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the QuadBatch class
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "QuadBatch.h"
+#include <SDL_opengl.h>
+
+namespace Pong
+{
+	void QuadBatch::Reserve(size_t quadCount)
+	{
+		m_vertices.reserve(m_staticVertexCount + quadCount * VERTICES_PER_QUAD);
+	}
+	void QuadBatch::AddQuad(const d2d::Rect& rect, const d2d::Color& color)
+	{
+		const Uint8 colorBytes[4]{
+			(Uint8)(std::clamp(color.red, 0.0f, 1.0f) * 255.0f + 0.5f),
+			(Uint8)(std::clamp(color.green, 0.0f, 1.0f) * 255.0f + 0.5f),
+			(Uint8)(std::clamp(color.blue, 0.0f, 1.0f) * 255.0f + 0.5f),
+			(Uint8)(std::clamp(color.alpha, 0.0f, 1.0f) * 255.0f + 0.5f) };
+
+		// Two triangles, counter-clockwise
+		const b2Vec2& lower{ rect.lowerBound };
+		const b2Vec2& upper{ rect.upperBound };
+		AddVertex(lower.x, lower.y, colorBytes);
+		AddVertex(upper.x, lower.y, colorBytes);
+		AddVertex(upper.x, upper.y, colorBytes);
+		AddVertex(lower.x, lower.y, colorBytes);
+		AddVertex(upper.x, upper.y, colorBytes);
+		AddVertex(lower.x, upper.y, colorBytes);
+	}
+	void QuadBatch::AddOutline(const d2d::Rect& rect, float thickness, const d2d::Color& color)
+	{
+		// Four edge quads drawn inside the rect, with the sides fitted between top and bottom
+		const b2Vec2& lower{ rect.lowerBound };
+		const b2Vec2& upper{ rect.upperBound };
+		AddQuad({ lower, { upper.x, lower.y + thickness } }, color);
+		AddQuad({ { lower.x, upper.y - thickness }, upper }, color);
+		AddQuad({ { lower.x, lower.y + thickness }, { lower.x + thickness, upper.y - thickness } }, color);
+		AddQuad({ { upper.x - thickness, lower.y + thickness }, { upper.x, upper.y - thickness } }, color);
+	}
+	void QuadBatch::FinishStaticGeometry()
+	{
+		m_staticVertexCount = m_vertices.size();
+	}
+	void QuadBatch::ClearStaticGeometry()
+	{
+		m_vertices.clear();
+		m_staticVertexCount = 0;
+	}
+	void QuadBatch::Clear()
+	{
+		// Shrinking never reallocates, so a reserved batch stays allocation free
+		m_vertices.resize(m_staticVertexCount);
+	}
+	void QuadBatch::Draw() const
+	{
+		if(m_vertices.empty())
+			return;
+
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &m_vertices[0].x);
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &m_vertices[0].red);
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)m_vertices.size());
+		glDisableClientState(GL_COLOR_ARRAY);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+	void QuadBatch::AddVertex(float x, float y, const Uint8 color[4])
+	{
+		m_vertices.push_back({ x, y, color[0], color[1], color[2], color[3] });
+	}
+}
@@ -0,0 +1,46 @@
+/**************************************************************************************\
+** File: QuadBatch.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the QuadBatch class
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	// Collects solid colored quads into one persistent vertex array and submits
+	// them with a single draw call. Geometry added before FinishStaticGeometry()
+	// stays at the front of the array and survives Clear(), so unchanging shapes
+	// are built once and only moving shapes are rewritten each frame.
+	class QuadBatch
+	{
+	public:
+		void Reserve(size_t quadCount);
+		void AddQuad(const d2d::Rect& rect, const d2d::Color& color);
+		void AddOutline(const d2d::Rect& rect, float thickness, const d2d::Color& color);
+		void FinishStaticGeometry();
+		void ClearStaticGeometry();
+
+		// Removes everything added after FinishStaticGeometry()
+		void Clear();
+
+		// Draws in the current camera space. Textures should be disabled.
+		void Draw() const;
+
+	private:
+		struct Vertex
+		{
+			float x, y;
+			Uint8 red, green, blue, alpha;
+		};
+		static const int VERTICES_PER_QUAD{ 6 };
+
+		void AddVertex(float x, float y, const Uint8 color[4]);
+
+		std::vector<Vertex> m_vertices;
+		size_t m_staticVertexCount{ 0 };
+	};
+}
@@ -0,0 +1,214 @@
+/**************************************************************************************\
+** File: RenderBenchmark.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the RenderBenchmark namespace
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "RenderBenchmark.h"
+#include "AppDef.h"
+#include "Intro.h"
+#include "MainMenu.h"
+#include "Gameplay.h"
+#include "GameInitSettings.h"
+#include "AllocationCounter.h"
+#include "CommandLine.h"
+#include "Exceptions.h"
+#include <SDL_opengl.h>
+#include <iomanip>
+#include <iostream>
+
+namespace Pong
+{
+	namespace RenderBenchmark
+	{
+		namespace
+		{
+			const int DEFAULT_FRAMES{ 1000 };
+			const int DEFAULT_WARMUP_FRAMES{ 60 };
+			const float UPDATE_DT{ 1.0f / 60.0f };
+
+			struct Settings
+			{
+				std::vector<std::string> states{ "intro", "menu", "game" };
+				int frames{ DEFAULT_FRAMES };
+				int warmupFrames{ DEFAULT_WARMUP_FRAMES };
+				std::string backend;	// Empty uses app.hjson
+				float maxP99Milliseconds{ 0.0f };	// 0 disables the check
+				int maxAllocationsPerFrame{ 0 };	// Negative disables the check
+			};
+
+			Settings ParseArguments(const std::vector<std::string>& arguments)
+			{
+				Settings settings;
+				for(const CommandLine::Argument& argument : CommandLine::Parse(arguments))
+				{
+					const std::string& name{ argument.name };
+					const std::string& value{ argument.value };
+					if(name == "states")
+					{
+						settings.states.clear();
+						size_t start{ 0 };
+						while(start <= value.size())
+						{
+							size_t comma{ std::min(value.find(',', start), value.size()) };
+							settings.states.push_back(value.substr(start, comma - start));
+							start = comma + 1;
+						}
+					}
+					else if(name == "frames")
+						settings.frames = CommandLine::ToInt(argument);
+					else if(name == "warmup")
+						settings.warmupFrames = CommandLine::ToInt(argument);
+					else if(name == "backend")
+						settings.backend = value;
+					else if(name == "maxP99Ms")
+						settings.maxP99Milliseconds = CommandLine::ToFloat(argument);
+					else if(name == "maxAllocsPerFrame")
+						settings.maxAllocationsPerFrame = CommandLine::ToInt(argument);
+					else
+						throw BenchmarkException{ "Unknown setting: " + name };
+				}
+				if(settings.frames < 1)
+					throw BenchmarkException{ "frames must be at least 1" };
+				if(settings.warmupFrames < 0)
+					throw BenchmarkException{ "warmup can't be negative" };
+				// Otherwise the allocation check would pass without having counted anything
+				if(settings.maxAllocationsPerFrame >= 0 && !AllocationCounter::ENABLED)
+					throw BenchmarkException{ "maxAllocsPerFrame needs a build with PONG_COUNT_ALLOCATIONS defined; "
+						"pass maxAllocsPerFrame=-1 to skip the check" };
+				return settings;
+			}
+			std::shared_ptr<AppState> MakeState(const std::string& name)
+			{
+				if(name == "intro")	return std::make_shared<Intro>();
+				if(name == "menu")	return std::make_shared<MainMenu>();
+				if(name == "game")	return std::make_shared<Gameplay>();
+				throw BenchmarkException{ "Unknown state: " + name + " (expected intro, menu or game)" };
+			}
+
+			void PushKey(AppState& state, Uint32 type, SDL_Keycode key)
+			{
+				SDL_Event event{};
+				event.type = type;
+				event.key.keysym.sym = key;
+				state.ProcessEvent(event);
+			}
+
+			// Runs a whole app frame. Returns seconds from StartScene until the GPU
+			// has finished drawing; the update isn't part of the timing.
+			double StepFrame(AppState& state, bool pressReadyKeys, double secondsPerCount)
+			{
+				// Keeps a game cycling through the ready, countdown and play screens
+				if(pressReadyKeys)
+					for(SDL_Keycode key : { SDLK_w, SDLK_UP })
+					{
+						PushKey(state, SDL_KEYDOWN, key);
+						PushKey(state, SDL_KEYUP, key);
+					}
+				state.Update(UPDATE_DT);
+
+				Uint64 start{ SDL_GetPerformanceCounter() };
+				d2d::Window::StartScene();
+				state.Draw();
+				glFinish();
+				Uint64 end{ SDL_GetPerformanceCounter() };
+				d2d::Window::EndScene();
+				return (double)(end - start) * secondsPerCount;
+			}
+
+			// Returns false if p99 or allocations per frame are over the limit
+			bool Benchmark(const std::string& stateName, const Settings& settings)
+			{
+				std::shared_ptr<AppState> statePtr{ MakeState(stateName) };
+				statePtr->Init();
+				d2d::Window::SetClearColor(statePtr->GetClearColor());
+				bool pressReadyKeys{ stateName == "game" };
+
+				double secondsPerCount{ 1.0 / (double)SDL_GetPerformanceFrequency() };
+				for(int i = 0; i < settings.warmupFrames; ++i)
+					StepFrame(*statePtr, pressReadyKeys, secondsPerCount);
+
+				// Allocations from all threads after warmup, so one-time setup doesn't count
+				std::vector<double> frameSeconds((size_t)settings.frames);
+				Uint64 allocationsBefore{ AllocationCounter::GetCount() };
+				for(double& seconds : frameSeconds)
+					seconds = StepFrame(*statePtr, pressReadyKeys, secondsPerCount);
+				Uint64 allocations{ AllocationCounter::GetCount() - allocationsBefore };
+
+				std::sort(frameSeconds.begin(), frameSeconds.end());
+				auto percentile = [&frameSeconds](double fraction) {
+					return 1000.0 * frameSeconds[(size_t)(fraction * (frameSeconds.size() - 1))];
+				};
+				double mean{ 0.0 };
+				for(double seconds : frameSeconds)
+					mean += seconds;
+				mean = 1000.0 * mean / frameSeconds.size();
+				double p99{ percentile(0.99) };
+
+				std::cout << stateName << '\t' << settings.frames << '\t'
+					<< std::fixed << std::setprecision(3)
+					<< mean << '\t' << percentile(0.5) << '\t' << p99 << '\t' << 1000.0 * frameSeconds.back() << '\t';
+				if(AllocationCounter::ENABLED)
+					std::cout << (double)allocations / settings.frames;
+				else
+					std::cout << '-';
+				std::cout << std::defaultfloat << std::endl;
+
+				bool p99Passed{ settings.maxP99Milliseconds <= 0.0f || p99 <= settings.maxP99Milliseconds };
+				bool allocationsPassed{ settings.maxAllocationsPerFrame < 0 ||
+					allocations <= (Uint64)settings.maxAllocationsPerFrame * settings.frames };
+				return p99Passed && allocationsPassed;
+			}
+		}
+
+		int Run(const std::vector<std::string>& arguments)
+		{
+			try {
+				Settings settings{ ParseArguments(arguments) };
+
+				AppDef appSettings;
+				appSettings.LoadFrom("Data/app.hjson");
+				if(settings.backend == "offscreen")
+					appSettings.renderBackend = RenderBackend::OFFSCREEN;
+				else if(settings.backend == "window")
+					appSettings.renderBackend = RenderBackend::WINDOW;
+				else if(!settings.backend.empty())
+					throw BenchmarkException{ "Unknown backend: " + settings.backend };
+
+				// Measure rendering, not waiting for the display
+				appSettings.window.vsync = false;
+				appSettings.ApplyRenderBackend();
+
+				d2d::Init(d2LogSeverityTrace, "RenderBenchmark.log");
+				d2d::Window::Init(appSettings.window);
+				GameInitSettings::SetGameMode(GameInitSettings::Mode::LOCAL);
+
+				if(!AllocationCounter::ENABLED)
+					std::cerr << "Allocations aren't counted; define PONG_COUNT_ALLOCATIONS in pch.h to measure them" << std::endl;
+				std::cout << "state\tframes\tmean ms\tp50 ms\tp99 ms\tmax ms\tallocs/frame" << std::endl;
+				bool passed{ true };
+				for(const std::string& stateName : settings.states)
+					if(!Benchmark(stateName, settings))
+						passed = false;
+				d2d::Shutdown();
+
+				if(!passed)
+				{
+					std::cerr << "Render benchmark failed: p99 above " << settings.maxP99Milliseconds
+						<< " ms or more than " << settings.maxAllocationsPerFrame << " allocations per frame" << std::endl;
+					return 1;
+				}
+				return 0;
+			}
+			catch(const std::exception& e) {
+				std::cerr << "Render benchmark error: " << e.what() << std::endl;
+				d2d::Shutdown();
+				return 1;
+			}
+		}
+	}
+}
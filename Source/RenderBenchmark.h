@@ -0,0 +1,36 @@
+/**************************************************************************************\
+** File: RenderBenchmark.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the RenderBenchmark namespace
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	// Runs each app state for a number of frames with vsync off and reports
+	// the time from StartScene until the GPU finishes (glFinish), excluding the
+	// update and swap, plus heap allocations per frame after warmup. The game
+	// state gets ready key presses every frame so it cycles through countdown
+	// and play. With backend=offscreen it runs on machines without a display.
+	//
+	// Usage: Pong --benchmark-render [name=value]...
+	//	states=<intro,menu,game> frames=<count> warmup=<count>
+	//	backend=<window|offscreen> maxP99Ms=<milliseconds>
+	//	maxAllocsPerFrame=<count, default 0, negative disables the check>
+	//	Exits with 1 if any state's p99 is above maxP99Ms or it allocates more
+	//	than maxAllocsPerFrame on average, so by default any allocation after
+	//	warmup fails. Build agents can fail on render and allocation regressions.
+	//	Allocations are only counted when PONG_COUNT_ALLOCATIONS is defined; in
+	//	other builds the check can't run, so it's an error unless disabled.
+	namespace RenderBenchmark
+	{
+		const std::string COMMAND_LINE_FLAG{ "--benchmark-render" };
+
+		// Returns process exit code
+		int Run(const std::vector<std::string>& arguments);
+	}
+}
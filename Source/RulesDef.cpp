@@ -0,0 +1,55 @@
+/**************************************************************************************\
+** File: RulesDef.cpp
+** Project:
+** Author: David Leksen
+** Date:
+**
+** Source code file for the RulesDef struct
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "RulesDef.h"
+#include "Exceptions.h"
+
+namespace Pong
+{
+	void RulesDef::LoadFrom(const std::string& rulesFilePath)
+	{
+		d2d::HjsonValue data{ d2d::FileToHJSON(rulesFilePath) };
+		if(!d2d::IsNonNull(data))
+			throw LoadSettingsFileException{ rulesFilePath + ": Invalid file" };
+
+		try	{
+			initialPuckSpeed = d2d::GetFloat(data, "initialPuckSpeed");
+			puckSpeedBoostMultiplier = d2d::GetFloat(data, "puckSpeedBoostMultiplier");
+			playerMaxSpeed = d2d::GetFloat(data, "playerMaxSpeed");
+			startAngle = RADIANS_PER_DEGREE * d2d::GetFloat(data, "startAngle");
+			bounceAngleRange = RADIANS_PER_DEGREE * d2d::GetFloat(data, "bounceAngleRange");
+			maxCurvatureAngleChange = RADIANS_PER_DEGREE * d2d::GetFloat(data, "maxCurvatureAngleChange");
+
+			scoreToWin = (unsigned)d2d::GetInt(data, "scoreToWin");
+			puckCount = (unsigned)d2d::GetInt(data, "puckCount");
+		}
+		catch(const d2d::HjsonFailedQueryException& e) {
+			throw LoadSettingsFileException{ rulesFilePath + ": Invalid value: " + e.what() };
+		}
+
+		try {
+			Validate();
+		}
+		catch(const SettingOutOfRangeException& e) {
+			throw LoadSettingsFileException{ rulesFilePath + ": Setting out of range: " + e.what() };
+		}
+	}
+	void RulesDef::Validate() const
+	{
+		if(initialPuckSpeed <= 0.0f) throw SettingOutOfRangeException{ "initialPuckSpeed" };
+		if(puckSpeedBoostMultiplier < 1.0f) throw SettingOutOfRangeException{ "puckSpeedBoostMultiplier" };
+		if(playerMaxSpeed < 0.0f) throw SettingOutOfRangeException{ "playerMaxSpeed" };
+		if(startAngle < 0.0f || startAngle >= 0.5f * d2d::PI) throw SettingOutOfRangeException{ "startAngle" };
+		if(bounceAngleRange <= 0.0f || bounceAngleRange >= d2d::PI) throw SettingOutOfRangeException{ "bounceAngleRange" };
+		if(maxCurvatureAngleChange < 0.0f) throw SettingOutOfRangeException{ "maxCurvatureAngleChange" };
+		if(scoreToWin == 0 || scoreToWin > MAX_SCORE_TO_WIN) throw SettingOutOfRangeException{ "scoreToWin" };
+		if(puckCount == 0 || puckCount > MAX_PUCK_COUNT) throw SettingOutOfRangeException{ "puckCount" };
+	}
+}
@@ -0,0 +1,35 @@
+/**************************************************************************************\
+** File: RulesDef.h
+** Project: 
+** Author: David Leksen
+** Date: 
+**
+** Header file for the RulesDef struct
+**
+\**************************************************************************************/
+#pragma once
+namespace Pong
+{
+	// Angles are stored in degrees in the settings file
+	const float RADIANS_PER_DEGREE{ d2d::PI / 180.0f };
+
+	// Scores travel in one byte over the network
+	const unsigned MAX_SCORE_TO_WIN{ 255u };
+	const unsigned MAX_PUCK_COUNT{ 1024u };
+
+	struct RulesDef
+	{
+		void LoadFrom(const std::string& filePath);
+		void Validate() const;
+
+		float initialPuckSpeed;
+		float puckSpeedBoostMultiplier;
+		float playerMaxSpeed;
+		float startAngle;				// Radians
+		float bounceAngleRange;			// Radians
+		float maxCurvatureAngleChange;	// Radians
+
+		unsigned scoreToWin;
+		unsigned puckCount;		// More than one puck plays without stopping after goals
+	};
+}
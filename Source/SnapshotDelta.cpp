@@ -0,0 +1,186 @@
+/**************************************************************************************\
+** File: SnapshotDelta.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the SnapshotDelta namespace
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "SnapshotDelta.h"
+#include "Game.h"
+#include "Exceptions.h"
+
+namespace Pong
+{
+	namespace SnapshotDelta
+	{
+		namespace
+		{
+			// Puck mask bits
+			const Byte POSITION_OFFSET{ 1 << 0 };	// Two Sint16 steps from the baseline
+			const Byte POSITION_FULL{ 1 << 1 };		// Two floats
+			const Byte VELOCITY{ 1 << 2 };			// Two floats
+
+			const float MAX_OFFSET_STEPS{ (float)std::numeric_limits<Sint16>::max() };
+
+			// Same operations on both sides, so both get the same float
+			float ApplyOffset(float baseline, Sint16 steps)
+			{
+				return baseline + (float)steps * POSITION_STEP;
+			}
+			Byte ReadMask(const Buffer& data, int index)
+			{
+				if(index >= data.length)
+					throw GameException{ "Snapshot puck missing" };
+				Byte mask{ data.bytes[index] };
+				if((mask & ~(POSITION_OFFSET | POSITION_FULL | VELOCITY)) || ((mask & POSITION_OFFSET) && (mask & POSITION_FULL)))
+					throw GameException{ "Invalid snapshot puck mask: " + d2d::ToString(mask) };
+				return mask;
+			}
+		}
+
+		//+--------------------------------\--------------------------------------
+		//|			  History			   |
+		//\--------------------------------/--------------------------------------
+		bool Record::IsComplete() const
+		{
+			return inUse && hasPaddle && receivedPuckCount == pucks.size();
+		}
+		void History::Clear()
+		{
+			for(Record& record : m_records)
+				record.inUse = false;
+		}
+		Record& History::Begin(unsigned sequenceNum, size_t puckCount)
+		{
+			Record& record{ m_records[sequenceNum % HISTORY_SIZE] };
+			record.sequenceNum = sequenceNum;
+			record.inUse = true;
+			record.hasPaddle = false;
+			record.pucks.resize(puckCount);
+			record.receivedPucks.assign(puckCount, 0);
+			record.receivedPuckCount = 0;
+			return record;
+		}
+		Record* History::Find(unsigned sequenceNum)
+		{
+			Record& record{ m_records[sequenceNum % HISTORY_SIZE] };
+			return (record.inUse && record.sequenceNum == sequenceNum) ? &record : nullptr;
+		}
+		const Record* History::FindComplete(unsigned sequenceNum) const
+		{
+			const Record& record{ m_records[sequenceNum % HISTORY_SIZE] };
+			return (record.sequenceNum == sequenceNum && record.IsComplete()) ? &record : nullptr;
+		}
+		size_t History::GetHeapBytes() const
+		{
+			size_t bytes{ m_records.capacity() * sizeof(Record) };
+			for(const Record& record : m_records)
+				bytes += record.pucks.capacity() * sizeof(PuckState) + record.receivedPucks.capacity();
+			return bytes;
+		}
+
+		//+--------------------------------\--------------------------------------
+		//|			 Encoding			   |
+		//\--------------------------------/--------------------------------------
+		bool Matches(const PuckState& baseline, const PuckState& current)
+		{
+			return std::abs(current.position.x - baseline.position.x) < 0.5f * POSITION_STEP &&
+				std::abs(current.position.y - baseline.position.y) < 0.5f * POSITION_STEP &&
+				current.velocity.x == baseline.velocity.x && current.velocity.y == baseline.velocity.y;
+		}
+		void WritePuck(Buffer& output, const PuckState* baselinePtr, const PuckState& current, PuckState& reconstructed)
+		{
+			Byte mask{ 0 };
+			Sint16 offsetX{ 0 };
+			Sint16 offsetY{ 0 };
+			reconstructed = current;
+			if(!baselinePtr)
+				mask = POSITION_FULL | VELOCITY;
+			else
+			{
+				float stepsX{ std::round((current.position.x - baselinePtr->position.x) / POSITION_STEP) };
+				float stepsY{ std::round((current.position.y - baselinePtr->position.y) / POSITION_STEP) };
+				if(std::abs(stepsX) > MAX_OFFSET_STEPS || std::abs(stepsY) > MAX_OFFSET_STEPS)
+					mask |= POSITION_FULL;
+				else
+				{
+					offsetX = (Sint16)stepsX;
+					offsetY = (Sint16)stepsY;
+					if(offsetX != 0 || offsetY != 0)
+						mask |= POSITION_OFFSET;
+					reconstructed.position.Set(ApplyOffset(baselinePtr->position.x, offsetX),
+						ApplyOffset(baselinePtr->position.y, offsetY));
+				}
+				if(current.velocity.x != baselinePtr->velocity.x || current.velocity.y != baselinePtr->velocity.y)
+					mask |= VELOCITY;
+				else
+					reconstructed.velocity = baselinePtr->velocity;
+			}
+
+			output.WriteByte(mask);
+			if(mask & POSITION_OFFSET)
+			{
+				output.WriteUInt16((Uint16)offsetX);
+				output.WriteUInt16((Uint16)offsetY);
+			}
+			else if(mask & POSITION_FULL)
+			{
+				output.WriteFloat(current.position.x);
+				output.WriteFloat(current.position.y);
+			}
+			if(mask & VELOCITY)
+			{
+				output.WriteFloat(current.velocity.x);
+				output.WriteFloat(current.velocity.y);
+			}
+		}
+		int ReadPuck(const Buffer& data, int index, const PuckState* baselinePtr, PuckState& result)
+		{
+			int first{ index };
+			Byte mask{ ReadMask(data, index++) };
+			if(!baselinePtr && (mask & (POSITION_FULL | VELOCITY)) != (POSITION_FULL | VELOCITY))
+				throw GameException{ "Snapshot puck delta without a baseline" };
+
+			if(mask & POSITION_OFFSET)
+			{
+				Sint16 offsetX{ (Sint16)data.ReadUInt16(index) };
+				Sint16 offsetY{ (Sint16)data.ReadUInt16(index + sizeof(Uint16)) };
+				index += 2 * sizeof(Uint16);
+				result.position.Set(ApplyOffset(baselinePtr->position.x, offsetX), ApplyOffset(baselinePtr->position.y, offsetY));
+			}
+			else if(mask & POSITION_FULL)
+			{
+				result.position.Set(data.ReadFloat(index), data.ReadFloat(index + sizeof(float)));
+				index += 2 * sizeof(float);
+			}
+			else
+				result.position = baselinePtr->position;
+
+			if(mask & VELOCITY)
+			{
+				result.velocity.Set(data.ReadFloat(index), data.ReadFloat(index + sizeof(float)));
+				index += 2 * sizeof(float);
+			}
+			else
+				result.velocity = baselinePtr->velocity;
+			return index - first;
+		}
+		int SkipPuck(const Buffer& data, int index)
+		{
+			Byte mask{ ReadMask(data, index) };
+			int bytes{ 1 };
+			if(mask & POSITION_OFFSET)
+				bytes += 2 * sizeof(Uint16);
+			else if(mask & POSITION_FULL)
+				bytes += 2 * sizeof(float);
+			if(mask & VELOCITY)
+				bytes += 2 * sizeof(float);
+			if(index + bytes > data.length)
+				throw GameException{ "Snapshot puck truncated" };
+			return bytes;
+		}
+	}
+}
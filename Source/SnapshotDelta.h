@@ -0,0 +1,83 @@
+/**************************************************************************************\
+** File: SnapshotDelta.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the SnapshotDelta namespace
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	struct Buffer;
+
+	// Server snapshots (the server's paddle and every puck) are sent as deltas
+	// against a baseline: the newest snapshot the client acknowledged having in full.
+	// Pucks are compared with the baseline's moved forward to the snapshot's tick, so
+	// one that only bounced off walls since matches. Each puck starts with a mask of
+	// the fields that follow. A velocity that matches is skipped, and a position is
+	// sent as a small offset, in steps of POSITION_STEP. Both sides keep what the
+	// client reconstructs, not what the server simulated, so rounding never
+	// accumulates. With no baseline, or one that's too far off, fields go in full.
+	namespace SnapshotDelta
+	{
+		// Far below a pixel; the client only draws pucks, the server decides goals
+		const float POSITION_STEP{ 1.0f / 64.0f };
+		// Snapshots kept on each side, in ticks. An acknowledgement older than this means full fields.
+		const unsigned HISTORY_SIZE{ 64 };
+		// Largest encoding of one puck
+		const int MAX_PUCK_BYTES{ 1 + 4 * (int)sizeof(float) };
+
+		struct PuckState
+		{
+			b2Vec2 position{ b2Vec2_zero };
+			b2Vec2 velocity{ b2Vec2_zero };
+		};
+
+		// One snapshot as the client reconstructs it
+		struct Record
+		{
+			unsigned sequenceNum{ 0 };
+			bool inUse{ false };
+			float paddleY{ 0.0f };
+			bool hasPaddle{ false };
+			std::vector<PuckState> pucks;
+			// Client only: which pucks have arrived, since a snapshot may span several datagrams
+			std::vector<Uint8> receivedPucks;
+			size_t receivedPuckCount{ 0 };
+
+			bool IsComplete() const;
+		};
+
+		// Ring of recent snapshots indexed by sequence number. Storage is reused,
+		// so once the puck count stops growing it doesn't allocate.
+		class History
+		{
+		public:
+			void Clear();
+			// Replaces whatever was in this sequence number's slot
+			Record& Begin(unsigned sequenceNum, size_t puckCount);
+			// Null if it never arrived or has been replaced
+			Record* Find(unsigned sequenceNum);
+			// Null unless every puck and the paddle are there
+			const Record* FindComplete(unsigned sequenceNum) const;
+			size_t GetHeapBytes() const;
+
+		private:
+			std::vector<Record> m_records = std::vector<Record>(HISTORY_SIZE);
+		};
+
+		// True if WritePuck would write nothing but the mask
+		bool Matches(const PuckState& baseline, const PuckState& current);
+		// Writes current relative to baselinePtr, or in full if it's null, and sets
+		// reconstructed to what ReadPuck will produce
+		void WritePuck(Buffer& output, const PuckState* baselinePtr, const PuckState& current, PuckState& reconstructed);
+		// Returns the bytes read. Throws GameException if data is malformed or a
+		// delta has no baseline.
+		int ReadPuck(const Buffer& data, int index, const PuckState* baselinePtr, PuckState& result);
+		// For a chunk whose baseline is gone. Returns the bytes ReadPuck would read.
+		int SkipPuck(const Buffer& data, int index);
+	}
+}
@@ -0,0 +1,55 @@
+/**************************************************************************************\
+** File: SpscQueue.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the SpscQueue class template
+**
+\**************************************************************************************/
+#pragma once
+#include <atomic>
+
+namespace Pong
+{
+	// Lock-free bounded queue from one producer thread to one consumer thread.
+	// Storage is fixed, so neither side allocates or waits. The producer only
+	// writes the tail and the consumer only the head; each reads the other's
+	// index to see how much room or data there is. When full, pushes fail.
+	template<typename T, unsigned CAPACITY>
+	class SpscQueue
+	{
+		static_assert(CAPACITY && (CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+	public:
+		// Producer thread
+		bool TryPush(const T& value)
+		{
+			unsigned tail{ m_tail.load(std::memory_order_relaxed) };
+			if(tail - m_head.load(std::memory_order_acquire) == CAPACITY)
+				return false;
+			m_items[tail & INDEX_MASK] = value;
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer thread
+		bool TryPop(T& value)
+		{
+			unsigned head{ m_head.load(std::memory_order_relaxed) };
+			if(head == m_tail.load(std::memory_order_acquire))
+				return false;
+			value = m_items[head & INDEX_MASK];
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		static const unsigned INDEX_MASK{ CAPACITY - 1 };
+
+		T m_items[CAPACITY];
+		// Free running; they wrap together, so their difference stays right
+		std::atomic<unsigned> m_head{ 0 };
+		std::atomic<unsigned> m_tail{ 0 };
+	};
+}
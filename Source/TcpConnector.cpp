@@ -0,0 +1,158 @@
+/**************************************************************************************\
+** File: TcpConnector.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the TcpConnector class
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "TcpConnector.h"
+
+namespace Pong
+{
+	namespace
+	{
+		// SDLNet_ResolveHost uses gethostbyname, which isn't reentrant, and an
+		// abandoned attempt may still be resolving when the next one starts
+		std::mutex resolveMutex;
+	}
+
+	TcpConnector::~TcpConnector()
+	{
+		Abandon();
+		for(Worker& worker : m_abandonedWorkers)
+			worker.thread.join();
+	}
+	void TcpConnector::Start(const std::string& host, Uint16 port)
+	{
+		Abandon();
+		JoinFinished();
+		m_attemptPtr = std::make_shared<Attempt>();
+		m_thread = std::thread{ &TcpConnector::Run, m_attemptPtr, host, port };
+	}
+	void TcpConnector::Abandon()
+	{
+		if(!m_attemptPtr)
+			return;
+		{
+			std::lock_guard<std::mutex> lock{ m_attemptPtr->mutex };
+			m_attemptPtr->abandoned = true;
+
+			// A socket that was never taken would otherwise leak
+			if(m_attemptPtr->socket)
+			{
+				SDLNet_TCP_Close(m_attemptPtr->socket);
+				m_attemptPtr->socket = nullptr;
+			}
+		}
+		m_abandonedWorkers.push_back({ std::move(m_attemptPtr), std::move(m_thread) });
+		JoinFinished();
+	}
+	void TcpConnector::JoinFinished()
+	{
+		auto finishedEnd{ std::partition(m_abandonedWorkers.begin(), m_abandonedWorkers.end(), [](const Worker& worker) {
+			std::lock_guard<std::mutex> lock{ worker.attemptPtr->mutex };
+			return !worker.attemptPtr->finished;
+		}) };
+		for(auto it = finishedEnd; it != m_abandonedWorkers.end(); ++it)
+			it->thread.join();
+		m_abandonedWorkers.erase(finishedEnd, m_abandonedWorkers.end());
+	}
+	TcpConnector::Status TcpConnector::GetStatus() const
+	{
+		if(!m_attemptPtr)
+			return Status::IDLE;
+		std::lock_guard<std::mutex> lock{ m_attemptPtr->mutex };
+		return m_attemptPtr->status;
+	}
+	std::string TcpConnector::GetError() const
+	{
+		if(!m_attemptPtr)
+			return {};
+		std::lock_guard<std::mutex> lock{ m_attemptPtr->mutex };
+		return m_attemptPtr->error;
+	}
+	// The fields below are written before status becomes CONNECTED and not after
+	const IPaddress& TcpConnector::GetAddress() const
+	{
+		static const IPaddress NO_ADDRESS{};
+		return m_attemptPtr ? m_attemptPtr->address : NO_ADDRESS;
+	}
+	Uint32 TcpConnector::GetResolveMilliseconds() const
+	{
+		return m_attemptPtr ? m_attemptPtr->resolveMilliseconds : 0;
+	}
+	Uint32 TcpConnector::GetConnectMilliseconds() const
+	{
+		return m_attemptPtr ? m_attemptPtr->connectMilliseconds : 0;
+	}
+	TCPsocket TcpConnector::TakeSocket()
+	{
+		if(!m_attemptPtr)
+			return nullptr;
+		std::lock_guard<std::mutex> lock{ m_attemptPtr->mutex };
+		TCPsocket socket{ m_attemptPtr->socket };
+		m_attemptPtr->socket = nullptr;
+		return socket;
+	}
+	void TcpConnector::Run(std::shared_ptr<Attempt> attemptPtr, std::string host, Uint16 port)
+	{
+		Connect(*attemptPtr, host, port);
+		std::lock_guard<std::mutex> lock{ attemptPtr->mutex };
+		attemptPtr->finished = true;
+	}
+	void TcpConnector::Connect(Attempt& attempt, const std::string& host, Uint16 port)
+	{
+		Uint32 startTicks{ SDL_GetTicks() };
+
+		// Resolve
+		IPaddress address;
+		bool resolved{ false };
+		std::string error;
+		{
+			std::lock_guard<std::mutex> lock{ resolveMutex };
+			SDLNet_SetError("");
+			resolved = SDLNet_ResolveHost(&address, host.c_str(), port) == 0;
+			if(!resolved)
+				error = std::string{ "Failed to resolve host " } + host + " port " + d2d::ToString(port) + ": " + SDLNet_GetError();
+		}
+		Uint32 resolvedTicks{ SDL_GetTicks() };
+		{
+			std::lock_guard<std::mutex> lock{ attempt.mutex };
+			attempt.resolveMilliseconds = resolvedTicks - startTicks;
+			if(!resolved)
+			{
+				attempt.error = error;
+				attempt.status = Status::FAILED;
+				return;
+			}
+			if(attempt.abandoned)
+				return;
+			attempt.address = address;
+			attempt.status = Status::CONNECTING;
+		}
+
+		// Connect. Blocks until the server accepts or the OS gives up. Also sets TCP_NODELAY.
+		SDLNet_SetError("");
+		TCPsocket socket{ SDLNet_TCP_Open(&address) };
+		if(!socket)
+			error = std::string{ "Failed to connect to " } + host + " port " + d2d::ToString(port) + ": " + SDLNet_GetError();
+
+		std::lock_guard<std::mutex> lock{ attempt.mutex };
+		attempt.connectMilliseconds = SDL_GetTicks() - resolvedTicks;
+		if(!socket)
+		{
+			attempt.error = error;
+			attempt.status = Status::FAILED;
+		}
+		else if(attempt.abandoned)
+			SDLNet_TCP_Close(socket);
+		else
+		{
+			attempt.socket = socket;
+			attempt.status = Status::CONNECTED;
+		}
+	}
+}
@@ -0,0 +1,85 @@
+/**************************************************************************************\
+** File: TcpConnector.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the TcpConnector class
+**
+\**************************************************************************************/
+#pragma once
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Pong
+{
+	// Resolves a host and opens a TCP connection to it on a background thread, so
+	// the caller can keep running frames and poll for the result. SDL_net has no
+	// non-blocking connect, so an attempt can't be cancelled. Abandoning one leaves
+	// its thread to finish and close whatever socket it ends up with. Threads are
+	// joined before the connector is destroyed, which must happen before SDLNet_Quit.
+	// Destroying it during a connect to an unresponsive host waits for the OS to
+	// give up.
+	class TcpConnector
+	{
+	public:
+		enum class Status
+		{
+			IDLE,
+			RESOLVING,
+			CONNECTING,
+			CONNECTED,
+			FAILED
+		};
+
+		TcpConnector() = default;
+		TcpConnector(const TcpConnector&) = delete;
+		TcpConnector& operator=(const TcpConnector&) = delete;
+		~TcpConnector();
+
+		// Abandons any attempt in progress and starts a new one
+		void Start(const std::string& host, Uint16 port);
+		// Leaves the attempt to finish on its own and returns to IDLE. Doesn't block.
+		void Abandon();
+
+		Status GetStatus() const;
+		// Valid once FAILED
+		std::string GetError() const;
+		// Valid once CONNECTED
+		const IPaddress& GetAddress() const;
+		Uint32 GetResolveMilliseconds() const;
+		Uint32 GetConnectMilliseconds() const;
+
+		// Once CONNECTED, hands over the socket, which the caller then closes
+		TCPsocket TakeSocket();
+
+	private:
+		// Shared with the thread
+		struct Attempt
+		{
+			mutable std::mutex mutex;
+			Status status{ Status::RESOLVING };
+			bool abandoned{ false };
+			bool finished{ false };	// The thread is done and can be joined without blocking
+			TCPsocket socket{ nullptr };
+			IPaddress address{};
+			std::string error;
+			Uint32 resolveMilliseconds{ 0 };
+			Uint32 connectMilliseconds{ 0 };
+		};
+		struct Worker
+		{
+			std::shared_ptr<Attempt> attemptPtr;
+			std::thread thread;
+		};
+		static void Run(std::shared_ptr<Attempt> attemptPtr, std::string host, Uint16 port);
+		static void Connect(Attempt& attempt, const std::string& host, Uint16 port);
+		// Joins abandoned threads that have finished
+		void JoinFinished();
+
+		std::shared_ptr<Attempt> m_attemptPtr;
+		std::thread m_thread;
+		std::vector<Worker> m_abandonedWorkers;
+	};
+}
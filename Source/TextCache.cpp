@@ -0,0 +1,85 @@
+/**************************************************************************************\
+** File: TextCache.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the TextCache class
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "TextCache.h"
+#include "Exceptions.h"
+#include <SDL_opengl.h>
+#include <charconv>
+
+namespace Pong
+{
+	TextCache::TextCache()
+	{
+		m_entries.reserve(MAX_CACHED_STRINGS);
+		m_scratchText.reserve(MAX_CACHED_TEXT_LENGTH);
+	}
+	TextCache::~TextCache()
+	{
+		Clear();
+	}
+	void TextCache::DrawString(std::string_view text, d2d::Alignment alignment, float size, const d2d::FontReference& font)
+	{
+		if(text.size() > MAX_CACHED_TEXT_LENGTH)
+		{
+			DrawUncached(text, alignment, size, font);
+			return;
+		}
+
+		auto key = std::make_tuple(&font, size, alignment, text);
+		auto it = std::lower_bound(m_entries.begin(), m_entries.end(), key,
+			[](const Entry& entry, const auto& key) { return GetKey(entry) < key; });
+		if(it != m_entries.end() && GetKey(*it) == key)
+		{
+			glCallList(it->displayList);
+			return;
+		}
+
+		if(m_entries.size() >= MAX_CACHED_STRINGS)
+		{
+			Clear();
+			it = m_entries.begin();
+		}
+
+		GLuint list{ glGenLists(1) };
+		if(list == 0)
+			throw GameException{ "TextCache::DrawString: glGenLists failed" };
+
+		// Compile and execute, so the first draw is also on screen
+		glNewList(list, GL_COMPILE_AND_EXECUTE);
+		DrawUncached(text, alignment, size, font);
+		glEndList();
+
+		Entry entry;
+		std::copy(text.begin(), text.end(), entry.text);
+		entry.textLength = (Uint8)text.size();
+		entry.fontPtr = &font;
+		entry.size = size;
+		entry.alignment = alignment;
+		entry.displayList = list;
+		m_entries.insert(it, entry);
+	}
+	void TextCache::DrawNumber(int number, d2d::Alignment alignment, float size, const d2d::FontReference& font)
+	{
+		char digits[16];
+		std::to_chars_result result{ std::to_chars(std::begin(digits), std::end(digits), number) };
+		DrawString({ digits, (size_t)(result.ptr - digits) }, alignment, size, font);
+	}
+	void TextCache::Clear()
+	{
+		for(const Entry& entry : m_entries)
+			glDeleteLists(entry.displayList, 1);
+		m_entries.clear();
+	}
+	void TextCache::DrawUncached(std::string_view text, d2d::Alignment alignment, float size, const d2d::FontReference& font)
+	{
+		m_scratchText.assign(text);
+		d2d::Window::DrawString(m_scratchText, alignment, size, font);
+	}
+}
@@ -0,0 +1,62 @@
+/**************************************************************************************\
+** File: TextCache.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the TextCache class
+**
+\**************************************************************************************/
+#pragma once
+#include <string_view>
+
+namespace Pong
+{
+	// Records each distinct string drawn with d2d::Window::DrawString into a GL
+	// display list the first time it is seen, keyed by (text, font, size, alignment).
+	// Later draws of the same string replay the list, so the text is laid out
+	// once instead of every frame. Color and transform are taken from the current
+	// state, just like DrawString. Entry storage is reserved up front, so a miss
+	// on a short string doesn't allocate either.
+	class TextCache
+	{
+	public:
+		TextCache();
+		TextCache(const TextCache&) = delete;
+		TextCache& operator=(const TextCache&) = delete;
+		~TextCache();
+
+		void DrawString(std::string_view text, d2d::Alignment alignment, float size, const d2d::FontReference& font);
+		void DrawNumber(int number, d2d::Alignment alignment, float size, const d2d::FontReference& font);
+
+		// Frees all display lists. Call while the GL context is current.
+		void Clear();
+
+	private:
+		// Bounds memory use when strings keep changing, such as an FPS counter
+		static const size_t MAX_CACHED_STRINGS{ 256 };
+		// Longer strings are drawn without caching
+		static const size_t MAX_CACHED_TEXT_LENGTH{ 63 };
+
+		struct Entry
+		{
+			char text[MAX_CACHED_TEXT_LENGTH];
+			Uint8 textLength;
+			const d2d::FontReference* fontPtr;
+			float size;
+			d2d::Alignment alignment;
+			unsigned displayList;
+		};
+		static auto GetKey(const Entry& entry)
+		{
+			return std::make_tuple(entry.fontPtr, entry.size, entry.alignment, std::string_view{ entry.text, entry.textLength });
+		}
+
+		void DrawUncached(std::string_view text, d2d::Alignment alignment, float size, const d2d::FontReference& font);
+
+		// Sorted by key, capacity reserved by the constructor
+		std::vector<Entry> m_entries;
+		// d2d::Window::DrawString takes a std::string; reusing one keeps its capacity
+		std::string m_scratchText;
+	};
+}
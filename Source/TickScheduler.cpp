@@ -0,0 +1,172 @@
+/**************************************************************************************\
+** File: TickScheduler.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the TickScheduler class
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "TickScheduler.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <sys/prctl.h>
+#include <time.h>
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+namespace Pong
+{
+#ifdef _WIN32
+	namespace
+	{
+		// Windows 10 1803 and later; older versions fail the create and fall back to Sleep
+		const DWORD HIGH_RESOLUTION_TIMER_FLAG{ 0x00000002 };
+	}
+#endif
+
+	TickScheduler::~TickScheduler()
+	{
+#ifdef _WIN32
+		if(m_timer)
+			CloseHandle(m_timer);
+#endif
+	}
+	void TickScheduler::Init(float stepSeconds, int maxStepsBehind)
+	{
+		m_stepSeconds = stepSeconds;
+		m_maxStepsBehind = maxStepsBehind;
+		m_spinTail = MAX_SPIN_TAIL;
+		m_nextOversleep = 0;
+		m_oversleepCount = 0;
+		m_tickCount = 0;
+		m_missedDeadlineCount = 0;
+		m_totalLateness = 0.0;
+		m_maxLateness = 0.0;
+#ifdef _WIN32
+		if(!m_timer)
+			m_timer = CreateWaitableTimerExW(nullptr, nullptr, HIGH_RESOLUTION_TIMER_FLAG, TIMER_ALL_ACCESS);
+#elif defined(__linux__)
+		// Sleeps on this thread may otherwise end up to 50 us late by default, so more
+		// timers can fire together. One nanosecond asks for no slack.
+		prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
+		Restart();
+	}
+	void TickScheduler::WaitForNextTick()
+	{
+		double now{ GetSeconds() };
+
+		// Fell too far behind (e.g. a blocking message box), so skip what was missed
+		if(now - m_nextTick > m_maxStepsBehind * m_stepSeconds)
+			m_nextTick = now;
+
+		if(now >= m_nextTick)
+		{
+			++m_missedDeadlineCount;
+			RecordLateness(now - m_nextTick);
+		}
+		else
+		{
+			double wakeTime{ m_nextTick - GetSpinTailSeconds() };
+			if(wakeTime > now)
+			{
+				SleepUntil(wakeTime);
+				RecordOversleep(GetSeconds() - wakeTime);
+			}
+			while((now = GetSeconds()) < m_nextTick)
+				;
+			RecordLateness(now - m_nextTick);
+		}
+		++m_tickCount;
+		m_nextTick += m_stepSeconds;
+	}
+	void TickScheduler::Restart()
+	{
+		m_nextTick = GetSeconds() + m_stepSeconds;
+	}
+	Uint64 TickScheduler::GetTicksRun() const
+	{
+		return m_tickCount;
+	}
+	Uint64 TickScheduler::GetMissedDeadlineCount() const
+	{
+		return m_missedDeadlineCount;
+	}
+	double TickScheduler::GetMeanLatenessSeconds() const
+	{
+		return m_tickCount ? m_totalLateness / m_tickCount : 0.0;
+	}
+	double TickScheduler::GetMaxLatenessSeconds() const
+	{
+		return m_maxLateness;
+	}
+	double TickScheduler::GetSpinTailSeconds() const
+	{
+		return m_spinTail;
+	}
+	double TickScheduler::GetSeconds()
+	{
+#ifdef __linux__
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return (double)now.tv_sec + 1e-9 * (double)now.tv_nsec;
+#else
+		return (double)SDL_GetPerformanceCounter() / (double)SDL_GetPerformanceFrequency();
+#endif
+	}
+	void TickScheduler::SleepUntil(double wakeTime)
+	{
+#ifdef __linux__
+		// Absolute, so a wait interrupted by a signal just resumes
+		timespec wake;
+		wake.tv_sec = (time_t)wakeTime;
+		wake.tv_nsec = (long)((wakeTime - (double)wake.tv_sec) * 1e9);
+		while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr) == EINTR)
+			;
+#elif defined(_WIN32)
+		double seconds{ wakeTime - GetSeconds() };
+		if(seconds <= 0.0)
+			return;
+		if(m_timer)
+		{
+			// Negative means relative, in 100 ns units
+			LARGE_INTEGER dueTime;
+			dueTime.QuadPart = -(LONGLONG)(seconds * 1e7);
+			if(SetWaitableTimer(m_timer, &dueTime, 0, nullptr, nullptr, FALSE))
+			{
+				WaitForSingleObject(m_timer, INFINITE);
+				return;
+			}
+		}
+		Sleep((DWORD)(seconds * 1000.0));
+#else
+		std::this_thread::sleep_for(std::chrono::duration<double>{ wakeTime - GetSeconds() });
+#endif
+	}
+	void TickScheduler::RecordOversleep(double seconds)
+	{
+		m_oversleeps[m_nextOversleep] = (float)seconds;
+		m_nextOversleep = (m_nextOversleep + 1) % OVERSLEEP_HISTORY;
+		m_oversleepCount = std::min(m_oversleepCount + 1, OVERSLEEP_HISTORY);
+
+		// Until there's a history, stay on the safe side
+		if(m_oversleepCount < OVERSLEEP_HISTORY)
+			return;
+		std::copy(std::begin(m_oversleeps), std::end(m_oversleeps), std::begin(m_sortedOversleeps));
+		float* percentilePtr{ m_sortedOversleeps + (int)(OVERSLEEP_PERCENTILE * (OVERSLEEP_HISTORY - 1)) };
+		std::nth_element(std::begin(m_sortedOversleeps), percentilePtr, std::end(m_sortedOversleeps));
+		m_spinTail = std::min(std::max(*percentilePtr + SPIN_TAIL_MARGIN, MIN_SPIN_TAIL), MAX_SPIN_TAIL);
+	}
+	void TickScheduler::RecordLateness(double seconds)
+	{
+		m_totalLateness += seconds;
+		m_maxLateness = std::max(m_maxLateness, seconds);
+	}
+}
@@ -0,0 +1,73 @@
+/**************************************************************************************\
+** File: TickScheduler.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the TickScheduler class
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	// Runs fixed rate ticks on time without burning a core. Each wait sleeps on an
+	// absolute deadline (clock_nanosleep on Linux, a high resolution waitable timer on
+	// Windows) until shortly before the tick is due, then spins the rest of the way.
+	// The spin tail covers how far most recent sleeps overshot, so it stays short when
+	// the OS wakes us on time, and a rare late wake costs one late tick rather than a
+	// long spin on every tick after. A wait that starts after its deadline is a miss.
+	class TickScheduler
+	{
+	public:
+		~TickScheduler();
+		TickScheduler() = default;
+		TickScheduler(const TickScheduler&) = delete;
+		TickScheduler& operator=(const TickScheduler&) = delete;
+
+		// Call on the thread that will wait. The first tick is due a step from now.
+		// Ticks more than maxStepsBehind late are dropped rather than run back to back.
+		void Init(float stepSeconds, int maxStepsBehind);
+		// Returns when the next tick is due, right away if it's overdue
+		void WaitForNextTick();
+		// For when the caller waited some other way, e.g. on sockets
+		void Restart();
+
+		Uint64 GetTicksRun() const;
+		Uint64 GetMissedDeadlineCount() const;
+		// How long after its deadline a tick started
+		double GetMeanLatenessSeconds() const;
+		double GetMaxLatenessSeconds() const;
+		double GetSpinTailSeconds() const;
+
+	private:
+		static const int OVERSLEEP_HISTORY{ 64 };
+		const float OVERSLEEP_PERCENTILE{ 0.9f };
+		const double MIN_SPIN_TAIL{ 0.00002 };
+		const double MAX_SPIN_TAIL{ 0.002 };
+		const double SPIN_TAIL_MARGIN{ 0.00002 };
+
+		static double GetSeconds();
+		void SleepUntil(double wakeTime);
+		void RecordOversleep(double seconds);
+		void RecordLateness(double seconds);
+
+		double m_stepSeconds{ 0.0 };
+		int m_maxStepsBehind{ 0 };
+		double m_nextTick{ 0.0 };
+		double m_spinTail{ MAX_SPIN_TAIL };
+		float m_oversleeps[OVERSLEEP_HISTORY]{};
+		float m_sortedOversleeps[OVERSLEEP_HISTORY]{};	// Scratch
+		int m_nextOversleep{ 0 };
+		int m_oversleepCount{ 0 };
+
+		Uint64 m_tickCount{ 0 };
+		Uint64 m_missedDeadlineCount{ 0 };
+		double m_totalLateness{ 0.0 };
+		double m_maxLateness{ 0.0 };
+
+#ifdef _WIN32
+		void* m_timer{ nullptr };
+#endif
+	};
+}
@@ -0,0 +1,179 @@
+/**************************************************************************************\
+** File: Trace.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for scoped trace events and Chrome trace export
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "Trace.h"
+#include <cstdio>
+#include <mutex>
+
+namespace Pong
+{
+	namespace Trace
+	{
+		namespace
+		{
+			struct Event
+			{
+				const char* name;
+				Uint64 start;
+				Uint64 end;
+			};
+
+			// Only the owning thread writes, but WriteFile may read while it runs,
+			// so each buffer has its own (almost always uncontended) mutex
+			struct ThreadBuffer
+			{
+				std::mutex mutex;
+				std::vector<Event> events;
+				size_t next{ 0 };
+				bool wrapped{ false };
+				bool inUse{ false };
+				int threadID{ 0 };
+				std::string threadName;
+			};
+
+			// Marks the thread's buffer free for reuse when the thread exits, so
+			// restarting the simulation thread doesn't keep adding buffers
+			struct ThreadBufferHandle
+			{
+				ThreadBuffer* bufferPtr{ nullptr };
+				~ThreadBufferHandle()
+				{
+					if(bufferPtr)
+					{
+						std::lock_guard<std::mutex> lock{ bufferPtr->mutex };
+						bufferPtr->inUse = false;
+					}
+				}
+			};
+
+			TraceDef settings;
+			Uint64 startCount{ 0 };
+			std::mutex buffersMutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+			thread_local ThreadBufferHandle threadBuffer;
+
+			ThreadBuffer& GetThreadBuffer()
+			{
+				if(!threadBuffer.bufferPtr)
+				{
+					std::lock_guard<std::mutex> lock{ buffersMutex };
+					for(const auto& bufferPtr : buffers)
+					{
+						std::lock_guard<std::mutex> bufferLock{ bufferPtr->mutex };
+						if(!bufferPtr->inUse)
+						{
+							bufferPtr->inUse = true;
+							threadBuffer.bufferPtr = bufferPtr.get();
+							break;
+						}
+					}
+					if(!threadBuffer.bufferPtr)
+					{
+						buffers.push_back(std::make_unique<ThreadBuffer>());
+						ThreadBuffer& buffer{ *buffers.back() };
+						buffer.events.resize((size_t)settings.eventsPerThread);
+						buffer.inUse = true;
+						buffer.threadID = (int)buffers.size();
+						buffer.threadName = "thread " + d2d::ToString(buffer.threadID);
+						threadBuffer.bufferPtr = &buffer;
+					}
+				}
+				return *threadBuffer.bufferPtr;
+			}
+			double ToMicroseconds(Uint64 count)
+			{
+				return (double)(count - startCount) * 1000000.0 / (double)SDL_GetPerformanceFrequency();
+			}
+		}
+		namespace Detail
+		{
+			std::atomic<bool> enabled{ false };
+
+			void Record(const char* name, Uint64 start, Uint64 end)
+			{
+				ThreadBuffer& buffer{ GetThreadBuffer() };
+				std::lock_guard<std::mutex> lock{ buffer.mutex };
+				buffer.events[buffer.next] = { name, start, end };
+				if(++buffer.next == buffer.events.size())
+				{
+					buffer.next = 0;
+					buffer.wrapped = true;
+				}
+			}
+		}
+
+		void Init(const TraceDef& traceSettings)
+		{
+			settings = traceSettings;
+			const char* environmentValue{ SDL_getenv(ENVIRONMENT_VARIABLE) };
+			bool enable{ settings.enabled || (environmentValue && std::string{ environmentValue } == "1") };
+
+			startCount = SDL_GetPerformanceCounter();
+			Detail::enabled.store(enable, std::memory_order_relaxed);
+			if(enable)
+			{
+				SetThreadName("main");
+				d2LogInfo << "Tracing enabled, writing to " << settings.outputFilePath;
+			}
+		}
+		bool IsEnabled()
+		{
+			return Detail::enabled.load(std::memory_order_relaxed);
+		}
+		void SetThreadName(const char* name)
+		{
+			if(!IsEnabled())
+				return;
+			ThreadBuffer& buffer{ GetThreadBuffer() };
+			std::lock_guard<std::mutex> lock{ buffer.mutex };
+			buffer.threadName = name;
+		}
+		void WriteFile()
+		{
+			if(!IsEnabled())
+				return;
+
+			std::FILE* filePtr{ std::fopen(settings.outputFilePath.c_str(), "w") };
+			if(!filePtr)
+			{
+				d2LogWarning << "Failed to open trace file " << settings.outputFilePath;
+				return;
+			}
+
+			std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", filePtr);
+			bool first{ true };
+			std::lock_guard<std::mutex> lock{ buffersMutex };
+			for(const auto& bufferPtr : buffers)
+			{
+				std::lock_guard<std::mutex> bufferLock{ bufferPtr->mutex };
+				const ThreadBuffer& buffer{ *bufferPtr };
+
+				std::fprintf(filePtr, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+					first ? "" : ",\n", buffer.threadID, buffer.threadName.c_str());
+				first = false;
+
+				// Oldest first
+				size_t count{ buffer.wrapped ? buffer.events.size() : buffer.next };
+				size_t oldest{ buffer.wrapped ? buffer.next : 0 };
+				for(size_t i = 0; i < count; ++i)
+				{
+					const Event& event{ buffer.events[(oldest + i) % buffer.events.size()] };
+					std::fprintf(filePtr, ",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+						event.name, buffer.threadID, ToMicroseconds(event.start),
+						ToMicroseconds(event.end) - ToMicroseconds(event.start));
+				}
+			}
+			std::fputs("\n]}\n", filePtr);
+			std::fclose(filePtr);
+
+			d2LogInfo << "Wrote trace to " << settings.outputFilePath;
+		}
+	}
+}
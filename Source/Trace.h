@@ -0,0 +1,65 @@
+/**************************************************************************************\
+** File: Trace.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for scoped trace events and Chrome trace export
+**
+\**************************************************************************************/
+#pragma once
+#include "AppDef.h"
+#include <atomic>
+
+namespace Pong
+{
+	// Records named scopes into a fixed size ring buffer per thread and writes
+	// them out as Chrome trace event JSON, which opens in Perfetto or
+	// chrome://tracing. While tracing is off a scope costs one relaxed load.
+	namespace Trace
+	{
+		const char* const ENVIRONMENT_VARIABLE{ "PONG_TRACE" };
+
+		// Tracing is on if enabled in settings or ENVIRONMENT_VARIABLE is set to 1.
+		// Call before starting any other threads.
+		void Init(const TraceDef& settings);
+		bool IsEnabled();
+
+		// Shows up as the thread's name in the trace viewer
+		void SetThreadName(const char* name);
+
+		// Writes everything currently in the ring buffers to the file from settings
+		void WriteFile();
+
+		namespace Detail
+		{
+			extern std::atomic<bool> enabled;
+			void Record(const char* name, Uint64 start, Uint64 end);
+		}
+	}
+
+	// Name must be a string literal or otherwise outlive the trace
+	class TraceScope
+	{
+	public:
+		explicit TraceScope(const char* name)
+		{
+			if(Trace::Detail::enabled.load(std::memory_order_relaxed))
+			{
+				m_name = name;
+				m_start = SDL_GetPerformanceCounter();
+			}
+		}
+		~TraceScope()
+		{
+			if(m_name)
+				Trace::Detail::Record(m_name, m_start, SDL_GetPerformanceCounter());
+		}
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+
+	private:
+		const char* m_name{ nullptr };
+		Uint64 m_start{ 0 };
+	};
+}
@@ -0,0 +1,52 @@
+/**************************************************************************************\
+** File: TripleBuffer.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the TripleBuffer class template
+**
+\**************************************************************************************/
+#pragma once
+#include <atomic>
+
+namespace Pong
+{
+	// Lock-free handoff of the latest value from one writer thread to one reader
+	// thread. The writer fills its own slot and publishes it by swapping it with
+	// the shared middle slot; the reader takes the middle slot only when it holds
+	// something new. Neither side ever waits, and the reader always sees a
+	// complete value.
+	template<typename T>
+	class TripleBuffer
+	{
+	public:
+		// Writer thread
+		T& GetWriteBuffer()
+		{
+			return m_buffers[m_writeIndex];
+		}
+		void Publish()
+		{
+			m_writeIndex = m_middle.exchange(m_writeIndex | NEW_DATA_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+		}
+
+		// Reader thread. Returns the most recently published value, or the
+		// previous one again if nothing new has been published since.
+		const T& Read()
+		{
+			if(m_middle.load(std::memory_order_relaxed) & NEW_DATA_BIT)
+				m_readIndex = m_middle.exchange(m_readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+			return m_buffers[m_readIndex];
+		}
+
+	private:
+		static const unsigned INDEX_MASK{ 0x3u };
+		static const unsigned NEW_DATA_BIT{ 0x4u };
+
+		T m_buffers[3];
+		unsigned m_writeIndex{ 0 };
+		std::atomic<unsigned> m_middle{ 1 };
+		unsigned m_readIndex{ 2 };
+	};
+}
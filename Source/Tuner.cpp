@@ -0,0 +1,382 @@
+/**************************************************************************************\
+** File: Tuner.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the Tuner namespace
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "Tuner.h"
+#include "Game.h"
+#include "RulesDef.h"
+#include "CommandLine.h"
+#include "Exceptions.h"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace Pong
+{
+	namespace Tuner
+	{
+		namespace
+		{
+			const float SIMULATION_DT{ 1.0f / 120.0f };
+			const float MAX_RALLY_SECONDS{ 60.0f };
+			const unsigned long long DEFAULT_RALLIES_PER_POINT{ 100000ull };
+			const unsigned long long RALLIES_PER_BATCH{ 5000ull };
+			const float DEFAULT_BOT_ERROR{ 0.8f };
+			const int ANGLE_HISTOGRAM_BINS{ 9 };
+
+			struct RuleParameter
+			{
+				const char* name;
+				float RulesDef::* field;
+				float fileToRulesFactor;
+			};
+			const RuleParameter RULE_PARAMETERS[]{
+				{ "initialPuckSpeed", &RulesDef::initialPuckSpeed, 1.0f },
+				{ "puckSpeedBoostMultiplier", &RulesDef::puckSpeedBoostMultiplier, 1.0f },
+				{ "playerMaxSpeed", &RulesDef::playerMaxSpeed, 1.0f },
+				{ "startAngle", &RulesDef::startAngle, RADIANS_PER_DEGREE },
+				{ "bounceAngleRange", &RulesDef::bounceAngleRange, RADIANS_PER_DEGREE },
+				{ "maxCurvatureAngleChange", &RulesDef::maxCurvatureAngleChange, RADIANS_PER_DEGREE }
+			};
+
+			struct ParameterRange
+			{
+				const RuleParameter* parameterPtr;
+				float min;
+				float max;
+				int steps;
+
+				// Value in settings file units
+				float GetValue(int step) const
+				{
+					if(steps <= 1)
+						return min;
+					return min + (max - min) * (float)step / (float)(steps - 1);
+				}
+			};
+
+			struct Settings
+			{
+				std::string rulesFilePath{ "Data/rules.hjson" };
+				unsigned long long ralliesPerPoint{ DEFAULT_RALLIES_PER_POINT };
+				unsigned threads{ std::max(1u, std::thread::hardware_concurrency()) };
+				unsigned seed{ 1u };
+				float leftBotError{ DEFAULT_BOT_ERROR };
+				float rightBotError{ DEFAULT_BOT_ERROR };
+				std::vector<ParameterRange> ranges;
+			};
+
+			struct RallyStats
+			{
+				unsigned long long rallies{ 0 };
+				unsigned long long hits{ 0 };
+				double seconds{ 0.0 };
+				unsigned long long leftPoints{ 0 };
+				unsigned long long rightPoints{ 0 };
+				unsigned long long timeouts{ 0 };
+				unsigned longestRally{ 0 };
+				std::array<unsigned long long, ANGLE_HISTOGRAM_BINS> hitAngles{};
+
+				void Add(const RallyStats& other)
+				{
+					rallies += other.rallies;
+					hits += other.hits;
+					seconds += other.seconds;
+					leftPoints += other.leftPoints;
+					rightPoints += other.rightPoints;
+					timeouts += other.timeouts;
+					longestRally = std::max(longestRally, other.longestRally);
+					for(int i = 0; i < ANGLE_HISTOGRAM_BINS; ++i)
+						hitAngles[i] += other.hitAngles[i];
+				}
+			};
+
+			struct GridPoint
+			{
+				RulesDef rules;
+				std::vector<float> values;	// Settings file units, one per range
+				RallyStats stats;
+			};
+
+			struct Batch
+			{
+				size_t pointIndex;
+				unsigned long long rallies;
+				unsigned long long batchIndex;
+			};
+
+			const RuleParameter* FindRuleParameter(const std::string& name)
+			{
+				for(const RuleParameter& parameter : RULE_PARAMETERS)
+					if(name == parameter.name)
+						return &parameter;
+				return nullptr;
+			}
+			Settings ParseArguments(const std::vector<std::string>& arguments)
+			{
+				Settings settings;
+				for(const CommandLine::Argument& argument : CommandLine::Parse(arguments))
+				{
+					const std::string& name{ argument.name };
+					const std::string& value{ argument.value };
+					if(name == "rules")
+						settings.rulesFilePath = value;
+					else if(name == "rallies")
+						settings.ralliesPerPoint = CommandLine::ToUnsigned(argument);
+					else if(name == "threads")
+						settings.threads = std::max(1u, (unsigned)CommandLine::ToUnsigned(argument));
+					else if(name == "seed")
+						settings.seed = (unsigned)CommandLine::ToUnsigned(argument);
+					else if(name == "leftBotError")
+						settings.leftBotError = CommandLine::ToFloat(argument);
+					else if(name == "rightBotError")
+						settings.rightBotError = CommandLine::ToFloat(argument);
+					else
+					{
+						ParameterRange range;
+						range.parameterPtr = FindRuleParameter(name);
+						if(!range.parameterPtr)
+							throw TunerException{ "Unknown setting: " + name };
+
+						// Either min:max:steps or a single value
+						size_t firstColon{ value.find(':') };
+						if(firstColon == std::string::npos)
+						{
+							range.min = range.max = CommandLine::ToFloat(argument);
+							range.steps = 1;
+						}
+						else
+						{
+							size_t secondColon{ value.find(':', firstColon + 1) };
+							if(secondColon == std::string::npos)
+								throw TunerException{ "Expected name=min:max:steps: " + argument.text };
+							range.min = CommandLine::ToFloat(argument, value.substr(0, firstColon));
+							range.max = CommandLine::ToFloat(argument, value.substr(firstColon + 1, secondColon - firstColon - 1));
+							range.steps = (int)CommandLine::ToUnsigned(argument, value.substr(secondColon + 1));
+							if(range.steps < 1)
+								throw TunerException{ "Steps must be at least 1: " + argument.text };
+						}
+						settings.ranges.push_back(range);
+					}
+				}
+				return settings;
+			}
+			std::vector<GridPoint> MakeGrid(const Settings& settings, const RulesDef& baseRules)
+			{
+				std::vector<GridPoint> grid;
+				std::vector<int> steps(settings.ranges.size(), 0);
+				while(true)
+				{
+					GridPoint point;
+					point.rules = baseRules;
+					for(size_t i = 0; i < settings.ranges.size(); ++i)
+					{
+						const ParameterRange& range{ settings.ranges[i] };
+						float value{ range.GetValue(steps[i]) };
+						point.rules.*(range.parameterPtr->field) = value * range.parameterPtr->fileToRulesFactor;
+						point.values.push_back(value);
+					}
+					try {
+						point.rules.Validate();
+					}
+					catch(const SettingOutOfRangeException& e) {
+						throw TunerException{ std::string{ "Grid point out of range: " } + e.what() };
+					}
+					grid.push_back(point);
+
+					// Advance to the next combination, last range fastest
+					int i{ (int)settings.ranges.size() - 1 };
+					for(; i >= 0; --i)
+					{
+						if(++steps[i] < settings.ranges[i].steps)
+							break;
+						steps[i] = 0;
+					}
+					if(i < 0)
+						return grid;
+				}
+			}
+
+			// Tracks the puck's height, aiming a fraction of the paddle off center
+			float GetBotMovementFactor(const Player& bot, const Puck& puck, float aim, const RulesDef& rules)
+			{
+				float maxDisplacement{ rules.playerMaxSpeed * SIMULATION_DT };
+				if(maxDisplacement <= 0.0f)
+					return 0.0f;
+
+				float paddleCenterY{ bot.GetPosition().y + 0.5f * PLAYER_SIZE.y };
+				float targetY{ puck.GetPosition().y + 0.5f * PUCK_SIZE.y + aim * 0.5f * PLAYER_SIZE.y };
+				float factor{ (targetY - paddleCenterY) / maxDisplacement };
+				d2d::Clamp(factor, { -1.0f, 1.0f });
+				return factor;
+			}
+			int GetAngleBin(float angle, const RulesDef& rules)
+			{
+				float percent{ (angle + 0.5f * rules.bounceAngleRange) / rules.bounceAngleRange };
+				int bin{ (int)(percent * ANGLE_HISTOGRAM_BINS) };
+				d2d::Clamp(bin, { 0, ANGLE_HISTOGRAM_BINS - 1 });
+				return bin;
+			}
+			void SimulateRally(const RulesDef& rules, const Settings& settings, std::mt19937& generator, RallyStats& stats)
+			{
+				std::bernoulli_distribution coinFlip;
+				std::uniform_real_distribution<float> leftAimError{ -settings.leftBotError, settings.leftBotError };
+				std::uniform_real_distribution<float> rightAimError{ -settings.rightBotError, settings.rightBotError };
+
+				Player left, right;
+				left.Init(Side::LEFT);
+				right.Init(Side::RIGHT);
+
+				// Same serve as Puck::ResetRound, but from our own generator
+				float angle{ coinFlip(generator) ? rules.startAngle : -rules.startAngle };
+				if(coinFlip(generator))
+					angle += d2d::PI;
+				d2d::WrapRadians(angle);
+				Puck puck;
+				puck.ResetRound(rules, angle);
+
+				float leftAim{ leftAimError(generator) };
+				float rightAim{ rightAimError(generator) };
+				unsigned hits{ 0 };
+				float seconds{ 0.0f };
+				while(!puck.Scored() && seconds < MAX_RALLY_SECONDS)
+				{
+					left.SetMovementFactor(GetBotMovementFactor(left, puck, leftAim, rules));
+					right.SetMovementFactor(GetBotMovementFactor(right, puck, rightAim, rules));
+					left.Update(SIMULATION_DT, rules);
+					right.Update(SIMULATION_DT, rules);
+
+					bool wasMovingLeft{ puck.GetVelocity().x < 0.0f };
+					puck.Update(SIMULATION_DT, rules, left, right);
+					seconds += SIMULATION_DT;
+
+					// A paddle hit is the only thing that reverses the puck horizontally
+					b2Vec2 velocity{ puck.GetVelocity() };
+					if(wasMovingLeft != (velocity.x < 0.0f))
+					{
+						++hits;
+						++stats.hitAngles[GetAngleBin(atan2(velocity.y, std::abs(velocity.x)), rules)];
+						if(wasMovingLeft)
+							leftAim = leftAimError(generator);
+						else
+							rightAim = rightAimError(generator);
+					}
+				}
+
+				++stats.rallies;
+				stats.hits += hits;
+				stats.seconds += seconds;
+				stats.longestRally = std::max(stats.longestRally, hits);
+				if(!puck.Scored())
+					++stats.timeouts;
+				else if(left.GetScore() > 0)
+					++stats.leftPoints;
+				else
+					++stats.rightPoints;
+			}
+			void RunBatches(std::vector<GridPoint>& grid, const Settings& settings)
+			{
+				std::vector<Batch> batches;
+				for(size_t pointIndex = 0; pointIndex < grid.size(); ++pointIndex)
+				{
+					unsigned long long batchIndex{ 0 };
+					for(unsigned long long first = 0; first < settings.ralliesPerPoint; first += RALLIES_PER_BATCH)
+						batches.push_back({ pointIndex, std::min(RALLIES_PER_BATCH, settings.ralliesPerPoint - first), batchIndex++ });
+				}
+
+				std::atomic<size_t> nextBatch{ 0 };
+				std::mutex gridMutex;
+				auto worker = [&]()
+				{
+					for(size_t batchIndex = nextBatch++; batchIndex < batches.size(); batchIndex = nextBatch++)
+					{
+						const Batch& batch{ batches[batchIndex] };
+						const RulesDef& rules{ grid[batch.pointIndex].rules };
+
+						// Seeded per batch so results don't depend on the thread count
+						std::seed_seq seed{ settings.seed, (unsigned)batch.pointIndex,
+							(unsigned)batch.batchIndex, (unsigned)(batch.batchIndex >> 32) };
+						std::mt19937 generator{ seed };
+
+						RallyStats stats;
+						for(unsigned long long i = 0; i < batch.rallies; ++i)
+							SimulateRally(rules, settings, generator, stats);
+
+						std::lock_guard<std::mutex> lock{ gridMutex };
+						grid[batch.pointIndex].stats.Add(stats);
+					}
+				};
+
+				std::vector<std::thread> threads;
+				for(unsigned i = 1; i < settings.threads; ++i)
+					threads.emplace_back(worker);
+				worker();
+				for(std::thread& thread : threads)
+					thread.join();
+			}
+			void PrintResults(const std::vector<GridPoint>& grid, const Settings& settings)
+			{
+				std::cout << std::fixed << std::setprecision(3);
+				for(const ParameterRange& range : settings.ranges)
+					std::cout << range.parameterPtr->name << '\t';
+				std::cout << "hits/rally\tsec/rally\tlongest\tleft%\tright%\ttimeout%\tpoints/min"
+					"\thit angle % (" << ANGLE_HISTOGRAM_BINS << " bins, down to up)\n";
+
+				for(const GridPoint& point : grid)
+				{
+					const RallyStats& stats{ point.stats };
+					double rallies{ (double)std::max(1ull, stats.rallies) };
+					double hits{ (double)std::max(1ull, stats.hits) };
+
+					for(float value : point.values)
+						std::cout << value << '\t';
+					std::cout << stats.hits / rallies << '\t'
+						<< stats.seconds / rallies << '\t'
+						<< stats.longestRally << '\t'
+						<< 100.0 * stats.leftPoints / rallies << '\t'
+						<< 100.0 * stats.rightPoints / rallies << '\t'
+						<< 100.0 * stats.timeouts / rallies << '\t'
+						<< (stats.seconds > 0.0 ? 60.0 * (stats.leftPoints + stats.rightPoints) / stats.seconds : 0.0);
+					for(unsigned long long binCount : stats.hitAngles)
+						std::cout << '\t' << 100.0 * binCount / hits;
+					std::cout << '\n';
+				}
+			}
+		}
+		int Run(const std::vector<std::string>& arguments)
+		{
+			try {
+				Settings settings{ ParseArguments(arguments) };
+
+				RulesDef baseRules;
+				baseRules.LoadFrom(settings.rulesFilePath);
+				std::vector<GridPoint> grid{ MakeGrid(settings, baseRules) };
+
+				std::cout << "Running " << settings.ralliesPerPoint << " rallies at each of " << grid.size()
+					<< " grid points on " << settings.threads << " threads" << std::endl;
+				auto startTime{ std::chrono::steady_clock::now() };
+				RunBatches(grid, settings);
+				std::chrono::duration<double> elapsed{ std::chrono::steady_clock::now() - startTime };
+
+				PrintResults(grid, settings);
+				std::cout << "Simulated " << settings.ralliesPerPoint * grid.size() << " rallies in "
+					<< elapsed.count() << " seconds" << std::endl;
+				return 0;
+			}
+			catch(const d2d::Exception& e) {
+				std::cerr << "Tuner error: " << e.what() << std::endl;
+				return 1;
+			}
+		}
+	}
+}
@@ -0,0 +1,28 @@
+/**************************************************************************************\
+** File: Tuner.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the Tuner namespace
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	// Headless bot-vs-bot simulation for balancing the values in RulesDef.
+	// Sweeps a grid of rule values and runs the rallies on all cores.
+	//
+	// Usage: Pong --tune [name=min:max:steps | name=value]...
+	//	Rule names match Data\rules.hjson (angles in degrees).
+	//	Other settings: rules=<file> rallies=<per grid point> threads=<count> seed=<number>
+	//					leftBotError=<0-1> rightBotError=<0-1>
+	namespace Tuner
+	{
+		const std::string COMMAND_LINE_FLAG{ "--tune" };
+
+		// Returns process exit code
+		int Run(const std::vector<std::string>& arguments);
+	}
+}
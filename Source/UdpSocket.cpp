@@ -0,0 +1,297 @@
+/**************************************************************************************\
+** File: UdpSocket.cpp
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Source code file for the UdpSocket class
+**
+\**************************************************************************************/
+#include "pch.h"
+#include "UdpSocket.h"
+#include "Exceptions.h"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <mstcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#ifndef SIO_UDP_CONNRESET
+#define SIO_UDP_CONNRESET _WSAIOW(IOC_VENDOR, 12)
+#endif
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace Pong
+{
+	namespace
+	{
+#ifdef _WIN32
+		using SocketLength = int;
+		bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+		// A port unreachable reply to an earlier send, or a datagram too big for
+		// the packet. Either way only that datagram is lost.
+		bool DatagramDropped() { return WSAGetLastError() == WSAECONNRESET || WSAGetLastError() == WSAEMSGSIZE; }
+		bool SendBufferFull() { return WouldBlock() || WSAGetLastError() == WSAENOBUFS; }
+		std::string GetSocketError() { return "error " + d2d::ToString(WSAGetLastError()); }
+		void CloseSocket(uintptr_t handle) { closesocket((SOCKET)handle); }
+#else
+		using SocketLength = socklen_t;
+		bool WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+		bool DatagramDropped() { return errno == ECONNREFUSED; }
+		bool SendBufferFull() { return WouldBlock() || errno == ENOBUFS; }
+		std::string GetSocketError() { return std::strerror(errno); }
+		void CloseSocket(int handle) { close(handle); }
+#endif
+		// IPaddress already holds host and port in network byte order
+		sockaddr_in ToSocketAddress(const IPaddress& address)
+		{
+			sockaddr_in socketAddress{};
+			socketAddress.sin_family = AF_INET;
+			socketAddress.sin_addr.s_addr = address.host;
+			socketAddress.sin_port = address.port;
+			return socketAddress;
+		}
+		IPaddress ToIPaddress(const sockaddr_in& socketAddress)
+		{
+			return { (Uint32)socketAddress.sin_addr.s_addr, (Uint16)socketAddress.sin_port };
+		}
+	}
+
+#ifdef _WIN32
+	const UdpSocket::Handle UdpSocket::INVALID_HANDLE{ (Handle)INVALID_SOCKET };
+#else
+	const UdpSocket::Handle UdpSocket::INVALID_HANDLE{ -1 };
+#endif
+
+	UdpSocket::~UdpSocket()
+	{
+		Close();
+	}
+	void UdpSocket::Open(Uint16 port)
+	{
+		Close();
+		m_handle = (Handle)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if(m_handle == INVALID_HANDLE)
+			throw GameException{ "UdpSocket: Failed to create socket: " + GetSocketError() };
+
+		sockaddr_in address{ ToSocketAddress({ INADDR_ANY, htons(port) }) };
+#ifdef _WIN32
+		// Without turning off connection reset reporting, a port unreachable reply
+		// to one send makes a later recvfrom fail with WSAECONNRESET
+		u_long nonBlocking{ 1 };
+		BOOL reportConnectionReset{ FALSE };
+		DWORD bytesReturned{ 0 };
+		bool failed{ bind((SOCKET)m_handle, (const sockaddr*)&address, sizeof(address)) != 0 ||
+			ioctlsocket((SOCKET)m_handle, FIONBIO, &nonBlocking) != 0 ||
+			WSAIoctl((SOCKET)m_handle, SIO_UDP_CONNRESET, &reportConnectionReset, sizeof(reportConnectionReset),
+				nullptr, 0, &bytesReturned, nullptr, nullptr) != 0 };
+#else
+		bool failed{ bind(m_handle, (const sockaddr*)&address, sizeof(address)) != 0 ||
+			fcntl(m_handle, F_SETFL, fcntl(m_handle, F_GETFL, 0) | O_NONBLOCK) != 0 };
+#endif
+		if(failed)
+		{
+			std::string error{ GetSocketError() };
+			Close();
+			throw GameException{ "UdpSocket: Failed to open port " + d2d::ToString(port) + ": " + error };
+		}
+#ifdef __linux__
+		// Arrival times for Receive. Without them waits read as 0, so failing is harmless.
+		int enable{ 1 };
+		setsockopt(m_handle, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+#endif
+	}
+	void UdpSocket::Close()
+	{
+		if(m_handle != INVALID_HANDLE)
+		{
+			CloseSocket(m_handle);
+			m_handle = INVALID_HANDLE;
+		}
+	}
+	bool UdpSocket::IsOpen() const
+	{
+		return m_handle != INVALID_HANDLE;
+	}
+	Uint16 UdpSocket::GetLocalPort() const
+	{
+		sockaddr_in address{};
+		SocketLength addressLength{ sizeof(address) };
+		if(getsockname(m_handle, (sockaddr*)&address, &addressLength) != 0)
+			throw GameException{ "UdpSocket: Failed to get local port: " + GetSocketError() };
+		return ntohs(address.sin_port);
+	}
+
+#ifdef __linux__
+	int UdpSocket::Receive(UDPpacket* packets, int count, float* waitSeconds, int* drainedCountPtr)
+	{
+		if(drainedCountPtr)
+			*drainedCountPtr = 0;
+		count = std::min(count, MAX_BATCH);
+		mmsghdr messages[MAX_BATCH]{};
+		iovec vectors[MAX_BATCH];
+		sockaddr_in addresses[MAX_BATCH];
+		alignas(cmsghdr) char controls[MAX_BATCH][CMSG_SPACE(sizeof(timespec))];
+		for(int i = 0; i < count; ++i)
+		{
+			vectors[i] = { packets[i].data, (size_t)packets[i].maxlen };
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+			messages[i].msg_hdr.msg_name = &addresses[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+			if(waitSeconds)
+			{
+				messages[i].msg_hdr.msg_control = controls[i];
+				messages[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+			}
+		}
+
+		int received{ recvmmsg(m_handle, messages, (unsigned)count, MSG_DONTWAIT, nullptr) };
+		if(received < 0)
+		{
+			if(WouldBlock() || DatagramDropped())
+				return 0;
+			throw GameException{ "UdpSocket: Failed to receive: " + GetSocketError() };
+		}
+		if(drainedCountPtr)
+			*drainedCountPtr = received;
+		for(int i = 0; i < received; ++i)
+		{
+			packets[i].len = (int)messages[i].msg_len;
+			packets[i].address = ToIPaddress(addresses[i]);
+		}
+
+		// Kernel timestamps are wall clock, so compare them with the wall clock now
+		if(waitSeconds)
+		{
+			timespec now{};
+			clock_gettime(CLOCK_REALTIME, &now);
+			for(int i = 0; i < received; ++i)
+			{
+				waitSeconds[i] = 0.0f;
+				for(cmsghdr* controlPtr = CMSG_FIRSTHDR(&messages[i].msg_hdr); controlPtr;
+					controlPtr = CMSG_NXTHDR(&messages[i].msg_hdr, controlPtr))
+				{
+					if(controlPtr->cmsg_level == SOL_SOCKET && controlPtr->cmsg_type == SCM_TIMESTAMPNS)
+					{
+						timespec arrival;
+						memcpy(&arrival, CMSG_DATA(controlPtr), sizeof(arrival));
+						float wait{ (float)(now.tv_sec - arrival.tv_sec) + 1e-9f * (float)(now.tv_nsec - arrival.tv_nsec) };
+						waitSeconds[i] = std::max(wait, 0.0f);
+					}
+				}
+			}
+		}
+
+		// Drop datagrams too big for their packet, like the other platforms do
+		int kept{ 0 };
+		for(int i = 0; i < received; ++i)
+		{
+			if(messages[i].msg_hdr.msg_flags & MSG_TRUNC)
+				continue;
+			if(kept != i)
+			{
+				memcpy(packets[kept].data, packets[i].data, (size_t)packets[i].len);
+				packets[kept].len = packets[i].len;
+				packets[kept].address = packets[i].address;
+				if(waitSeconds)
+					waitSeconds[kept] = waitSeconds[i];
+			}
+			++kept;
+		}
+		return kept;
+	}
+	int UdpSocket::Send(const UDPpacket* packets, int count)
+	{
+		mmsghdr messages[MAX_BATCH]{};
+		iovec vectors[MAX_BATCH];
+		sockaddr_in addresses[MAX_BATCH];
+		for(int first = 0; first < count; first += MAX_BATCH)
+		{
+			int batchCount{ std::min(count - first, MAX_BATCH) };
+			for(int i = 0; i < batchCount; ++i)
+			{
+				const UDPpacket& packet{ packets[first + i] };
+				vectors[i] = { packet.data, (size_t)packet.len };
+				addresses[i] = ToSocketAddress(packet.address);
+				messages[i].msg_hdr.msg_iov = &vectors[i];
+				messages[i].msg_hdr.msg_iovlen = 1;
+				messages[i].msg_hdr.msg_name = &addresses[i];
+				messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+			}
+
+			// sendmmsg can stop early, for instance when the send buffer fills
+			int sent{ 0 };
+			while(sent < batchCount)
+			{
+				int result{ sendmmsg(m_handle, messages + sent, (unsigned)(batchCount - sent), 0) };
+				if(result <= 0)
+				{
+					if(SendBufferFull())
+						return first + sent;
+					throw GameException{ "UdpSocket: Failed to send " + d2d::ToString(batchCount - sent) +
+						" packets: " + GetSocketError() };
+				}
+				sent += result;
+			}
+		}
+		return count;
+	}
+#else
+	int UdpSocket::Receive(UDPpacket* packets, int count, float* waitSeconds, int* drainedCountPtr)
+	{
+		if(waitSeconds)
+			std::fill(waitSeconds, waitSeconds + count, 0.0f);
+		int received{ 0 };
+		int drainedCount{ 0 };
+		while(received < count)
+		{
+			sockaddr_in address{};
+			SocketLength addressLength{ sizeof(address) };
+			int byteCount{ (int)recvfrom(m_handle, (char*)packets[received].data, packets[received].maxlen, 0,
+				(sockaddr*)&address, &addressLength) };
+			if(byteCount < 0)
+			{
+				if(WouldBlock())
+					break;
+				if(DatagramDropped())
+				{
+					++drainedCount;
+					continue;
+				}
+				throw GameException{ "UdpSocket: Failed to receive: " + GetSocketError() };
+			}
+			packets[received].len = byteCount;
+			packets[received].address = ToIPaddress(address);
+			++received;
+			++drainedCount;
+		}
+		if(drainedCountPtr)
+			*drainedCountPtr = drainedCount;
+		return received;
+	}
+	int UdpSocket::Send(const UDPpacket* packets, int count)
+	{
+		for(int i = 0; i < count; ++i)
+		{
+			sockaddr_in address{ ToSocketAddress(packets[i].address) };
+			if(sendto(m_handle, (const char*)packets[i].data, packets[i].len, 0,
+				(const sockaddr*)&address, sizeof(address)) != packets[i].len)
+			{
+				if(SendBufferFull())
+					return i;
+				throw GameException{ "UdpSocket: Failed to send packet of " + d2d::ToString(packets[i].len) +
+					" bytes: " + GetSocketError() };
+			}
+		}
+		return count;
+	}
+#endif
+}
@@ -0,0 +1,62 @@
+/**************************************************************************************\
+** File: UdpSocket.h
+** Project: Pong
+** Author: David Leksen
+** Date:
+**
+** Header file for the UdpSocket class
+**
+\**************************************************************************************/
+#pragma once
+
+namespace Pong
+{
+	// Non-blocking UDP socket that moves datagrams in batches. On Linux a batch
+	// is one recvmmsg or sendmmsg system call; elsewhere it loops recvfrom and
+	// sendto. Datagrams are described with SDL_net's UDPpacket and IPaddress,
+	// so addresses from SDLNet_ResolveHost work as they are. Needs SDLNet_Init
+	// to have run, which sets up Winsock on Windows.
+	class UdpSocket
+	{
+	public:
+		// Enough to drain what a peer sends in a few frames with one call
+		static const int MAX_BATCH{ 32 };
+
+		UdpSocket() = default;
+		UdpSocket(const UdpSocket&) = delete;
+		UdpSocket& operator=(const UdpSocket&) = delete;
+		~UdpSocket();
+
+		// Port 0 picks any free port. Throws GameException on failure.
+		void Open(Uint16 port);
+		void Close();
+		bool IsOpen() const;
+		// Useful after opening port 0
+		Uint16 GetLocalPort() const;
+
+		// Fills data, len and address of up to min(count, MAX_BATCH) packets.
+		// Returns the number received, 0 when nothing is waiting. Datagrams too
+		// big for their packet and port unreachable errors are dropped rather
+		// than thrown, since UDP loses datagrams anyway. If waitSeconds
+		// isn't null, it gets how long each datagram sat in the socket before this
+		// call, from kernel timestamps on Linux; elsewhere 0. If drainedCountPtr
+		// isn't null, it gets how many datagrams were taken off the socket,
+		// dropped ones included, so a caller can tell when the socket is empty.
+		int Receive(UDPpacket* packets, int count, float* waitSeconds = nullptr, int* drainedCountPtr = nullptr);
+
+		// Sends each packet's data and len to its address, MAX_BATCH per system
+		// call. A full send buffer loses the rest, as the network would, so the
+		// number sent can be short. Throws GameException on other errors.
+		int Send(const UDPpacket* packets, int count);
+
+	private:
+#ifdef _WIN32
+		using Handle = uintptr_t;
+#else
+		using Handle = int;
+#endif
+		static const Handle INVALID_HANDLE;
+
+		Handle m_handle{ INVALID_HANDLE };
+	};
+}
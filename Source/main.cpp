@@ -9,9 +9,29 @@
 \**************************************************************************************/
 #include "pch.h"
 #include "App.h"
+#include "Tuner.h"
+#include "RenderBenchmark.h"
+#include "MicroBenchmark.h"
+#include "LatencyBenchmark.h"
 
 int main(int argc, char *argv[])
 {
+	// Headless rules tuning from the command line
+	if(argc > 1 && argv[1] == Pong::Tuner::COMMAND_LINE_FLAG)
+		return Pong::Tuner::Run({ argv + 2, argv + argc });
+
+	// Render timing, also works without a display
+	if(argc > 1 && argv[1] == Pong::RenderBenchmark::COMMAND_LINE_FLAG)
+		return Pong::RenderBenchmark::Run({ argv + 2, argv + argc });
+
+	// Codec and simulation hot paths, no window or network
+	if(argc > 1 && argv[1] == Pong::MicroBenchmark::COMMAND_LINE_FLAG)
+		return Pong::MicroBenchmark::Run({ argv + 2, argv + argc });
+
+	// Netcode latency over loopback, no window
+	if(argc > 1 && argv[1] == Pong::LatencyBenchmark::COMMAND_LINE_FLAG)
+		return Pong::LatencyBenchmark::Run({ argv + 2, argv + argc });
+
 	try
 	{
 		Pong::App pongApp;
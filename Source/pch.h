@@ -14,6 +14,18 @@
 //		3 enable d2AssertParanoid 
 #define D2_ASSERT_LEVEL 2
 
+// PONG_FIXED_POINT_PHYSICS:
+//		Define to simulate Puck and Player in Q16.16 fixed point with CORDIC trig,
+//		so every machine produces bit-identical results
+//#define PONG_FIXED_POINT_PHYSICS
+
+// PONG_COUNT_ALLOCATIONS:
+//		Define to replace the global operator new with one that counts calls, for
+//		the allocation figures in the profiler overlay and the benchmarks. Leave it
+//		undefined in builds that ship so the game keeps the standard allocator.
+//		The CMake build for Linux build agents defines it unless told otherwise
+//#define PONG_COUNT_ALLOCATIONS
+
 /*#include <Box2D/Box2D.h>
 #include <SDL.h>
 